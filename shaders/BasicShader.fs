@@ -1,10 +1,13 @@
 #version 330 core
 
+flat in vec4 fragmentInstanceColor;
+
 out vec4 finalColor;
 
 uniform vec4 solidColor;
+uniform bool useInstancing;
 
 void main()
 {
-	finalColor = solidColor;
+	finalColor = useInstancing ? fragmentInstanceColor : solidColor;
 }
\ No newline at end of file
@@ -1,14 +1,35 @@
 #version 330 core
 
+struct FogDescriptor
+{
+	float density;
+	float gradient;
+	vec4 skyColor;
+	bool on;
+};
+
 layout (location = 0) in vec4 vertexPosition;
 layout (location = 1) in vec4 vertexColor;
 layout (location = 2) in vec2 textureCoords;
+layout (location = 4) in mat4 instanceModelMatrix;		// Instanced rendering only
+layout (location = 8) in vec4 instanceColor;			// Instanced rendering only
+
+flat out vec4 fragmentInstanceColor;
 
 uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projectionMatrix;
+uniform bool useInstancing;
+
+layout (std140) uniform FrameBlock
+{
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	vec4 cameraPosition;
+	FogDescriptor fogDescriptor;
+};
 
 void main()
 {
-	gl_Position = projectionMatrix * viewMatrix * modelMatrix * vertexPosition;
+	mat4 currentModelMatrix = useInstancing ? instanceModelMatrix : modelMatrix;
+	fragmentInstanceColor = instanceColor;
+	gl_Position = projectionMatrix * viewMatrix * currentModelMatrix * vertexPosition;
 }
\ No newline at end of file
@@ -0,0 +1,224 @@
+#version 330 core
+
+#define LT_POINTLIGHT 0
+#define LT_SPOTLIGHT 1
+#define LT_DIRECTIONALLIGHT 2
+
+struct LightDescriptor
+{
+	/* Generic Lights Attributes */
+	vec4 ambientColor;
+	vec4 diffuseColor;
+	vec4 specularColor;
+	float constantTerm;				// Attenuation
+	float linearTerm;				// Attenuation
+	float quadraticTerm;			// Attenuation
+	int type;
+
+	/* Specific Light Attributes */
+	vec4 position;					// PointLight and SpotLight
+	vec4 direction;					// SpotLight and DirectionLight
+	float innerCutOffAngleCos;		// SpotLight
+	float outerCutOffAngleCos;		// SpotLight
+	
+	bool isOn;
+};
+
+struct FogDescriptor
+{
+	float density;
+	float gradient;
+	vec4 skyColor;
+	bool on;
+};
+
+out vec4 finalColor;
+
+// G-buffer written by the geometry pass
+uniform sampler2D gBufferPosition;			// World position, w = 1 where there is geometry
+uniform sampler2D gBufferNormal;			// World normal, w = specular shineness
+uniform sampler2D gBufferAlbedo;
+uniform sampler2D gBufferSpecular;
+
+uniform usamplerBuffer lightDescriptors;
+uniform int lightIndex;						// Light of this pass, or -1 for the base pass
+
+layout (std140) uniform FrameBlock
+{
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	vec4 cameraPosition;
+	FogDescriptor fogDescriptor;
+};
+
+float getFogVisibility(vec4 positionWorld);
+LightDescriptor fetchLight(int lightIndex);
+vec3 getPointLightContribution(LightDescriptor pointLight, vec4 normal, vec4 fragmentPosition,
+	vec4 albedo, vec4 specular, float shineness);
+vec3 getSpotLightContribution(LightDescriptor pointLight, vec4 normal, vec4 fragmentPosition,
+	vec4 albedo, vec4 specular, float shineness);
+vec3 getDirectionalLightContribution(LightDescriptor pointLight, vec4 normal, vec4 fragmentPosition,
+	vec4 albedo, vec4 specular, float shineness);
+
+// Each pass adds the contribution of one light to the pixels of the G-buffer.
+// The fog mix of the forward shaders, mix(skyColor, color, visibility), is linear on the sum of the lights, so the
+// base pass writes skyColor * (1 - visibility) and each light adds its contribution multiplied by visibility.
+void main()
+{
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	vec4 fragmentPosition = texelFetch(gBufferPosition, pixel, 0);
+
+	// No geometry: keep the skybox
+	if (fragmentPosition.w == 0.0)
+		discard;
+
+	float visibility = fogDescriptor.on ? getFogVisibility(fragmentPosition) : 1.0;
+
+	if (lightIndex < 0)
+	{
+		finalColor = vec4(fogDescriptor.skyColor.rgb * (1.0 - visibility), 1.0);
+		return;
+	}
+
+	vec4 normalAndShineness = texelFetch(gBufferNormal, pixel, 0);
+	vec4 normal = vec4(normalAndShineness.xyz, 0.0);
+	vec4 albedo = texelFetch(gBufferAlbedo, pixel, 0);
+	vec4 specular = texelFetch(gBufferSpecular, pixel, 0);
+	float shineness = normalAndShineness.w;
+	LightDescriptor light = fetchLight(lightIndex);
+	vec3 resultColor = vec3(0.0);
+
+	switch(light.type)
+	{
+		case LT_POINTLIGHT:
+			resultColor = getPointLightContribution(light, normal, fragmentPosition, albedo, specular, shineness);
+			break;
+		case LT_SPOTLIGHT:
+			resultColor = getSpotLightContribution(light, normal, fragmentPosition, albedo, specular, shineness);
+			break;
+		case LT_DIRECTIONALLIGHT:
+			resultColor = getDirectionalLightContribution(light, normal, fragmentPosition, albedo, specular, shineness);
+			break;
+	}
+
+	finalColor = vec4(resultColor * visibility, 1.0);
+}
+
+float getFogVisibility(vec4 positionWorld)
+{
+	float cameraDistance = length(positionWorld - cameraPosition);
+	return clamp(exp(-pow((cameraDistance * fogDescriptor.density), fogDescriptor.gradient)), 0.0, 1.0);
+}
+
+// Read the light of index lightIndex from the light descriptors buffer (seven texels per light).
+LightDescriptor fetchLight(int lightIndex)
+{
+	LightDescriptor light;
+	int firstTexel = lightIndex * 7;
+	uvec4 attenuation = texelFetch(lightDescriptors, firstTexel + 3);
+	uvec4 cutOff = texelFetch(lightDescriptors, firstTexel + 6);
+
+	light.ambientColor = uintBitsToFloat(texelFetch(lightDescriptors, firstTexel));
+	light.diffuseColor = uintBitsToFloat(texelFetch(lightDescriptors, firstTexel + 1));
+	light.specularColor = uintBitsToFloat(texelFetch(lightDescriptors, firstTexel + 2));
+	light.constantTerm = uintBitsToFloat(attenuation.x);
+	light.linearTerm = uintBitsToFloat(attenuation.y);
+	light.quadraticTerm = uintBitsToFloat(attenuation.z);
+	light.type = int(attenuation.w);
+	light.position = uintBitsToFloat(texelFetch(lightDescriptors, firstTexel + 4));
+	light.direction = uintBitsToFloat(texelFetch(lightDescriptors, firstTexel + 5));
+	light.innerCutOffAngleCos = uintBitsToFloat(cutOff.x);
+	light.outerCutOffAngleCos = uintBitsToFloat(cutOff.y);
+	light.isOn = cutOff.z != 0u;
+
+	return light;
+}
+
+vec3 getPointLightContribution(LightDescriptor pointLight, vec4 normal, vec4 fragmentPosition,
+	vec4 albedo, vec4 specular, float shineness)
+{
+	const float discardLength = 10.0;
+	vec4 fragmentToPointLightVec = normalize(pointLight.position - fragmentPosition);
+	
+	if (length(fragmentToPointLightVec) > discardLength)
+		return vec3(0.0);
+
+	// Ambient Color
+	vec4 pointAmbientColor = pointLight.ambientColor * albedo;
+
+	// Diffuse Color
+	float pointDiffuseContribution = max(0, dot(fragmentToPointLightVec, normal));
+	vec4 pointDiffuseColor = pointDiffuseContribution * pointLight.diffuseColor * albedo;
+	
+	// Specular Color
+	vec4 fragmentToCameraVec = normalize(cameraPosition - fragmentPosition);
+	float pointSpecularContribution = pow(max(dot(fragmentToCameraVec, reflect(-fragmentToPointLightVec, normal)), 0.0), shineness);
+	vec4 pointSpecularColor = pointSpecularContribution * pointLight.specularColor * specular;
+
+	// Attenuation
+	float pointLightDistance = length(pointLight.position - fragmentPosition);
+	float pointAttenuation = 1.0 / (pointLight.constantTerm + pointLight.linearTerm * pointLightDistance +
+		pointLight.quadraticTerm * pointLightDistance * pointLightDistance);
+
+	pointAmbientColor *= pointAttenuation;
+	pointDiffuseColor *= pointAttenuation;
+	pointSpecularColor *= pointAttenuation;
+
+	vec4 pointColor = pointAmbientColor + pointDiffuseColor + pointSpecularColor;
+	return pointColor.xyz;
+}
+
+vec3 getSpotLightContribution(LightDescriptor spotLight, vec4 normal, vec4 fragmentPosition,
+	vec4 albedo, vec4 specular, float shineness)
+{
+	vec4 fragmentToSpotLightVec = normalize(spotLight.position - fragmentPosition);
+	float spotAngleCos = dot(-fragmentToSpotLightVec, normalize(spotLight.direction));
+	float spotIntensity = 10.0 * clamp((spotAngleCos - spotLight.outerCutOffAngleCos) /
+		(spotLight.innerCutOffAngleCos - spotLight.outerCutOffAngleCos), 0.0, 1.0);
+
+	// Ambient Color
+	vec4 spotAmbientColor = spotLight.ambientColor * albedo;
+
+	// Diffuse Color
+	vec4 fragmentToPointLightVec = normalize(spotLight.position - fragmentPosition);
+	float spotDiffuseContribution = max(0, dot(fragmentToSpotLightVec, normal));
+	vec4 spotDiffuseColor = spotDiffuseContribution * spotLight.diffuseColor * albedo;
+	
+	// Specular Color
+	vec4 fragmentToCameraVec = normalize(cameraPosition - fragmentPosition);
+	float spotSpecularContribution = pow(max(dot(fragmentToCameraVec, reflect(-fragmentToSpotLightVec, normal)), 0.0), shineness);
+	vec4 spotSpecularColor = spotSpecularContribution * spotLight.specularColor * specular;
+
+	// Attenuation
+	float spotLightDistance = length(spotLight.position - fragmentPosition);
+	float spotAttenuation = 1.0 / (spotLight.constantTerm + spotLight.linearTerm * spotLightDistance +
+		spotLight.quadraticTerm * spotLightDistance * spotLightDistance);
+
+	spotAmbientColor *= spotAttenuation * spotIntensity;
+	spotDiffuseColor *= spotAttenuation * spotIntensity;
+	spotSpecularColor *= spotAttenuation * spotIntensity;
+
+	vec4 spotColor = spotAmbientColor + spotDiffuseColor + spotSpecularColor;
+	return spotColor.xyz;
+}
+
+vec3 getDirectionalLightContribution(LightDescriptor directionalLight, vec4 normal, vec4 fragmentPosition,
+	vec4 albedo, vec4 specular, float shineness)
+{
+	vec4 normalizedDirection = normalize(directionalLight.direction);
+
+	// Ambient Color
+	vec4 directionalAmbientColor = directionalLight.ambientColor * albedo;
+
+	// Diffuse Color
+	float directionalDiffuseContribution = max(0, dot(-normalizedDirection, normal));
+	vec4 directionalDiffuseColor = directionalDiffuseContribution * directionalLight.diffuseColor * albedo;
+	
+	// Specular Color
+	vec4 fragmentToCameraVec = normalize(cameraPosition - fragmentPosition);
+	float directionalSpecularContribution = pow(max(dot(fragmentToCameraVec, reflect(normalizedDirection, normal)), 0.0), shineness);
+	vec4 directionalSpecularColor = directionalSpecularContribution * directionalLight.specularColor * specular;
+
+	vec4 directionalColor = directionalAmbientColor + directionalDiffuseColor + directionalSpecularColor;
+	return directionalColor.xyz;
+}
\ No newline at end of file
@@ -0,0 +1,9 @@
+#version 330 core
+
+// Screen quad, already in normalized device coordinates
+layout (location = 0) in vec4 vertexPosition;
+
+void main()
+{
+	gl_Position = vertexPosition;
+}
\ No newline at end of file
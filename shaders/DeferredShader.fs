@@ -0,0 +1,60 @@
+#version 330 core
+
+struct Material
+{
+	sampler2D diffuseMap;
+	sampler2D specularMap;
+	sampler2D normalMap;
+	bool useNormalMap;
+	float shineness;
+};
+
+in vec4 fragmentPosition;
+in vec4 fragmentNormal;
+in vec2 fragmentTextureCoords;
+in mat4 tangentMatrix;
+
+// G-buffer
+layout (location = 0) out vec4 gBufferPosition;		// World position, w = 1 where there is geometry
+layout (location = 1) out vec4 gBufferNormal;		// World normal, w = specular shineness
+layout (location = 2) out vec4 gBufferAlbedo;		// Diffuse map color
+layout (location = 3) out vec4 gBufferSpecular;		// Specular map color
+
+uniform Material material;
+
+vec4 getCorrectNormal();
+
+void main()
+{
+	gBufferPosition = vec4(fragmentPosition.xyz, 1.0);
+	gBufferNormal = vec4(getCorrectNormal().xyz, material.shineness);
+	gBufferAlbedo = texture(material.diffuseMap, fragmentTextureCoords);
+	gBufferSpecular = texture(material.specularMap, fragmentTextureCoords);
+}
+
+vec4 getCorrectNormal()
+{
+	vec4 normal;
+
+	// Check if normal map is being used. In case positive, the normal must be obtained from the normal map.
+	// If normal map is not being used, we use the fragment normal.
+	if (material.useNormalMap)
+	{
+		// Sample normal map (range [0, 1])
+		normal = texture(material.normalMap, fragmentTextureCoords);
+		// Transform normal vector to range [-1, 1]
+		normal = normal * 2.0 - 1.0;
+		// Only X and Y are stored (BC5 normal maps), Z is reconstructed
+		normal.z = sqrt(max(1.0 - dot(normal.xy, normal.xy), 0.0));
+		// W coordinate must be 0
+		normal.w = 0;
+		// Normalize normal
+		normal = normalize(normal);
+		// Transform normal from tangent space to world space.
+		normal = normalize(tangentMatrix * normal);
+	}
+	else
+		normal = fragmentNormal;
+
+	return normal;
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#version 330 core
+
+struct Material
+{
+	sampler2D diffuseMap;
+	sampler2D specularMap;
+	sampler2D normalMap;
+	bool useNormalMap;
+	float shineness;
+};
+
+struct FogDescriptor
+{
+	float density;
+	float gradient;
+	vec4 skyColor;
+	bool on;
+};
+
+layout (location = 0) in vec4 vertexPosition;
+layout (location = 1) in vec2 vertexNormal;			// Octahedral encoding
+layout (location = 2) in vec2 vertexTextureCoords;
+layout (location = 3) in vec2 vertexTangent;			// Octahedral encoding
+layout (location = 4) in mat4 instanceModelMatrix;		// Instanced rendering only
+
+out vec4 fragmentPosition;
+out vec4 fragmentNormal;
+out vec2 fragmentTextureCoords;
+out mat4 tangentMatrix;
+
+uniform mat4 modelMatrix;
+uniform bool useInstancing;
+
+layout (std140) uniform FrameBlock
+{
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	vec4 cameraPosition;
+	FogDescriptor fogDescriptor;
+};
+
+uniform Material material;
+
+vec4 decodeOctahedral(vec2 encoded);
+
+void main()
+{
+	mat4 currentModelMatrix = useInstancing ? instanceModelMatrix : modelMatrix;
+	vec3 normal3D = mat3(inverse(transpose(currentModelMatrix))) * decodeOctahedral(vertexNormal).xyz;
+	fragmentNormal = normalize(vec4(normal3D, 0.0));
+	fragmentTextureCoords = vertexTextureCoords;
+	fragmentPosition = currentModelMatrix * vertexPosition;
+	gl_Position = projectionMatrix * viewMatrix * currentModelMatrix * vertexPosition;
+
+	if (material.useNormalMap)
+	{
+		vec4 T = currentModelMatrix * decodeOctahedral(vertexTangent);
+		vec4 N = currentModelMatrix * decodeOctahedral(vertexNormal);
+		vec4 B = vec4(cross(T.xyz, N.xyz), 0.0);
+		tangentMatrix = mat4(T, B, N, vec4(0,0,0,0));
+	}
+}
+
+// Decode a unit vector stored with octahedral encoding (see Mesh::createVAO()).
+vec4 decodeOctahedral(vec2 encoded)
+{
+	vec3 vector = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+
+	// Unfold the lower half of the octahedron
+	if (vector.z < 0.0)
+		vector.xy = (1.0 - abs(vector.yx)) * vec2(vector.x >= 0.0 ? 1.0 : -1.0, vector.y >= 0.0 ? 1.0 : -1.0);
+
+	return vec4(normalize(vector), 0.0);
+}
\ No newline at end of file
@@ -24,7 +24,14 @@ in float fragmentVisibility;
 out vec4 finalColor;
 
 uniform Material material;
-uniform FogDescriptor fogDescriptor;
+
+layout (std140) uniform FrameBlock
+{
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	vec4 cameraPosition;
+	FogDescriptor fogDescriptor;
+};
 
 void main()
 {
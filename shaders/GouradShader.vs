@@ -47,8 +47,9 @@ struct FogDescriptor
 };
 
 layout (location = 0) in vec4 vertexPosition;
-layout (location = 1) in vec4 vertexNormal;
+layout (location = 1) in vec2 vertexNormal;			// Octahedral encoding
 layout (location = 2) in vec2 vertexTextureCoords;
+layout (location = 4) in mat4 instanceModelMatrix;		// Instanced rendering only
 
 out vec4 ambientColor;
 out vec4 diffuseColor;
@@ -58,27 +59,44 @@ out float fragmentVisibility;
 out vec2 fragmentTextureCoords;
 
 uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projectionMatrix;
+uniform bool useInstancing;
+
+layout (std140) uniform FrameBlock
+{
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	vec4 cameraPosition;
+	FogDescriptor fogDescriptor;
+};
+
+layout (std140) uniform LightClusterBlock
+{
+	ivec4 clusterQuantity;
+	ivec4 lightQuantities;			// x: all lights, y: lights that reach every cluster
+	vec4 depthSlicing;				// slice = log(depth) * x + y
+};
+
+uniform usamplerBuffer lightDescriptors;
+uniform int entityLights[16];			// Indices of the lights selected for the entity, most intense first
+uniform int entityLightQuantity;		// -1 when all lights must be evaluated (instanced rendering)
 
-uniform LightDescriptor lights[32];
 uniform Material material;
-uniform int lightQuantity;
-uniform vec4 cameraPosition;
-uniform FogDescriptor fogDescriptor;
 
 float getFogVisibility(vec4 positionWorld);
+LightDescriptor fetchLight(int lightIndex);
 Color getFragmentColor(vec4 fragmentNormal, vec2 fragmentTextureCoords, vec4 fragmentPosition);
 Color getPointLightContribution(LightDescriptor pointLight, vec4 fragmentNormal, vec2 fragmentTextureCoords, vec4 fragmentPosition);
 Color getSpotLightContribution(LightDescriptor pointLight, vec4 fragmentNormal, vec2 fragmentTextureCoords, vec4 fragmentPosition);
 Color getDirectionalLightContribution(LightDescriptor pointLight, vec4 fragmentNormal, vec2 fragmentTextureCoords, vec4 fragmentPosition);
+vec4 decodeOctahedral(vec2 encoded);
 
 void main()
 {
-	vec3 normal3D = mat3(inverse(transpose(modelMatrix))) * vertexNormal.xyz;
+	mat4 currentModelMatrix = useInstancing ? instanceModelMatrix : modelMatrix;
+	vec3 normal3D = mat3(inverse(transpose(currentModelMatrix))) * decodeOctahedral(vertexNormal).xyz;
 	vec4 fragmentNormal = normalize(vec4(normal3D, 0.0));
-	vec4 fragmentPosition = modelMatrix * vertexPosition;
-	gl_Position = projectionMatrix * viewMatrix * modelMatrix * vertexPosition;
+	vec4 fragmentPosition = currentModelMatrix * vertexPosition;
+	gl_Position = projectionMatrix * viewMatrix * currentModelMatrix * vertexPosition;
 	
 	fragmentTextureCoords = vertexTextureCoords;
 	Color fragmentColor = getFragmentColor(fragmentNormal, fragmentTextureCoords, fragmentPosition);
@@ -96,35 +114,63 @@ float getFogVisibility(vec4 positionWorld)
 	return clamp(exp(-pow((cameraDistance * fogDescriptor.density), fogDescriptor.gradient)), 0.0, 1.0);
 }
 
+// Read the light of index lightIndex from the light descriptors buffer (seven texels per light).
+LightDescriptor fetchLight(int lightIndex)
+{
+	LightDescriptor light;
+	int firstTexel = lightIndex * 7;
+	uvec4 attenuation = texelFetch(lightDescriptors, firstTexel + 3);
+	uvec4 cutOff = texelFetch(lightDescriptors, firstTexel + 6);
+
+	light.ambientColor = uintBitsToFloat(texelFetch(lightDescriptors, firstTexel));
+	light.diffuseColor = uintBitsToFloat(texelFetch(lightDescriptors, firstTexel + 1));
+	light.specularColor = uintBitsToFloat(texelFetch(lightDescriptors, firstTexel + 2));
+	light.constantTerm = uintBitsToFloat(attenuation.x);
+	light.linearTerm = uintBitsToFloat(attenuation.y);
+	light.quadraticTerm = uintBitsToFloat(attenuation.z);
+	light.type = int(attenuation.w);
+	light.position = uintBitsToFloat(texelFetch(lightDescriptors, firstTexel + 4));
+	light.direction = uintBitsToFloat(texelFetch(lightDescriptors, firstTexel + 5));
+	light.innerCutOffAngleCos = uintBitsToFloat(cutOff.x);
+	light.outerCutOffAngleCos = uintBitsToFloat(cutOff.y);
+	light.isOn = cutOff.z != 0u;
+
+	return light;
+}
+
 Color getFragmentColor(vec4 fragmentNormal, vec2 fragmentTextureCoords, vec4 fragmentPosition)
 {
 	Color c;
 	Color resultColor = {vec4(0), vec4(0), vec4(0)};
 	int i;
+	int lightQuantity = entityLightQuantity < 0 ? lightQuantities.x : entityLightQuantity;
 
 	for (i=0; i<lightQuantity; ++i)
-		if (lights[i].isOn)
-			switch(lights[i].type)
+	{
+		LightDescriptor light = fetchLight(entityLightQuantity < 0 ? i : entityLights[i]);
+		if (light.isOn)
+			switch(light.type)
 			{
 				case LT_POINTLIGHT:
-					c = getPointLightContribution(lights[i], fragmentNormal, fragmentTextureCoords, fragmentPosition);
+					c = getPointLightContribution(light, fragmentNormal, fragmentTextureCoords, fragmentPosition);
 					resultColor.ambientColor += c.ambientColor;
 					resultColor.diffuseColor += c.diffuseColor;
 					resultColor.specularColor += c.specularColor;
 					break;
 				case LT_SPOTLIGHT:
-					c = getSpotLightContribution(lights[i], fragmentNormal, fragmentTextureCoords, fragmentPosition);
+					c = getSpotLightContribution(light, fragmentNormal, fragmentTextureCoords, fragmentPosition);
 					resultColor.ambientColor += c.ambientColor;
 					resultColor.diffuseColor += c.diffuseColor;
 					resultColor.specularColor += c.specularColor;
 					break;
 				case LT_DIRECTIONALLIGHT:
-					c = getDirectionalLightContribution(lights[i], fragmentNormal, fragmentTextureCoords, fragmentPosition);
+					c = getDirectionalLightContribution(light, fragmentNormal, fragmentTextureCoords, fragmentPosition);
 					resultColor.ambientColor += c.ambientColor;
 					resultColor.diffuseColor += c.diffuseColor;
 					resultColor.specularColor += c.specularColor;
 					break;
 			}
+	}
 
 	fragmentTextureCoords = vertexTextureCoords;
 		
@@ -226,4 +272,16 @@ Color getDirectionalLightContribution(LightDescriptor directionalLight, vec4 fra
 	directionalColor.specularColor = directionalSpecularColor;
 	
 	return directionalColor;
+}
+
+// Decode a unit vector stored with octahedral encoding (see Mesh::createVAO()).
+vec4 decodeOctahedral(vec2 encoded)
+{
+	vec3 vector = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+
+	// Unfold the lower half of the octahedron
+	if (vector.z < 0.0)
+		vector.xy = (1.0 - abs(vector.yx)) * vec2(vector.x >= 0.0 ? 1.0 : -1.0, vector.y >= 0.0 ? 1.0 : -1.0);
+
+	return vec4(normalize(vector), 0.0);
 }
\ No newline at end of file
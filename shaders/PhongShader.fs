@@ -49,13 +49,31 @@ in float fragmentVisibility;
 
 out vec4 finalColor;
 
-uniform LightDescriptor lights[32];
-uniform int lightQuantity;
+layout (std140) uniform LightClusterBlock
+{
+	ivec4 clusterQuantity;
+	ivec4 lightQuantities;			// x: all lights, y: lights that reach every cluster
+	vec4 depthSlicing;				// slice = log(depth) * x + y
+};
+
+uniform usamplerBuffer lightDescriptors;
+uniform usamplerBuffer lightClusters;		// Offset in lightIndices and quantity of lights of each cluster
+uniform usamplerBuffer lightIndices;		// Lights that reach every cluster, then the lights of each cluster
+
 uniform Material material;
-uniform vec4 cameraPosition;
-uniform FogDescriptor fogDescriptor;
+
+layout (std140) uniform FrameBlock
+{
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	vec4 cameraPosition;
+	FogDescriptor fogDescriptor;
+};
 
 vec4 getCorrectNormal();
+int getClusterIndex();
+LightDescriptor fetchLight(int lightIndex);
+vec3 getLightContribution(LightDescriptor light, vec4 normal);
 vec3 getPointLightContribution(LightDescriptor pointLight, vec4 normal);
 vec3 getSpotLightContribution(LightDescriptor pointLight, vec4 normal);
 vec3 getDirectionalLightContribution(LightDescriptor pointLight, vec4 normal);
@@ -66,22 +84,15 @@ void main()
 	vec3 resultColor = vec3(0.0, 0.0, 0.0);
 	vec4 normal = getCorrectNormal();
 	int i;
-	
-	for (i=0; i<lightQuantity; ++i)
-	//for (i=0; i<19; ++i)
-		if (lights[i].isOn)
-			switch(lights[i].type)
-			{
-				case LT_POINTLIGHT:
-					resultColor += getPointLightContribution(lights[i], normal);
-					break;
-				case LT_SPOTLIGHT:
-					resultColor += getSpotLightContribution(lights[i], normal);
-					break;
-				case LT_DIRECTIONALLIGHT:
-					resultColor += getDirectionalLightContribution(lights[i], normal);
-					break;
-			}
+
+	// Lights that reach every cluster are stored at the beginning of the index list
+	for (i=0; i<lightQuantities.y; ++i)
+		resultColor += getLightContribution(fetchLight(int(texelFetch(lightIndices, i).r)), normal);
+
+	// Only the lights whose influence touches the cluster of the fragment are evaluated
+	uvec2 cluster = texelFetch(lightClusters, getClusterIndex()).rg;
+	for (i=0; i<int(cluster.y); ++i)
+		resultColor += getLightContribution(fetchLight(int(texelFetch(lightIndices, int(cluster.x) + i).r)), normal);
 
 	finalColor = vec4(resultColor, 1.0);
 	
@@ -89,6 +100,61 @@ void main()
 		finalColor = mix(fogDescriptor.skyColor, finalColor, fragmentVisibility);
 }
 
+// Get the cluster of the fragment: the screen tile is obtained from its projected position and the depth slice
+// from its view space depth, with the same exponential slicing used to bin the lights.
+int getClusterIndex()
+{
+	vec4 viewPosition = viewMatrix * fragmentPosition;
+	vec4 clipPosition = projectionMatrix * viewPosition;
+	vec2 tileCoords = (clipPosition.xy / clipPosition.w) * 0.5 + 0.5;
+
+	int x = clamp(int(tileCoords.x * clusterQuantity.x), 0, clusterQuantity.x - 1);
+	int y = clamp(int(tileCoords.y * clusterQuantity.y), 0, clusterQuantity.y - 1);
+	int z = clamp(int(floor(log(-viewPosition.z) * depthSlicing.x + depthSlicing.y)), 0, clusterQuantity.z - 1);
+
+	return (z * clusterQuantity.y + y) * clusterQuantity.x + x;
+}
+
+// Read the light of index lightIndex from the light descriptors buffer (seven texels per light).
+LightDescriptor fetchLight(int lightIndex)
+{
+	LightDescriptor light;
+	int firstTexel = lightIndex * 7;
+	uvec4 attenuation = texelFetch(lightDescriptors, firstTexel + 3);
+	uvec4 cutOff = texelFetch(lightDescriptors, firstTexel + 6);
+
+	light.ambientColor = uintBitsToFloat(texelFetch(lightDescriptors, firstTexel));
+	light.diffuseColor = uintBitsToFloat(texelFetch(lightDescriptors, firstTexel + 1));
+	light.specularColor = uintBitsToFloat(texelFetch(lightDescriptors, firstTexel + 2));
+	light.constantTerm = uintBitsToFloat(attenuation.x);
+	light.linearTerm = uintBitsToFloat(attenuation.y);
+	light.quadraticTerm = uintBitsToFloat(attenuation.z);
+	light.type = int(attenuation.w);
+	light.position = uintBitsToFloat(texelFetch(lightDescriptors, firstTexel + 4));
+	light.direction = uintBitsToFloat(texelFetch(lightDescriptors, firstTexel + 5));
+	light.innerCutOffAngleCos = uintBitsToFloat(cutOff.x);
+	light.outerCutOffAngleCos = uintBitsToFloat(cutOff.y);
+	light.isOn = cutOff.z != 0u;
+
+	return light;
+}
+
+// Only lights that are on are binned, so isOn is not checked here.
+vec3 getLightContribution(LightDescriptor light, vec4 normal)
+{
+	switch(light.type)
+	{
+		case LT_POINTLIGHT:
+			return getPointLightContribution(light, normal);
+		case LT_SPOTLIGHT:
+			return getSpotLightContribution(light, normal);
+		case LT_DIRECTIONALLIGHT:
+			return getDirectionalLightContribution(light, normal);
+	}
+
+	return vec3(0.0);
+}
+
 vec4 getCorrectNormal()
 {
 	vec4 normal;
@@ -101,6 +167,8 @@ vec4 getCorrectNormal()
 		normal = texture(material.normalMap, fragmentTextureCoords);
 		// Transform normal vector to range [-1, 1]
 		normal = normal * 2.0 - 1.0;
+		// Only X and Y are stored (BC5 normal maps), Z is reconstructed
+		normal.z = sqrt(max(1.0 - dot(normal.xy, normal.xy), 0.0));
 		// W coordinate must be 0
 		normal.w = 0;
 		// Normalize normal
@@ -1,11 +1,24 @@
 #version 330 core
 
+struct FogDescriptor
+{
+	float density;
+	float gradient;
+	vec4 skyColor;
+	bool on;
+};
+
 layout (location = 0) in vec4 vertexPosition;
 
 out vec3 fragmentTextureCoords;
 
-uniform mat4 viewMatrix;
-uniform mat4 projectionMatrix;
+layout (std140) uniform FrameBlock
+{
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	vec4 cameraPosition;
+	FogDescriptor fogDescriptor;
+};
 
 void main()
 {
@@ -1,5 +1,13 @@
 #version 330 core
 
+struct FogDescriptor
+{
+	float density;
+	float gradient;
+	vec4 skyColor;
+	bool on;
+};
+
 layout (location = 0) in vec4 vertexPosition;
 layout (location = 1) in vec4 vertexNormal;
 layout (location = 2) in vec2 vertexTextureCoords;
@@ -7,8 +15,14 @@ layout (location = 2) in vec2 vertexTextureCoords;
 out vec2 fragmentTextureCoords;
 
 uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projectionMatrix;
+
+layout (std140) uniform FrameBlock
+{
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	vec4 cameraPosition;
+	FogDescriptor fogDescriptor;
+};
 
 void main()
 {
@@ -216,6 +216,53 @@ void Camera::recalculateViewMatrix()
 		w.x, w.y, w.z, -glm::dot(w, worldToCameraVec),
 		0.0f, 0.0f, 0.0f, 1.0f
 	}));
+
+	this->recalculateFrustum();
+}
+
+// This function will recalculate the frustum planes from the view and projection matrices.
+// Each plane is a sum or a difference between the fourth row of (projection * view) and one of the other rows.
+// Called whenever one of the matrices changes. The result is stored in this->frustum.
+void Camera::recalculateFrustum()
+{
+	glm::mat4 viewProjectionMatrix = this->getProjectionMatrix() * this->viewMatrix;
+	glm::vec4 row[4];
+
+	for (unsigned int i = 0; i < 4; ++i)
+		row[i] = glm::vec4(viewProjectionMatrix[0][i], viewProjectionMatrix[1][i], viewProjectionMatrix[2][i],
+			viewProjectionMatrix[3][i]);
+
+	this->frustum.planes[0] = row[3] + row[0];
+	this->frustum.planes[1] = row[3] - row[0];
+	this->frustum.planes[2] = row[3] + row[1];
+	this->frustum.planes[3] = row[3] - row[1];
+	this->frustum.planes[4] = row[3] + row[2];
+	this->frustum.planes[5] = row[3] - row[2];
+
+	for (unsigned int i = 0; i < 6; ++i)
+	{
+		float normalLength = glm::length(glm::vec3(this->frustum.planes[i]));
+		if (normalLength > 0.0f)
+			this->frustum.planes[i] /= normalLength;
+	}
+}
+
+// Test an axis-aligned box, given in world coordinates by its center and its half extent, against the frustum.
+// Returns false only if the box is completely outside of one of the planes, so boxes near the corners of the
+// frustum may be reported as inside.
+bool Camera::isBoxInsideFrustum(const glm::vec3& center, const glm::vec3& extent) const
+{
+	for (unsigned int i = 0; i < 6; ++i)
+	{
+		glm::vec3 normal = glm::vec3(this->frustum.planes[i]);
+		float distance = glm::dot(normal, center) + this->frustum.planes[i].w;
+		float radius = glm::dot(extent, glm::abs(normal));
+
+		if (distance < -radius)
+			return false;
+	}
+
+	return true;
 }
 
 bool Camera::isUsingFog() const
@@ -297,6 +344,7 @@ void PerspectiveCamera::recalculateProjectionMatrix()
 	}));
 
 	this->projectionMatrix = -M * P;
+	this->recalculateFrustum();
 }
 
 // ORTHOGRAPHIC CAMERA
@@ -355,4 +403,5 @@ void OrthographicCamera::recalculateProjectionMatrix()
 	}));
 
 	this->projectionMatrix = M;
+	this->recalculateFrustum();
 }
\ No newline at end of file
@@ -11,6 +11,13 @@ namespace raw
 		glm::vec4 skyColor;
 	};
 
+	// The six planes that bound the view volume of a camera, in world coordinates. Each plane is stored as
+	// (normal, distance), with the normal pointing to the inside of the volume.
+	struct Frustum
+	{
+		glm::vec4 planes[6];
+	};
+
 	class Camera
 	{
 	public:
@@ -44,12 +51,14 @@ namespace raw
 		void setUseFog(bool useFog);
 		FogDescriptor getFogDescriptor() const;
 		void setFogDescriptor(const FogDescriptor& fogDescriptor);
+		bool isBoxInsideFrustum(const glm::vec3& center, const glm::vec3& extent) const;
 	protected:
 		void recalculateView();
 		void recalculateAngles();
 		void truncateAngles();
 		void recalculateViewMatrix();
 		virtual void recalculateProjectionMatrix() = 0;
+		void recalculateFrustum();
 		glm::vec4 position;
 		glm::vec4 up;
 		glm::vec4 view;
@@ -65,6 +74,7 @@ namespace raw
 		glm::mat4 viewMatrix;
 		bool useFog;
 		FogDescriptor fogDescriptor;
+		Frustum frustum;
 	};
 
 	class PerspectiveCamera : public Camera
@@ -1,5 +1,9 @@
 #include "Collision.h"
+#include "MapWallAccelerationStructure.h"
+#include "WorkerPool.h"
 #include <vector>
+#include <emmintrin.h>
+#include <cfloat>
 
 using namespace raw;
 
@@ -7,46 +11,77 @@ using namespace raw;
 CollisionDescriptor Collision::getClosestWallRayIsColliding(glm::vec4 rayPosition, glm::vec4 rayDirection,
 	const std::vector<MapWallDescriptor>& mapWallDescriptors)
 {
-	std::vector<glm::vec4> wallCollisions;
+	CollisionDescriptor collisionDescriptor;
+	float nearestPositionDistance;
+
+	collisionDescriptor.collide = false;
 
 	for (unsigned int i = 0; i < mapWallDescriptors.size(); ++i)
 	{
-		CollisionDescriptor collisionDescriptor = Collision::isRayCollidingWithWall(rayPosition, rayDirection,
+		CollisionDescriptor currentCollisionDescriptor = Collision::isRayCollidingWithWall(rayPosition, rayDirection,
 			mapWallDescriptors[i]);
 
-		if (collisionDescriptor.collide)
-			wallCollisions.push_back(collisionDescriptor.worldPosition);
-	}
-
-	// Find nearest collide position
-	CollisionDescriptor collisionDescriptor;
-
-	if (wallCollisions.size() > 0)
-	{
-		glm::vec4 nearestPosition = wallCollisions[0];
-		float nearestPositionDistance = glm::length(rayPosition - nearestPosition);
-
-		for (unsigned int i = 1; i < wallCollisions.size(); ++i)
+		if (currentCollisionDescriptor.collide)
 		{
-			glm::vec4 currentPosition = wallCollisions[i];
-			float currentPositionDistance = glm::length(rayPosition - currentPosition);
+			// Find nearest collide position
+			float currentPositionDistance = glm::length(rayPosition - currentCollisionDescriptor.worldPosition);
 
-			if (currentPositionDistance < nearestPositionDistance)
+			if (!collisionDescriptor.collide || currentPositionDistance < nearestPositionDistance)
 			{
-				nearestPosition = currentPosition;
+				collisionDescriptor = currentCollisionDescriptor;
 				nearestPositionDistance = currentPositionDistance;
 			}
 		}
-
-		collisionDescriptor.collide = true;
-		collisionDescriptor.worldPosition = nearestPosition;
 	}
-	else
-		collisionDescriptor.collide = false;
 
 	return collisionDescriptor;
 }
 
+// Test ray-wall collision using an acceleration structure built over the map walls.
+CollisionDescriptor Collision::getClosestWallRayIsColliding(glm::vec4 rayPosition, glm::vec4 rayDirection,
+	const MapWallAccelerationStructure& mapWallAccelerationStructure)
+{
+	return mapWallAccelerationStructure.getClosestWallRayIsColliding(rayPosition, rayDirection);
+}
+
+// Rays handled by a worker at a time in the batch ray-cast.
+static const unsigned int raysPerBatch = 32;
+
+struct RayBatchTaskData
+{
+	const RayDescriptor* rays;
+	const MapWallAccelerationStructure* mapWallAccelerationStructure;
+	CollisionDescriptor* collisionDescriptors;
+};
+
+static void rayBatchTask(void* taskData, unsigned int begin, unsigned int end)
+{
+	RayBatchTaskData* rayBatchTaskData = (RayBatchTaskData*)taskData;
+
+	for (unsigned int i = begin; i < end; ++i)
+		rayBatchTaskData->collisionDescriptors[i] =
+			rayBatchTaskData->mapWallAccelerationStructure->getClosestWallRayIsColliding(rayBatchTaskData->rays[i].position,
+			rayBatchTaskData->rays[i].direction);
+}
+
+// Find the closest wall hit by each ray. Results are written in collisionDescriptors, which must have room for
+// rayQuantity descriptors. If a worker pool is received the rays are split among its threads,
+// otherwise they are all tested in the calling thread.
+void Collision::getClosestWallsRaysAreColliding(const RayDescriptor* rays, unsigned int rayQuantity,
+	const MapWallAccelerationStructure& mapWallAccelerationStructure, CollisionDescriptor* collisionDescriptors,
+	WorkerPool* workerPool)
+{
+	RayBatchTaskData rayBatchTaskData;
+	rayBatchTaskData.rays = rays;
+	rayBatchTaskData.mapWallAccelerationStructure = &mapWallAccelerationStructure;
+	rayBatchTaskData.collisionDescriptors = collisionDescriptors;
+
+	if (workerPool)
+		workerPool->run(rayBatchTask, &rayBatchTaskData, rayQuantity, raysPerBatch);
+	else
+		rayBatchTask(&rayBatchTaskData, 0, rayQuantity);
+}
+
 CollisionDescriptor Collision::isRayCollidingWithWall(glm::vec4 rayPosition, glm::vec4 rayDirection, const MapWallDescriptor& mapWallDescriptor)
 {
 	CollisionDescriptor collisionDescriptor;
@@ -85,59 +120,268 @@ CollisionDescriptor Collision::isRayCollidingWithWall(glm::vec4 rayPosition, glm
 	return collisionDescriptor;
 }
 
-PlayerCollisionDescriptor Collision::isRayCollidingWithBoundingBox(glm::vec4 rayPosition,
-	glm::vec4 rayDirection, glm::vec4 rayXAxis, glm::vec4 rayYAxis, std::vector<BoundingShape>& boundingBox)
+// Test the ray against four walls at once. This is the SSE version of isRayCollidingWithWall: every operation is
+// done in the same order as the scalar version, so the results are exactly the same.
+// Fills four collision descriptors and the ray parameter (d) of each intersection. Returns a mask of colliding lanes.
+int Collision::isRayCollidingWithWallPacket(glm::vec4 rayPosition, glm::vec4 rayDirection,
+	const MapWallPacket& mapWallPacket, CollisionDescriptor* collisionDescriptors, float* rayParameters)
 {
-	// Normalize vectors
-	rayDirection = glm::normalize(rayDirection);
-	rayXAxis = glm::normalize(rayXAxis);
-	rayYAxis = glm::normalize(rayYAxis);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+
+	__m128 normalX = _mm_loadu_ps(mapWallPacket.normalX);
+	__m128 normalY = _mm_loadu_ps(mapWallPacket.normalY);
+	__m128 normalZ = _mm_loadu_ps(mapWallPacket.normalZ);
+	__m128 normalW = _mm_loadu_ps(mapWallPacket.normalW);
+	__m128 centerX = _mm_loadu_ps(mapWallPacket.centerX);
+	__m128 centerY = _mm_loadu_ps(mapWallPacket.centerY);
+	__m128 centerZ = _mm_loadu_ps(mapWallPacket.centerZ);
+	__m128 centerW = _mm_loadu_ps(mapWallPacket.centerW);
+
+	__m128 rayPositionX = _mm_set1_ps(rayPosition.x);
+	__m128 rayPositionY = _mm_set1_ps(rayPosition.y);
+	__m128 rayPositionZ = _mm_set1_ps(rayPosition.z);
+	__m128 rayPositionW = _mm_set1_ps(rayPosition.w);
+	__m128 rayDirectionX = _mm_set1_ps(rayDirection.x);
+	__m128 rayDirectionY = _mm_set1_ps(rayDirection.y);
+	__m128 rayDirectionZ = _mm_set1_ps(rayDirection.z);
+	__m128 rayDirectionW = _mm_set1_ps(rayDirection.w);
+
+	// glm::dot(a, b) is (a.x*b.x + a.y*b.y) + (a.z*b.z + a.w*b.w)
+	__m128 rayWallDot = _mm_add_ps(
+		_mm_add_ps(_mm_mul_ps(rayDirectionX, normalX), _mm_mul_ps(rayDirectionY, normalY)),
+		_mm_add_ps(_mm_mul_ps(rayDirectionZ, normalZ), _mm_mul_ps(rayDirectionW, normalW)));
+
+	__m128 centerDot = _mm_add_ps(
+		_mm_add_ps(_mm_mul_ps(_mm_sub_ps(centerX, rayPositionX), normalX),
+			_mm_mul_ps(_mm_sub_ps(centerY, rayPositionY), normalY)),
+		_mm_add_ps(_mm_mul_ps(_mm_sub_ps(centerZ, rayPositionZ), normalZ),
+			_mm_mul_ps(_mm_sub_ps(centerW, rayPositionW), normalW)));
 
-	// Create View Ray Bounding Shape
-	BoundingShape viewRayBoundingShape;
+	__m128 d = _mm_div_ps(centerDot, rayWallDot);
 
-	vec3 viewRayVertices[8];
+	__m128 pointOfIntersectionX = _mm_add_ps(_mm_mul_ps(d, rayDirectionX), rayPositionX);
+	__m128 pointOfIntersectionY = _mm_add_ps(_mm_mul_ps(d, rayDirectionY), rayPositionY);
+	__m128 pointOfIntersectionZ = _mm_add_ps(_mm_mul_ps(d, rayDirectionZ), rayPositionZ);
+	__m128 pointOfIntersectionW = _mm_add_ps(_mm_mul_ps(d, rayDirectionW), rayPositionW);
 
-	float epsilon = 0.0001f;
-	float rayLength = 30.0f;
+	// Ray not parallel to wall and wall in front of the ray
+	__m128 collisionMask = _mm_and_ps(_mm_cmpneq_ps(rayWallDot, zero), _mm_cmpgt_ps(d, zero));
 
-	glm::vec4 prismVertices[8];
+	// Inside the wall limits
+	__m128 halfXLength = _mm_loadu_ps(mapWallPacket.halfXLength);
+	__m128 halfYLength = _mm_loadu_ps(mapWallPacket.halfYLength);
+	__m128 halfZLength = _mm_loadu_ps(mapWallPacket.halfZLength);
 
-	prismVertices[0] = rayPosition + (0.0f * rayDirection - epsilon * rayXAxis - epsilon * rayYAxis);
-	prismVertices[1] = rayPosition + (0.0f * rayDirection - epsilon * rayXAxis + epsilon * rayYAxis);
-	prismVertices[2] = rayPosition + (0.0f * rayDirection + epsilon * rayXAxis - epsilon * rayYAxis);
-	prismVertices[3] = rayPosition + (0.0f * rayDirection + epsilon * rayXAxis + epsilon * rayYAxis);
-	prismVertices[4] = rayPosition + (rayLength * rayDirection - epsilon * rayXAxis - epsilon * rayYAxis);
-	prismVertices[5] = rayPosition + (rayLength * rayDirection - epsilon * rayXAxis + epsilon * rayYAxis);
-	prismVertices[6] = rayPosition + (rayLength * rayDirection + epsilon * rayXAxis - epsilon * rayYAxis);
-	prismVertices[7] = rayPosition + (rayLength * rayDirection + epsilon * rayXAxis + epsilon * rayYAxis);
+	collisionMask = _mm_and_ps(collisionMask, _mm_or_ps(_mm_cmpeq_ps(halfXLength, zero),
+		_mm_cmpge_ps(halfXLength, _mm_and_ps(_mm_sub_ps(pointOfIntersectionX, centerX), absMask))));
+	collisionMask = _mm_and_ps(collisionMask, _mm_or_ps(_mm_cmpeq_ps(halfYLength, zero),
+		_mm_cmpge_ps(halfYLength, _mm_and_ps(_mm_sub_ps(pointOfIntersectionY, centerY), absMask))));
+	collisionMask = _mm_and_ps(collisionMask, _mm_or_ps(_mm_cmpeq_ps(halfZLength, zero),
+		_mm_cmpge_ps(halfZLength, _mm_and_ps(_mm_sub_ps(pointOfIntersectionZ, centerZ), absMask))));
 
-	viewRayVertices[0] = vec3(prismVertices[0].x, prismVertices[0].y, prismVertices[0].z);
-	viewRayVertices[1] = vec3(prismVertices[1].x, prismVertices[1].y, prismVertices[1].z);
-	viewRayVertices[2] = vec3(prismVertices[2].x, prismVertices[2].y, prismVertices[2].z);
-	viewRayVertices[3] = vec3(prismVertices[3].x, prismVertices[3].y, prismVertices[3].z);
-	viewRayVertices[4] = vec3(prismVertices[4].x, prismVertices[4].y, prismVertices[4].z);
-	viewRayVertices[5] = vec3(prismVertices[5].x, prismVertices[5].y, prismVertices[5].z);
-	viewRayVertices[6] = vec3(prismVertices[6].x, prismVertices[6].y, prismVertices[6].z);
-	viewRayVertices[7] = vec3(prismVertices[7].x, prismVertices[7].y, prismVertices[7].z);
+	float x[4], y[4], z[4], w[4];
+	_mm_storeu_ps(x, pointOfIntersectionX);
+	_mm_storeu_ps(y, pointOfIntersectionY);
+	_mm_storeu_ps(z, pointOfIntersectionZ);
+	_mm_storeu_ps(w, pointOfIntersectionW);
+	_mm_storeu_ps(rayParameters, d);
 
-	viewRayBoundingShape.vertices = viewRayVertices;
-	viewRayBoundingShape.num_vertices = 8;
+	int collisionBits = _mm_movemask_ps(collisionMask);
 
+	for (unsigned int i = 0; i < 4; ++i)
+	{
+		collisionDescriptors[i].collide = (collisionBits & (1 << i)) != 0;
+		collisionDescriptors[i].worldPosition = glm::vec4(x[i], y[i], z[i], w[i]);
+	}
+
+	return collisionBits;
+}
+
+// Test the ray against every part of the bounding box and return the closest part hit.
+// The ray is first tested against a sphere around the whole bounding box, so most misses are cheap.
+PlayerCollisionDescriptor Collision::isRayCollidingWithBoundingBox(glm::vec4 rayPosition, glm::vec4 rayDirection,
+	const std::vector<BoundingShape>& boundingBox, const std::vector<BoundingShapeFaces>& boundingBoxFaces,
+	const BoundingSphere& boundingSphere)
+{
 	PlayerCollisionDescriptor playerCollisionDescriptor;
+	playerCollisionDescriptor.collision.collide = false;
+
+	// Normalize direction, so the ray parameter is the distance
+	rayDirection = glm::normalize(rayDirection);
+
+	if (!Collision::isRayCollidingWithSphere(rayPosition, rayDirection, boundingSphere))
+		return playerCollisionDescriptor;
 
-	// @TODO: check which part is closer to the fire to avoid bugs!!
 	for (unsigned int i = 0; i < boundingBox.size(); ++i)
-		if (gjk_collides(&boundingBox[i], &viewRayBoundingShape))
+	{
+		float distance;
+
+		if (Collision::isRayCollidingWithConvexHull(rayPosition, rayDirection, boundingBox[i], boundingBoxFaces[i],
+			&distance))
 		{
-			playerCollisionDescriptor.bodyPart = Player::getBoundingBoxBodyPart(i);
-			playerCollisionDescriptor.collision.collide = true;
-			// This is an approximation.
-			playerCollisionDescriptor.collision.worldPosition = rayPosition;
-			return playerCollisionDescriptor;
+			if (!playerCollisionDescriptor.collision.collide || distance < playerCollisionDescriptor.distance)
+			{
+				playerCollisionDescriptor.collision.collide = true;
+				playerCollisionDescriptor.bodyPart = Player::getBoundingBoxBodyPart(i);
+				playerCollisionDescriptor.distance = distance;
+			}
 		}
+	}
 
-	playerCollisionDescriptor.collision.collide = false;
+	if (playerCollisionDescriptor.collision.collide)
+		playerCollisionDescriptor.collision.worldPosition = rayPosition + playerCollisionDescriptor.distance * rayDirection;
 
 	return playerCollisionDescriptor;
-}
\ No newline at end of file
+}
+
+// Clip the ray against the planes of each hull face. The ray is inside the hull between the last plane it enters
+// and the first plane it leaves. If the ray starts inside the hull, the distance is zero.
+bool Collision::isRayCollidingWithConvexHull(glm::vec4 rayPosition, glm::vec4 rayDirection,
+	const BoundingShape& boundingShape, const BoundingShapeFaces& boundingShapeFaces, float* distance)
+{
+	glm::vec3 position = glm::vec3(rayPosition);
+	glm::vec3 direction = glm::vec3(rayDirection);
+	float tEnter = 0.0f;
+	float tExit = FLT_MAX;
+
+	for (unsigned int i = 0; i + 2 < boundingShapeFaces.vertexIndexes.size(); i += 3)
+	{
+		const vec3& v0 = boundingShape.vertices[boundingShapeFaces.vertexIndexes[i]];
+		const vec3& v1 = boundingShape.vertices[boundingShapeFaces.vertexIndexes[i + 1]];
+		const vec3& v2 = boundingShape.vertices[boundingShapeFaces.vertexIndexes[i + 2]];
+		glm::vec3 a = glm::vec3(v0.x, v0.y, v0.z);
+		glm::vec3 b = glm::vec3(v1.x, v1.y, v1.z);
+		glm::vec3 c = glm::vec3(v2.x, v2.y, v2.z);
+
+		// Outward normal. Points p inside the hull satisfy dot(normal, p - a) <= 0
+		glm::vec3 normal = glm::cross(b - a, c - a);
+		float rayFaceDot = glm::dot(normal, direction);
+		float distanceToPlane = glm::dot(normal, a - position);
+
+		if (rayFaceDot == 0.0f)
+		{
+			// Ray parallel to face and outside it
+			if (distanceToPlane < 0.0f)
+				return false;
+		}
+		else
+		{
+			float t = distanceToPlane / rayFaceDot;
+
+			if (rayFaceDot < 0.0f)
+				tEnter = glm::max(tEnter, t);		// Entering the plane
+			else
+				tExit = glm::min(tExit, t);			// Leaving the plane
+
+			if (tEnter > tExit)
+				return false;
+		}
+	}
+
+	*distance = tEnter;
+	return true;
+}
+
+// Test if the ray hits the sphere in front of the ray position. The ray direction must be normalized.
+bool Collision::isRayCollidingWithSphere(glm::vec4 rayPosition, glm::vec4 rayDirection,
+	const BoundingSphere& boundingSphere)
+{
+	glm::vec3 toCenter = glm::vec3(boundingSphere.center - rayPosition);
+	float radiusSquared = boundingSphere.radius * boundingSphere.radius;
+	float centerProjection = glm::dot(toCenter, glm::vec3(rayDirection));
+	float centerDistanceSquared = glm::dot(toCenter, toCenter);
+
+	// Sphere behind the ray
+	if (centerProjection < 0.0f && centerDistanceSquared > radiusSquared)
+		return false;
+
+	return centerDistanceSquared - centerProjection * centerProjection <= radiusSquared;
+}
+
+// Find the faces of the convex hull of the shape vertices. Every vertex triple whose plane leaves all
+// vertices on one side is a hull face; coplanar triples are only stored once.
+// Bounding shapes have a few dozen vertices, so the brute force is cheap and only done at load time.
+BoundingShapeFaces Collision::getConvexHullFaces(const BoundingShape& boundingShape)
+{
+	BoundingShapeFaces boundingShapeFaces;
+	std::vector<unsigned int> uniqueVertices;
+	std::vector<glm::vec4> facePlanes;
+	const float epsilon = 0.0001f;
+
+	// Meshes duplicate vertices per face, ignore repeated positions
+	for (int i = 0; i < boundingShape.num_vertices; ++i)
+	{
+		bool repeated = false;
+		const vec3& v = boundingShape.vertices[i];
+
+		for (unsigned int j = 0; j < uniqueVertices.size() && !repeated; ++j)
+		{
+			const vec3& u = boundingShape.vertices[uniqueVertices[j]];
+			repeated = fabsf(v.x - u.x) < epsilon && fabsf(v.y - u.y) < epsilon && fabsf(v.z - u.z) < epsilon;
+		}
+
+		if (!repeated)
+			uniqueVertices.push_back(i);
+	}
+
+	std::vector<glm::vec3> points;
+
+	for (unsigned int i = 0; i < uniqueVertices.size(); ++i)
+	{
+		const vec3& v = boundingShape.vertices[uniqueVertices[i]];
+		points.push_back(glm::vec3(v.x, v.y, v.z));
+	}
+
+	for (unsigned int i = 0; i < points.size(); ++i)
+		for (unsigned int j = i + 1; j < points.size(); ++j)
+			for (unsigned int k = j + 1; k < points.size(); ++k)
+			{
+				glm::vec3 normal = glm::cross(points[j] - points[i], points[k] - points[i]);
+				float normalLength = glm::length(normal);
+
+				if (normalLength < epsilon * epsilon)
+					continue;
+
+				normal = normal / normalLength;
+
+				bool hasPointsInFront = false;
+				bool hasPointsBehind = false;
+
+				for (unsigned int l = 0; l < points.size(); ++l)
+				{
+					float side = glm::dot(normal, points[l] - points[i]);
+
+					if (side > epsilon)
+						hasPointsInFront = true;
+					else if (side < -epsilon)
+						hasPointsBehind = true;
+				}
+
+				// Not a hull face
+				if (hasPointsInFront && hasPointsBehind)
+					continue;
+
+				// Make the normal point outwards
+				bool flip = hasPointsInFront;
+
+				if (flip)
+					normal = -normal;
+
+				glm::vec4 plane = glm::vec4(normal, glm::dot(normal, points[i]));
+				bool repeated = false;
+
+				for (unsigned int l = 0; l < facePlanes.size() && !repeated; ++l)
+					repeated = glm::length(facePlanes[l] - plane) < epsilon;
+
+				if (repeated)
+					continue;
+
+				facePlanes.push_back(plane);
+				boundingShapeFaces.vertexIndexes.push_back(uniqueVertices[i]);
+				boundingShapeFaces.vertexIndexes.push_back(uniqueVertices[flip ? k : j]);
+				boundingShapeFaces.vertexIndexes.push_back(uniqueVertices[flip ? j : k]);
+			}
+
+	return boundingShapeFaces;
+}
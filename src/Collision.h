@@ -6,16 +6,26 @@
 
 namespace raw
 {
+	class MapWallAccelerationStructure;
+	class WorkerPool;
+
 	struct CollisionDescriptor
 	{
 		bool collide;
 		glm::vec4 worldPosition;
 	};
 
+	struct RayDescriptor
+	{
+		glm::vec4 position;
+		glm::vec4 direction;
+	};
+
 	struct PlayerCollisionDescriptor
 	{
 		CollisionDescriptor collision;
 		PlayerBodyPart bodyPart;
+		float distance;
 	};
 
 	class Collision
@@ -23,9 +33,22 @@ namespace raw
 	public:
 		static CollisionDescriptor getClosestWallRayIsColliding(glm::vec4 rayPosition, glm::vec4 rayDirection,
 			const std::vector<MapWallDescriptor>& mapWallDescriptors);
+		static CollisionDescriptor getClosestWallRayIsColliding(glm::vec4 rayPosition, glm::vec4 rayDirection,
+			const MapWallAccelerationStructure& mapWallAccelerationStructure);
+		static void getClosestWallsRaysAreColliding(const RayDescriptor* rays, unsigned int rayQuantity,
+			const MapWallAccelerationStructure& mapWallAccelerationStructure, CollisionDescriptor* collisionDescriptors,
+			WorkerPool* workerPool);
 		static CollisionDescriptor isRayCollidingWithWall(glm::vec4 rayPosition, glm::vec4 rayDirection,
 			const MapWallDescriptor& mapWallDescriptor);
-		static PlayerCollisionDescriptor isRayCollidingWithBoundingBox(glm::vec4 rayPosition,
-			glm::vec4 rayDirection, glm::vec4 rayXAxis, glm::vec4 rayYAxis, std::vector<BoundingShape>& boundingBox);
+		static int isRayCollidingWithWallPacket(glm::vec4 rayPosition, glm::vec4 rayDirection,
+			const MapWallPacket& mapWallPacket, CollisionDescriptor* collisionDescriptors, float* rayParameters);
+		static PlayerCollisionDescriptor isRayCollidingWithBoundingBox(glm::vec4 rayPosition, glm::vec4 rayDirection,
+			const std::vector<BoundingShape>& boundingBox, const std::vector<BoundingShapeFaces>& boundingBoxFaces,
+			const BoundingSphere& boundingSphere);
+		static bool isRayCollidingWithConvexHull(glm::vec4 rayPosition, glm::vec4 rayDirection,
+			const BoundingShape& boundingShape, const BoundingShapeFaces& boundingShapeFaces, float* distance);
+		static bool isRayCollidingWithSphere(glm::vec4 rayPosition, glm::vec4 rayDirection,
+			const BoundingSphere& boundingSphere);
+		static BoundingShapeFaces getConvexHullFaces(const BoundingShape& boundingShape);
 	};
 }
\ No newline at end of file
@@ -0,0 +1,255 @@
+#include "DeferredRenderer.h"
+#include "RenderStatistics.h"
+#include <iostream>
+#include <cmath>
+#include <cstring>
+
+using namespace raw;
+
+// Formats of the G-buffer attachments: position, normal (and shineness), albedo and specular.
+// Positions are in world coordinates, so they need full float precision.
+static const GLenum gBufferInternalFormats[4] = { GL_RGBA32F, GL_RGBA16F, GL_RGBA8, GL_RGBA8 };
+static const GLenum gBufferTypes[4] = { GL_FLOAT, GL_FLOAT, GL_UNSIGNED_BYTE, GL_UNSIGNED_BYTE };
+static const GLint gBufferTextureUnits[4] = { gBufferPositionTextureUnit, gBufferNormalTextureUnit,
+	gBufferAlbedoTextureUnit, gBufferSpecularTextureUnit };
+
+// Quad covering the whole screen, drawn as a triangle strip.
+static const GLfloat screenQuadVertices[] = {
+	-1.0f, -1.0f, 0.0f, 1.0f,
+	1.0f, -1.0f, 0.0f, 1.0f,
+	-1.0f, 1.0f, 0.0f, 1.0f,
+	1.0f, 1.0f, 0.0f, 1.0f
+};
+
+// Create the light shader and the screen quad. The G-buffer is created by the first geometry pass, when the size
+// of the window is known.
+DeferredRenderer::DeferredRenderer()
+{
+	this->lightShader = new Shader(ShaderType::DEFERRED_LIGHT);
+	this->frameBuffer = 0;
+	this->width = 0;
+	this->height = 0;
+
+	glGenVertexArrays(1, &this->screenQuadVAO);
+	glGenBuffers(1, &this->screenQuadVBO);
+	glBindVertexArray(this->screenQuadVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, this->screenQuadVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(screenQuadVertices), screenQuadVertices, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (void*)0);
+	glEnableVertexAttribArray(0);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+DeferredRenderer::~DeferredRenderer()
+{
+	this->destroyGBuffer();
+	glDeleteBuffers(1, &this->screenQuadVBO);
+	glDeleteVertexArrays(1, &this->screenQuadVAO);
+	delete this->lightShader;
+}
+
+// Create the frame buffer of the G-buffer, with one texture per attachment and a depth/stencil render buffer.
+// The depth format matches the usual default frame buffer, so the depth can be copied to it by endGeometryPass().
+void DeferredRenderer::createGBuffer(unsigned int width, unsigned int height)
+{
+	static const GLenum drawBuffers[4] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2,
+		GL_COLOR_ATTACHMENT3 };
+
+	this->width = width;
+	this->height = height;
+
+	glGenFramebuffers(1, &this->frameBuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, this->frameBuffer);
+
+	glGenTextures(4, this->gBufferTextures);
+	for (unsigned int i = 0; i < 4; ++i)
+	{
+		glBindTexture(GL_TEXTURE_2D, this->gBufferTextures[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, gBufferInternalFormats[i], width, height, 0, GL_RGBA, gBufferTypes[i], 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, drawBuffers[i], GL_TEXTURE_2D, this->gBufferTextures[i], 0);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenRenderbuffers(1, &this->depthRenderBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, this->depthRenderBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, this->depthRenderBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glDrawBuffers(4, drawBuffers);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "Error creating G-buffer: frame buffer is not complete" << std::endl;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void DeferredRenderer::destroyGBuffer()
+{
+	if (this->frameBuffer == 0)
+		return;
+
+	glDeleteRenderbuffers(1, &this->depthRenderBuffer);
+	glDeleteTextures(4, this->gBufferTextures);
+	glDeleteFramebuffers(1, &this->frameBuffer);
+	this->frameBuffer = 0;
+}
+
+// Bind and clear the G-buffer. The lit entities must then be rendered with the DEFERRED shader.
+// The G-buffer is recreated whenever the size of the window changes.
+void DeferredRenderer::beginGeometryPass(const Camera& camera)
+{
+	static const GLfloat clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+	if (camera.getWindowWidth() != this->width || camera.getWindowHeight() != this->height)
+	{
+		this->destroyGBuffer();
+		this->createGBuffer(camera.getWindowWidth(), camera.getWindowHeight());
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, this->frameBuffer);
+	for (GLint i = 0; i < 4; ++i)
+		glClearBufferfv(GL_COLOR, i, clearColor);
+	glClearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0);
+	RenderStatistics::addGLCalls(6);
+}
+
+// Go back to the default frame buffer, copying the depth of the G-buffer to it, so the entities rendered after the
+// light pass are hidden by the geometry of the G-buffer.
+void DeferredRenderer::endGeometryPass() const
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, this->frameBuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, this->width, this->height, 0, 0, this->width, this->height, GL_DEPTH_BUFFER_BIT,
+		GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	RenderStatistics::addGLCalls(4);
+}
+
+// Shade the pixels of the G-buffer into the default frame buffer.
+// A base pass first replaces the pixels covered by geometry with the fog color, then each light that is on adds its
+// contribution. The light descriptors are read from the buffer filled by LightClusterBuffer::update(), so the
+// lights vector must be the same one.
+void DeferredRenderer::renderLights(const std::vector<Light*>& lights, const Camera& camera) const
+{
+	GLint lightIndexLocation = this->lightShader->getUniformLocation(ShaderUniform::LIGHT_INDEX);
+	GLint fullScreenRectangle[4] = { 0, 0, (GLint)this->width, (GLint)this->height };
+	LightShaderDescriptor descriptor = {};
+
+	this->lightShader->useProgram();
+	for (unsigned int i = 0; i < 4; ++i)
+	{
+		glActiveTexture(GL_TEXTURE0 + gBufferTextureUnits[i]);
+		glBindTexture(GL_TEXTURE_2D, this->gBufferTextures[i]);
+	}
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+	RenderStatistics::addGLCalls(10);
+
+	glUniform1i(lightIndexLocation, -1);
+	this->renderScreenQuad();
+
+	glBlendFunc(GL_ONE, GL_ONE);
+	glEnable(GL_BLEND);
+	glEnable(GL_SCISSOR_TEST);
+	RenderStatistics::addGLCalls(3);
+
+	for (unsigned int i = 0; i < lights.size(); ++i)
+	{
+		if (!lights[i]->isOn())
+			continue;
+
+		GLint rectangle[4];
+		float radius = lights[i]->getInfluenceRadius();
+
+		if (radius < 0.0f)
+			memcpy(rectangle, fullScreenRectangle, sizeof(rectangle));
+		else
+		{
+			lights[i]->fillShaderDescriptor(descriptor);
+			if (!this->getScissorRectangle(glm::vec3(descriptor.position), radius, camera, rectangle))
+				continue;
+		}
+
+		glScissor(rectangle[0], rectangle[1], rectangle[2], rectangle[3]);
+		glUniform1i(lightIndexLocation, i);
+		RenderStatistics::addGLCalls(2);
+		this->renderScreenQuad();
+	}
+
+	glDisable(GL_SCISSOR_TEST);
+	glDisable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+
+	// Unbind the G-buffer, so its textures are not sampled while they are written by the next geometry pass
+	for (unsigned int i = 0; i < 4; ++i)
+	{
+		glActiveTexture(GL_TEXTURE0 + gBufferTextureUnits[i]);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	glActiveTexture(GL_TEXTURE0);
+	RenderStatistics::addGLCalls(12);
+}
+
+// Get the screen rectangle (x, y, width, height) covered by the sphere of influence of a light, by projecting the
+// corners of the cube that bounds it. Returns false if the sphere is outside of the view.
+// When the camera is inside the sphere, or a corner is behind the camera, the whole screen is used.
+bool DeferredRenderer::getScissorRectangle(const glm::vec3& center, float radius, const Camera& camera,
+	GLint* rectangle) const
+{
+	if (!camera.isBoxInsideFrustum(center, glm::vec3(radius, radius, radius)))
+		return false;
+
+	rectangle[0] = 0;
+	rectangle[1] = 0;
+	rectangle[2] = this->width;
+	rectangle[3] = this->height;
+
+	if (glm::length(glm::vec3(camera.getPosition()) - center) < radius + fabsf(camera.getNearPlane()))
+		return true;
+
+	glm::mat4 viewProjectionMatrix = camera.getProjectionMatrix() * camera.getViewMatrix();
+	glm::vec2 minimum = glm::vec2(1.0f, 1.0f);
+	glm::vec2 maximum = glm::vec2(-1.0f, -1.0f);
+
+	for (unsigned int i = 0; i < 8; ++i)
+	{
+		glm::vec3 corner = center + radius * glm::vec3(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f,
+			i & 4 ? 1.0f : -1.0f);
+		glm::vec4 clipCorner = viewProjectionMatrix * glm::vec4(corner, 1.0f);
+
+		if (clipCorner.w <= 0.0f)
+			return true;
+
+		glm::vec2 ndcCorner = glm::vec2(clipCorner) / clipCorner.w;
+		minimum = glm::min(minimum, ndcCorner);
+		maximum = glm::max(maximum, ndcCorner);
+	}
+
+	minimum = glm::clamp(minimum, -1.0f, 1.0f);
+	maximum = glm::clamp(maximum, -1.0f, 1.0f);
+
+	GLint left = (GLint)floorf((minimum.x * 0.5f + 0.5f) * this->width);
+	GLint bottom = (GLint)floorf((minimum.y * 0.5f + 0.5f) * this->height);
+	GLint right = (GLint)ceilf((maximum.x * 0.5f + 0.5f) * this->width);
+	GLint top = (GLint)ceilf((maximum.y * 0.5f + 0.5f) * this->height);
+
+	rectangle[0] = left;
+	rectangle[1] = bottom;
+	rectangle[2] = right - left;
+	rectangle[3] = top - bottom;
+
+	return rectangle[2] > 0 && rectangle[3] > 0;
+}
+
+void DeferredRenderer::renderScreenQuad() const
+{
+	glBindVertexArray(this->screenQuadVAO);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glBindVertexArray(0);
+	RenderStatistics::addGLCalls(3);
+	RenderStatistics::addVertexArrayBinds(1);
+}
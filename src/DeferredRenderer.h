@@ -0,0 +1,38 @@
+#pragma once
+
+#include <GL\glew.h>
+#include "Shader.h"
+#include "Camera.h"
+#include "Light.h"
+#include <vector>
+
+namespace raw
+{
+	// Deferred shading, used when the DEFERRED shader type is selected.
+	// The geometry pass renders the lit entities with the DEFERRED shader into a G-buffer (position, normal, albedo
+	// and specular). The light pass then draws a screen quad per light, reading the G-buffer, with additive blending.
+	// The quad of each attenuated light is clipped by a scissor rectangle that bounds its sphere of influence on the
+	// screen, so the cost of a light depends on the pixels it covers.
+	class DeferredRenderer
+	{
+	public:
+		DeferredRenderer();
+		~DeferredRenderer();
+		void beginGeometryPass(const Camera& camera);
+		void endGeometryPass() const;
+		void renderLights(const std::vector<Light*>& lights, const Camera& camera) const;
+	private:
+		void createGBuffer(unsigned int width, unsigned int height);
+		void destroyGBuffer();
+		bool getScissorRectangle(const glm::vec3& center, float radius, const Camera& camera, GLint* rectangle) const;
+		void renderScreenQuad() const;
+		Shader* lightShader;
+		GLuint frameBuffer;
+		GLuint gBufferTextures[4];
+		GLuint depthRenderBuffer;
+		unsigned int width;
+		unsigned int height;
+		GLuint screenQuadVAO;
+		GLuint screenQuadVBO;
+	};
+}
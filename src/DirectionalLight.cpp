@@ -28,20 +28,12 @@ glm::vec4 DirectionalLight::getDirection() const
 	return this->direction;
 }
 
-// Send all information about the light to the shader, so it can be used when rendering.
-void DirectionalLight::updateUniforms(const Shader& shader, unsigned int arrayPosition) const
+// Fill the light descriptor that is sent to the shaders.
+void DirectionalLight::fillShaderDescriptor(LightShaderDescriptor& descriptor) const
 {
-	Light::updateUniforms(shader, arrayPosition);
+	Light::fillShaderDescriptor(descriptor);
 
-	char locationBuffer[1024];
-
-	glm::vec4 directionalLightDirection = this->direction;
-
-	this->getShaderLocationString("direction", locationBuffer, arrayPosition);
-	GLuint directionalLightDirectionLocation = glGetUniformLocation(shader.getProgram(), locationBuffer);
-
-	glUniform4f(directionalLightDirectionLocation, directionalLightDirection.x,
-		directionalLightDirection.y, directionalLightDirection.z, directionalLightDirection.w);
+	descriptor.direction = this->direction;
 }
 
 LightType DirectionalLight::getType() const
@@ -12,7 +12,7 @@ namespace raw
 		~DirectionalLight();
 		void setDirection(const glm::vec4& direction);
 		glm::vec4 getDirection() const;
-		virtual void updateUniforms(const Shader& shader, unsigned int arrayPosition) const;
+		virtual void fillShaderDescriptor(LightShaderDescriptor& descriptor) const;
 		virtual LightType getType() const;
 	private:
 		glm::vec4 direction;
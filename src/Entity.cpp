@@ -2,6 +2,8 @@
 #include "PointLight.h"
 #include "SpotLight.h"
 #include "Model.h"
+#include "RenderQueue.h"
+#include "RenderStatistics.h"
 
 using namespace raw;
 
@@ -47,75 +49,173 @@ const Transform& Entity::getTransform() const
 	return this->transform;
 }
 
+// Get the bounding box of the model, transformed by the entity's model matrix, as a center and a half extent.
+// The box is kept axis-aligned in world coordinates: its half extent is projected onto each world axis using the
+// absolute values of the model matrix.
+void Entity::getWorldBoundingBox(glm::vec3& center, glm::vec3& extent) const
+{
+	const glm::mat4& modelMatrix = this->transform.getModelMatrix();
+	glm::vec3 modelCenter = (this->model->getBoundingBoxMinimum() + this->model->getBoundingBoxMaximum()) / 2.0f;
+	glm::vec3 modelExtent = (this->model->getBoundingBoxMaximum() - this->model->getBoundingBoxMinimum()) / 2.0f;
+
+	center = glm::vec3(modelMatrix * glm::vec4(modelCenter, 1.0f));
+	extent = glm::abs(glm::vec3(modelMatrix[0])) * modelExtent.x +
+		glm::abs(glm::vec3(modelMatrix[1])) * modelExtent.y + glm::abs(glm::vec3(modelMatrix[2])) * modelExtent.z;
+}
+
+// Check whether the world bounding box of the entity touches the camera frustum.
+bool Entity::isInsideFrustum(const Camera& camera) const
+{
+	glm::vec3 center, extent;
+	this->getWorldBoundingBox(center, extent);
+
+	return camera.isBoxInsideFrustum(center, extent);
+}
+
+// Test the world bounding box of the entity against the camera frustum, counting the entity as drawn or culled.
+// The box is returned in center and extent. Returns false if the entity is culled.
+bool Entity::testVisibility(const Camera& camera, glm::vec3& center, glm::vec3& extent) const
+{
+	this->getWorldBoundingBox(center, extent);
+
+	if (!camera.isBoxInsideFrustum(center, extent))
+	{
+		RenderStatistics::addCulledObjects(1);
+		return false;
+	}
+
+	RenderStatistics::addDrawnObjects(1);
+	return true;
+}
+
+// Select the lights that reach the world bounding box of the entity, given by its center and its half extent, keeping
+// the entityMaximumLights most intense ones. The indices of the selected lights in the lights vector are stored in
+// selectedLights, sorted from the most intense to the least intense. Returns the quantity of selected lights.
+unsigned int Entity::selectLights(const std::vector<Light*>& lights, const glm::vec3& center,
+	const glm::vec3& extent, GLint* selectedLights) const
+{
+	float selectedIntensities[entityMaximumLights];
+	unsigned int selectedQuantity = 0;
+
+	for (unsigned int i = 0; i < lights.size(); ++i)
+	{
+		if (!lights[i]->isOn())
+			continue;
+
+		float intensity = lights[i]->getIntensityOnBox(center, extent);
+
+		if (intensity <= 0.0f)
+			continue;
+
+		if (selectedQuantity == entityMaximumLights && intensity <= selectedIntensities[selectedQuantity - 1])
+			continue;
+
+		// Insert the light in its sorted position, dropping the least intense light when the list is full
+		unsigned int position = selectedQuantity < entityMaximumLights ? selectedQuantity++ : selectedQuantity - 1;
+		while (position > 0 && selectedIntensities[position - 1] < intensity)
+		{
+			selectedIntensities[position] = selectedIntensities[position - 1];
+			selectedLights[position] = selectedLights[position - 1];
+			--position;
+		}
+		selectedIntensities[position] = intensity;
+		selectedLights[position] = i;
+	}
+
+	return selectedQuantity;
+}
+
 // Render the entity, using the shader, the camera and the vector of lights provided.
-void Entity::render(const Shader& shader, const Camera& camera, const std::vector<Light*>& lights, bool useNormalMap) const
+// Entities outside of the camera frustum are skipped.
+// The camera and the lights are read by the shader from the frame block and the light cluster buffers, so they
+// must have been uploaded with FrameUniformBuffer::update() and LightClusterBuffer::update() during the current frame.
+// Vertex lit shaders also receive the indices of the most relevant lights, which refer to the same lights vector
+// given to LightClusterBuffer::update().
+void Entity::render(const Shader& shader, const Camera& camera, const std::vector<Light*>& lights,
+	bool useNormalMap) const
 {
+	glm::vec3 center, extent;
+	if (!this->testVisibility(camera, center, extent))
+		return;
+
 	shader.useProgram();
-	GLuint modelMatrixLocation = glGetUniformLocation(shader.getProgram(), "modelMatrix");
-	GLuint viewMatrixLocation = glGetUniformLocation(shader.getProgram(), "viewMatrix");
-	GLuint projectionMatrixLocation = glGetUniformLocation(shader.getProgram(), "projectionMatrix");
+	GLint modelMatrixLocation = shader.getUniformLocation(ShaderUniform::MODEL_MATRIX);
 	glUniformMatrix4fv(modelMatrixLocation, 1, GL_FALSE, glm::value_ptr(this->transform.getModelMatrix()));
-	glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, glm::value_ptr(camera.getViewMatrix()));
-	glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, glm::value_ptr(camera.getProjectionMatrix()));
+	RenderStatistics::addGLCalls(1);
 
-	if (shader.getType() == ShaderType::PHONG || shader.getType() == ShaderType::GOURAD
-		|| shader.getType() == ShaderType::FLAT)
+	// Vertex lit shaders only evaluate the lights selected for the entity
+	GLint entityLightsLocation = shader.getUniformLocation(ShaderUniform::ENTITY_LIGHTS);
+	if (entityLightsLocation != -1)
 	{
-		if (camera.isUsingFog())
-		{
-			glm::vec4 skyColor = camera.getFogDescriptor().skyColor;
-			GLuint fogDensityLocation = glGetUniformLocation(shader.getProgram(), "fogDescriptor.density");
-			GLuint fogGradientLocation = glGetUniformLocation(shader.getProgram(), "fogDescriptor.gradient");
-			GLuint fogSkyColorLocation = glGetUniformLocation(shader.getProgram(), "fogDescriptor.skyColor");
-			GLuint fogOnLocation = glGetUniformLocation(shader.getProgram(), "fogDescriptor.on");
-			glUniform1f(fogDensityLocation, camera.getFogDescriptor().density);
-			glUniform1f(fogGradientLocation, camera.getFogDescriptor().gradient);
-			glUniform4f(fogSkyColorLocation, skyColor.x, skyColor.y, skyColor.z, skyColor.w);
-			glUniform1i(fogOnLocation, true);
-		}
-		else
+		GLint selectedLights[entityMaximumLights];
+		unsigned int selectedQuantity = this->selectLights(lights, center, extent, selectedLights);
+		GLint entityLightQuantityLocation = shader.getUniformLocation(ShaderUniform::ENTITY_LIGHT_QUANTITY);
+
+		if (selectedQuantity > 0)
 		{
-			GLuint fogOnLocation = glGetUniformLocation(shader.getProgram(), "fogDescriptor.on");
-			glUniform1i(fogOnLocation, false);
+			glUniform1iv(entityLightsLocation, selectedQuantity, selectedLights);
+			RenderStatistics::addGLCalls(1);
 		}
-
-		glm::vec4 cameraPosition = camera.getPosition();
-		GLuint cameraPositionLocation = glGetUniformLocation(shader.getProgram(), "cameraPosition");
-		GLuint lightQuantityLocation = glGetUniformLocation(shader.getProgram(), "lightQuantity");
-		glUniform4f(cameraPositionLocation, cameraPosition.x, cameraPosition.y, cameraPosition.z, cameraPosition.w);
-		glUniform1i(lightQuantityLocation, lights.size());
-
-		for (unsigned int i = 0; i < lights.size(); ++i)
-			lights[i]->updateUniforms(shader, i);
+		glUniform1i(entityLightQuantityLocation, selectedQuantity);
+		RenderStatistics::addGLCalls(1);
 	}
 
 	this->model->render(shader, useNormalMap);
 }
 
+// Submit one draw per mesh of the entity to the render queue, with the same shader state as render() would use.
+// Entities outside of the camera frustum are skipped.
+void Entity::submit(RenderQueue& renderQueue, const Shader& shader, const Camera& camera,
+	const std::vector<Light*>& lights, bool useNormalMap, bool cullFace) const
+{
+	glm::vec3 center, extent;
+	if (!this->testVisibility(camera, center, extent))
+		return;
+
+	RenderCommand command;
+	command.shader = &shader;
+	command.modelMatrix = this->transform.getModelMatrix();
+	command.useNormalMap = useNormalMap;
+	command.cullFace = cullFace;
+	command.entityLightQuantity = 0;
+
+	if (shader.getUniformLocation(ShaderUniform::ENTITY_LIGHTS) != -1)
+		command.entityLightQuantity = this->selectLights(lights, center, extent, command.entityLights);
+
+	const std::vector<Mesh*>& meshes = this->model->getMeshes();
+	for (unsigned int i = 0; i < meshes.size(); ++i)
+	{
+		command.mesh = meshes[i];
+		renderQueue.submit(command, center, false);
+	}
+}
+
+// Render the entity with a solid color. The camera must have been uploaded with FrameUniformBuffer::update().
+// Entities outside of the camera frustum are skipped.
 void Entity::render(const Shader& shader, const Camera& camera, glm::vec4 solidColor) const
 {
+	glm::vec3 center, extent;
+	if (!this->testVisibility(camera, center, extent))
+		return;
+
 	shader.useProgram();
-	GLuint modelMatrixLocation = glGetUniformLocation(shader.getProgram(), "modelMatrix");
-	GLuint viewMatrixLocation = glGetUniformLocation(shader.getProgram(), "viewMatrix");
-	GLuint projectionMatrixLocation = glGetUniformLocation(shader.getProgram(), "projectionMatrix");
-	GLuint solidColorLocation = glGetUniformLocation(shader.getProgram(), "solidColor");
+	GLint modelMatrixLocation = shader.getUniformLocation(ShaderUniform::MODEL_MATRIX);
+	GLint solidColorLocation = shader.getUniformLocation(ShaderUniform::SOLID_COLOR);
 	glUniformMatrix4fv(modelMatrixLocation, 1, GL_FALSE, glm::value_ptr(this->transform.getModelMatrix()));
-	glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, glm::value_ptr(camera.getViewMatrix()));
-	glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, glm::value_ptr(camera.getProjectionMatrix()));
 	glUniform4f(solidColorLocation, solidColor.x, solidColor.y, solidColor.z, solidColor.w);
+	RenderStatistics::addGLCalls(2);
 
 	this->model->render(shader, false);
 }
 
-void Entity::render(const Shader& shader, const Camera& camera) const
+// Render the entity. The camera must have been uploaded with FrameUniformBuffer::update().
+// This path is used by the skybox, which is drawn around the camera, so it is never culled.
+void Entity::render(const Shader& shader, const Camera&) const
 {
 	shader.useProgram();
-	GLuint modelMatrixLocation = glGetUniformLocation(shader.getProgram(), "modelMatrix");
-	GLuint viewMatrixLocation = glGetUniformLocation(shader.getProgram(), "viewMatrix");
-	GLuint projectionMatrixLocation = glGetUniformLocation(shader.getProgram(), "projectionMatrix");
+	GLint modelMatrixLocation = shader.getUniformLocation(ShaderUniform::MODEL_MATRIX);
 	glUniformMatrix4fv(modelMatrixLocation, 1, GL_FALSE, glm::value_ptr(this->transform.getModelMatrix()));
-	glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, glm::value_ptr(camera.getViewMatrix()));
-	glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, glm::value_ptr(camera.getProjectionMatrix()));
+	RenderStatistics::addGLCalls(1);
 
 	this->model->render(shader, false);
 }
@@ -130,10 +230,11 @@ void Entity::render(const Shader& shader, float windowRatio) const
 	}));
 
 	shader.useProgram();
-	GLuint modelMatrixLocation = glGetUniformLocation(shader.getProgram(), "modelMatrix");
-	GLuint scaleMatrixLocation = glGetUniformLocation(shader.getProgram(), "scaleMatrix");
+	GLint modelMatrixLocation = shader.getUniformLocation(ShaderUniform::MODEL_MATRIX);
+	GLint scaleMatrixLocation = shader.getUniformLocation(ShaderUniform::SCALE_MATRIX);
 	glUniformMatrix4fv(modelMatrixLocation, 1, GL_FALSE, glm::value_ptr(this->transform.getModelMatrix()));
 	glUniformMatrix4fv(scaleMatrixLocation, 1, GL_FALSE, glm::value_ptr(scaleMatrix));
+	RenderStatistics::addGLCalls(2);
 
 	this->model->render(shader, false);
 }
@@ -141,10 +242,11 @@ void Entity::render(const Shader& shader, float windowRatio) const
 void Entity::render(const Shader& shader, float windowRatio, float playerHp, float playerMaxHp) const
 {
 	shader.useProgram();
-	GLuint playerHpLocation = glGetUniformLocation(shader.getProgram(), "playerHp");
-	GLuint playerMaximumHpLocation = glGetUniformLocation(shader.getProgram(), "playerMaximumHp");
+	GLint playerHpLocation = shader.getUniformLocation(ShaderUniform::PLAYER_HP);
+	GLint playerMaximumHpLocation = shader.getUniformLocation(ShaderUniform::PLAYER_MAXIMUM_HP);
 	glUniform1i(playerHpLocation, playerHp);
 	glUniform1i(playerMaximumHpLocation, playerMaxHp);
+	RenderStatistics::addGLCalls(2);
 
 	Entity::render(shader, windowRatio);
 }
\ No newline at end of file
@@ -10,6 +10,11 @@ namespace raw
 {
 	class Light;
 	class Model;
+	class RenderQueue;
+
+	// Maximum quantity of lights selected for each entity. Must match the size of the entityLights array of the
+	// vertex lit shaders (Gourad and Flat).
+	const unsigned int entityMaximumLights = 16;
 
 	class Entity
 	{
@@ -18,17 +23,25 @@ namespace raw
 		Entity(Model* model, Transform& transform);
 		~Entity();
 
-		virtual void render(const Shader& shader, const Camera& camera, const std::vector<Light*>& lights, bool useNormalMap) const;
+		virtual void render(const Shader& shader, const Camera& camera, const std::vector<Light*>& lights,
+			bool useNormalMap) const;
 		virtual void render(const Shader& shader, const Camera& camera, glm::vec4 solidColor) const;
 		virtual void render(const Shader& shader, const Camera& camera) const;
 		virtual void render(const Shader& shader, float windowRatio) const;
 		virtual void render(const Shader& shader, float windowRatio, float playerHp, float playerMaxHp) const;
+		void submit(RenderQueue& renderQueue, const Shader& shader, const Camera& camera,
+			const std::vector<Light*>& lights, bool useNormalMap, bool cullFace) const;
 		Transform& getTransform();
 		const Transform& getTransform() const;
 		Model* getModel();
 		const Model* getModel() const;
 		void setModel(Model* model);
+		void getWorldBoundingBox(glm::vec3& center, glm::vec3& extent) const;
+		bool isInsideFrustum(const Camera& camera) const;
 	private:
+		bool testVisibility(const Camera& camera, glm::vec3& center, glm::vec3& extent) const;
+		unsigned int selectLights(const std::vector<Light*>& lights, const glm::vec3& center, const glm::vec3& extent,
+			GLint* selectedLights) const;
 		Transform transform;
 		Model* model;
 	};
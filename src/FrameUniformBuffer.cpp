@@ -0,0 +1,53 @@
+#include "FrameUniformBuffer.h"
+#include "RenderStatistics.h"
+#include "Shader.h"
+#include <cstring>
+
+using namespace raw;
+
+// Create the uniform buffer, initially filled with zeros.
+FrameUniformBuffer::FrameUniformBuffer()
+{
+	this->uploadedDescriptor = {};
+
+	glGenBuffers(1, &this->uniformBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, this->uniformBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameShaderDescriptor), &this->uploadedDescriptor, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+FrameUniformBuffer::~FrameUniformBuffer()
+{
+	glDeleteBuffers(1, &this->uniformBuffer);
+}
+
+// Fill the buffer with the values of the camera, if they changed since the last update, and bind it to the
+// frame block binding point. Must be called once per frame, before rendering any entity with this camera.
+void FrameUniformBuffer::update(const Camera& camera)
+{
+	FrameShaderDescriptor descriptor = {};
+	descriptor.viewMatrix = camera.getViewMatrix();
+	descriptor.projectionMatrix = camera.getProjectionMatrix();
+	descriptor.cameraPosition = camera.getPosition();
+
+	if (camera.isUsingFog())
+	{
+		FogDescriptor fogDescriptor = camera.getFogDescriptor();
+		descriptor.fogDensity = fogDescriptor.density;
+		descriptor.fogGradient = fogDescriptor.gradient;
+		descriptor.fogSkyColor = fogDescriptor.skyColor;
+		descriptor.fogOn = true;
+	}
+
+	if (memcmp(&descriptor, &this->uploadedDescriptor, sizeof(FrameShaderDescriptor)) != 0)
+	{
+		this->uploadedDescriptor = descriptor;
+		glBindBuffer(GL_UNIFORM_BUFFER, this->uniformBuffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameShaderDescriptor), &this->uploadedDescriptor);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		RenderStatistics::addGLCalls(3);
+	}
+
+	glBindBufferBase(GL_UNIFORM_BUFFER, frameUniformBlockBindingPoint, this->uniformBuffer);
+	RenderStatistics::addGLCalls(1);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Camera.h"
+#include <GL\glew.h>
+
+namespace raw
+{
+	// Mirror of the FrameBlock uniform block of the shaders, laid out with the std140 rules.
+	// The FogDescriptor struct of the block is flattened, with the padding it gets in std140.
+	struct FrameShaderDescriptor
+	{
+		glm::mat4 viewMatrix;
+		glm::mat4 projectionMatrix;
+		glm::vec4 cameraPosition;
+		float fogDensity;
+		float fogGradient;
+		float fogPadding0[2];
+		glm::vec4 fogSkyColor;
+		int fogOn;
+		float fogPadding1[3];
+	};
+
+	// Uniform buffer holding the values that are the same for every entity rendered in a frame: the view and
+	// projection matrices, the camera position and the fog. It is filled once per frame from the camera in use.
+	class FrameUniformBuffer
+	{
+	public:
+		FrameUniformBuffer();
+		~FrameUniformBuffer();
+		void update(const Camera& camera);
+	private:
+		GLuint uniformBuffer;
+		FrameShaderDescriptor uploadedDescriptor;
+	};
+}
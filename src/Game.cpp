@@ -63,6 +63,11 @@ void Game::init(const GameSettings& gameSettings)
 
 	// Create Lights
 	this->createLights();
+	this->lightClusterBuffer = new LightClusterBuffer();
+	this->frameUniformBuffer = new FrameUniformBuffer();
+	this->instancedRenderer = new InstancedRenderer();
+	this->renderQueue = new RenderQueue();
+	this->deferredRenderer = new DeferredRenderer();
 
 	// Create Entities
 	this->createEntities();
@@ -75,6 +80,7 @@ void Game::init(const GameSettings& gameSettings)
 	this->useOrthoCamera = false;
 	this->useFog = true;
 	this->useCullFace = false;
+	this->useMapWallBVH = false;
 
 	if (!this->singlePlayer)
 	{
@@ -118,6 +124,19 @@ void Game::render() const
 	const Camera* selectedCamera = this->getSelectedCamera();
 	Shader* shaderToUse;
 
+	// Upload the camera and fog of this frame
+	this->frameUniformBuffer->update(*selectedCamera);
+
+	// Map is still being loaded
+	if (this->mapLoader)
+	{
+		this->renderLoadingScreen();
+		return;
+	}
+
+	// Upload the lights that changed since the last frame and bin them in the light clusters of the camera
+	this->lightClusterBuffer->update(this->lights, *selectedCamera);
+
 	// Get selected shader
 	switch (this->shaderType)
 	{
@@ -139,6 +158,9 @@ void Game::render() const
 	case ShaderType::PHONG:
 		shaderToUse = this->phongShader;
 		break;
+	case ShaderType::DEFERRED:
+		shaderToUse = this->deferredShader;
+		break;
 	case ShaderType::SKYBOX:
 		shaderToUse = this->skyboxShader;
 		break;
@@ -150,9 +172,37 @@ void Game::render() const
 	// Render skybox
 	this->skybox->render(*skyboxShader, *selectedCamera);
 
-	// Render all entities
+	// Deferred shading: the lit entities are written to the G-buffer and shaded by the light pass
+	if (this->shaderType == ShaderType::DEFERRED)
+		this->deferredRenderer->beginGeometryPass(*selectedCamera);
+
+	// Queue loaded map chunks and all entities, they are rendered without face culling
+	this->renderQueue->begin(*selectedCamera);
+	this->mapStreamer->submit(*this->renderQueue, *shaderToUse, *selectedCamera, this->lights, this->useNormalMap);
 	for (unsigned int i = 0; i < this->entities.size(); ++i)
-		this->entities[i]->render(*shaderToUse, *selectedCamera, this->lights, this->useNormalMap);
+		this->entities[i]->submit(*this->renderQueue, *shaderToUse, *selectedCamera, this->lights, this->useNormalMap,
+			false);
+
+	// Avoid rendering the player when the player camera is being used to not block the camera.
+	if (this->selectedCamera != CameraType::PLAYER)
+	{
+		this->player->submit(*this->renderQueue, *shaderToUse, *selectedCamera, this->lights, this->useNormalMap,
+			this->useCullFace);
+		this->player->submitGun(*this->renderQueue, *shaderToUse, *selectedCamera, this->lights, this->useNormalMap,
+			this->useCullFace);
+	}
+
+	// Render second player only if game is being played multiplayer
+	if (!this->singlePlayer)
+	{
+		this->secondPlayer->submit(*this->renderQueue, *shaderToUse, *selectedCamera, this->lights,
+			this->useNormalMap, this->useCullFace);
+		this->secondPlayer->submitGun(*this->renderQueue, *shaderToUse, *selectedCamera, this->lights,
+			this->useNormalMap, this->useCullFace);
+	}
+
+	// Render the queued draws sorted by shader, material and VAO
+	this->renderQueue->execute();
 
 	// Enable Cullface if activated
 	if (this->useCullFace)
@@ -161,37 +211,40 @@ void Game::render() const
 		glFrontFace(GL_CCW);
 	}
 
-	// Render all street lamps
+	// Render the bases of all street lamps with one instanced draw
 	for (unsigned int i = 0; i < this->streetLamps.size(); ++i)
-		this->streetLamps[i]->render(*shaderToUse, *basicShader, *selectedCamera, this->lights, this->useNormalMap);
-
-	// Render street spot light
-	this->streetSpotLight->render(*shaderToUse, *basicShader, *selectedCamera, this->lights, this->useNormalMap);
+		this->streetLamps[i]->addBaseInstance(*this->instancedRenderer, *selectedCamera);
+	this->instancedRenderer->render(*shaderToUse, this->useNormalMap);
 
-	// Avoid rendering the player when the player camera is being used to not block the camera.
-	if (this->selectedCamera != CameraType::PLAYER)
+	// Shade the G-buffer. The street spot light mixes lit and solid color parts, so it is rendered after, with Phong
+	if (this->shaderType == ShaderType::DEFERRED)
 	{
-		this->player->render(*shaderToUse, *selectedCamera, this->lights, this->useNormalMap);
-		this->player->renderGun(*shaderToUse, *selectedCamera, this->lights, this->useNormalMap);
+		this->deferredRenderer->endGeometryPass();
+		this->deferredRenderer->renderLights(this->lights, *selectedCamera);
+		shaderToUse = this->phongShader;
 	}
 
-	// Render second player only if game is being played multiplayer
-	if (!this->singlePlayer)
-	{
-		this->secondPlayer->render(*shaderToUse, *selectedCamera, this->lights, this->useNormalMap);
-		this->secondPlayer->renderGun(*shaderToUse, *selectedCamera, this->lights, this->useNormalMap);
-	}
+	// Render street spot light
+	this->streetSpotLight->render(*shaderToUse, *basicShader, *selectedCamera, this->lights, this->useNormalMap);
 
 	// Disable cullface if activated
 	if (this->useCullFace)
 		glDisable(GL_CULL_FACE);
 
+	// Render the bulbs of all street lamps with one instanced draw
+	for (unsigned int i = 0; i < this->streetLamps.size(); ++i)
+		this->streetLamps[i]->addBulbInstance(*this->instancedRenderer, *selectedCamera);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glEnable(GL_BLEND);
+	this->instancedRenderer->render(*basicShader, false);
+	glDisable(GL_BLEND);
+
 	// Render first player shotmarks
-	this->player->renderShotMarks(*basicShader, *selectedCamera);
+	this->player->renderShotMarks(*basicShader);
 
 	// Render second player shotmarks
 	if (!this->singlePlayer)
-		this->secondPlayer->renderShotMarks(*basicShader, *selectedCamera);
+		this->secondPlayer->renderShotMarks(*basicShader);
 
 	// Render aim only if player Camera is being used
 	if (this->selectedCamera == CameraType::PLAYER)
@@ -209,12 +262,27 @@ void Game::update(float deltaTime)
 	// How many times, per second, information about the player should be sent to the second player (multiplayer only)
 	static const float networkUpdatesPerSecond = 20.0f;
 
+	// Wait for the map
+	if (this->mapLoader)
+	{
+		if (!this->mapLoader->isFinished())
+			return;
+
+		this->finishMapLoading();
+	}
+
 	// Update player
 	this->player->update(map, deltaTime);
 
 	// Update cameras
 	this->updateCameras(deltaTime);
 
+	// Stream map chunks around the selected camera and the player camera
+	std::vector<glm::vec4> mapStreamingPositions;
+	mapStreamingPositions.push_back(this->getSelectedCamera()->getPosition());
+	mapStreamingPositions.push_back(playerCamera->getPosition());
+	this->mapStreamer->update(mapStreamingPositions);
+
 	// If multiplayer
 	if (!this->singlePlayer)
 	{
@@ -301,14 +369,20 @@ void Game::destroy()
 	if (!this->singlePlayer)
 		delete this->network;
 
-	// Destroy map
+	// Destroy map. The loader must be destroyed first, it waits for the background thread to stop.
+	delete this->mapLoader;
+	delete this->mapStreamer;
 	delete this->map;
+	delete this->mapWallGrid;
+	delete this->mapWallBVH;
+	delete this->mapWallDescriptors;
 	
 	// Destroy Shaders
 	delete this->basicShader;
 	delete this->phongShader;
 	delete this->gouradShader;
 	delete this->flatShader;
+	delete this->deferredShader;
 	delete this->fixedShader;
 	delete this->textureShader;
 	delete this->skyboxShader;
@@ -321,6 +395,11 @@ void Game::destroy()
 	// Destroy Lights
 	for (unsigned int i = 0; i < this->lights.size(); ++i)
 		delete this->lights[i];
+	delete this->lightClusterBuffer;
+	delete this->frameUniformBuffer;
+	delete this->instancedRenderer;
+	delete this->renderQueue;
+	delete this->deferredRenderer;
 
 	// Destroy Street Lamps
 	// We can just clear the vector, since all street lamps were inside the lights array anyway.
@@ -333,6 +412,7 @@ void Game::destroy()
 	// Destroy Entities
 	for (unsigned int i = 0; i < this->entities.size(); ++i)
 		delete this->entities[i];
+	delete this->loadingBar;
 
 	// Destroy players
 	delete this->player;
@@ -405,6 +485,10 @@ void Game::processScrollChange(double xOffset, double yOffset)
 // If mouse is clicked, this function is called as a callback.
 void Game::processMouseClick(int button, int action)
 {
+	// Nothing can be done while the map is loading
+	if (this->mapLoader)
+		return;
+
 	if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS)
 	{
 		// Start player firing animation.
@@ -414,12 +498,12 @@ void Game::processMouseClick(int button, int action)
 		if (!this->singlePlayer)
 		{
 			// Shoot, testing collisions with map walls and second player
-			this->player->shoot(this->secondPlayer, this->mapWallDescriptors, this->network);
+			this->player->shoot(this->secondPlayer, this->getMapWallAccelerationStructure(), this->network);
 		}
 		else
 		{
 			// Shoot, testing collisions with map walls only.
-			this->player->shoot(this->mapWallDescriptors);
+			this->player->shoot(this->getMapWallAccelerationStructure());
 		}
 	}
 }
@@ -452,15 +536,61 @@ Player* Game::getSecondPlayer()
 }
 
 // Create game map
+// Map walls are generated in background threads. The game shows a loading screen until they are ready
+// (see finishMapLoading()).
 void Game::createMap()
 {
 	this->map = new Map(".\\res\\map\\map.png");
-	// Generate map wall descriptors. They are used to calculate collisions with map walls.
-	this->mapWallDescriptors = this->map->generateMapWallDescriptors();
-	Model* mapModel = this->map->generateMapModel();
-	this->models.push_back(mapModel);
-	Entity* mapEntity = new Entity(mapModel);
-	this->entities.push_back(mapEntity);
+	this->mapWallDescriptors = 0;
+	this->mapWallGrid = 0;
+	this->mapWallBVH = 0;
+	this->mapStreamer = 0;
+	this->mapLoader = new MapLoader(this->map, MapMeshingMode::GREEDY, false, true);
+
+	// Create loading bar, it is rendered with the hp bar shader
+	Mesh* loadingBarMesh = new Quad();
+	Model* loadingBarModel = new Model(std::vector<Mesh*>({ loadingBarMesh }));
+	this->models.push_back(loadingBarModel);
+	this->loadingBar = new Entity(loadingBarModel);
+	this->loadingBar->getTransform().setWorldPosition(glm::vec4(0.0f, -0.5f, 0.0f, 1.0f));
+	this->loadingBar->getTransform().setWorldScale(glm::vec3(0.6f, 0.04f, 0.0f));
+}
+
+// Called once the map loader finished. Takes the map walls and starts streaming the map model.
+void Game::finishMapLoading()
+{
+	// Map wall descriptors are used to calculate collisions with map walls. The loader already built the grid and the
+	// BVH over them (the BVH can be selected instead of the grid with the B key).
+	this->mapLoader->takeMapWallStructures(this->mapWallDescriptors, this->mapWallGrid, this->mapWallBVH);
+
+	delete this->mapLoader;
+	this->mapLoader = 0;
+
+	// The map model is split in chunks, only the chunks near the active cameras are kept in memory.
+	// Chunks are generated in the background and show up a few frames after they are requested.
+	static const float mapChunkLoadDistance = 48.0f;
+	static const float mapChunkUnloadDistance = 64.0f;
+	this->mapStreamer = new MapStreamer(this->map, MapMeshingMode::GREEDY, mapChunkLoadDistance,
+		mapChunkUnloadDistance);
+}
+
+// Render the sky and the map loading progress.
+void Game::renderLoadingScreen() const
+{
+	float windowRatio = (float)this->freeCamera->getWindowHeight() / (float)this->freeCamera->getWindowWidth();
+	static const float loadingBarMaximum = 100.0f;
+
+	this->skybox->render(*skyboxShader, *this->getSelectedCamera());
+
+	glDisable(GL_DEPTH_TEST);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glEnable(GL_BLEND);
+
+	this->loadingBar->render(*this->hpBarShader, windowRatio, this->mapLoader->getProgress() * loadingBarMaximum,
+		loadingBarMaximum);
+
+	glDisable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
 }
 
 // Create all shaders
@@ -472,6 +602,7 @@ void Game::createShaders()
 	this->phongShader = new Shader(ShaderType::PHONG);
 	this->gouradShader = new Shader(ShaderType::GOURAD);
 	this->flatShader = new Shader(ShaderType::FLAT);
+	this->deferredShader = new Shader(ShaderType::DEFERRED);
 	this->skyboxShader = new Shader(ShaderType::SKYBOX);
 	this->hpBarShader = new Shader(ShaderType::HPBAR);
 	this->shaderType = ShaderType::PHONG;
@@ -648,7 +779,8 @@ void Game::createEntities()
 		if (i % 2)
 		{
 			woodBilletModel->getMeshes()[i]->setDiffuseMap(Texture::load(".\\res\\art\\w_diffuse.jpg"));
-			woodBilletModel->getMeshes()[i]->setNormalMap(Texture::load(".\\res\\art\\w_normal.jpg"));
+			woodBilletModel->getMeshes()[i]->setNormalMap(Texture::load(".\\res\\art\\w_normal.jpg",
+				TextureType::NORMAL_MAP));
 		//a	woodBilletModel->getMeshes()[i]->setDiffuseMap(Texture::load(".\\res\\art\\woodbillet\\BarkDecidious0194_1_S.jpg"));
 		}
 		else
@@ -700,9 +832,22 @@ const Camera* Game::getSelectedCamera() const
 	}
 }
 
+// Returns the structure used to test shots against the map walls.
+const MapWallAccelerationStructure& Game::getMapWallAccelerationStructure() const
+{
+	if (this->useMapWallBVH)
+		return *this->mapWallBVH;
+	else
+		return *this->mapWallGrid;
+}
+
 // This function will check which keys are pressed and do stuff based on it.
 void Game::processInput(bool* keyState, float deltaTime)
 {
+	// Nothing can be done while the map is loading
+	if (this->mapLoader)
+		return;
+
 	// Move Players and Cameras based on Input
 	this->movePlayerAndCamerasBasedOnInput(keyState, deltaTime);
 
@@ -750,6 +895,8 @@ void Game::processInput(bool* keyState, float deltaTime)
 		case ShaderType::GOURAD:
 			this->shaderType = ShaderType::PHONG; break;
 		case ShaderType::PHONG:
+			this->shaderType = ShaderType::DEFERRED; break;
+		case ShaderType::DEFERRED:
 			this->shaderType = ShaderType::SKYBOX; break;
 		case ShaderType::SKYBOX:
 			this->shaderType = ShaderType::TEXTURE; break;
@@ -832,6 +979,13 @@ void Game::processInput(bool* keyState, float deltaTime)
 		keyState[GLFW_KEY_9] = false;				// Force false to only compute one time.
 	}
 
+	// Toggle map wall acceleration structure used by shots (grid or BVH)
+	if (keyState[GLFW_KEY_B])
+	{
+		this->useMapWallBVH = !this->useMapWallBVH;
+		keyState[GLFW_KEY_B] = false;				// Force false to only compute one time.
+	}
+
 	// Toggle skybox day/night
 	if (keyState[GLFW_KEY_Z])
 	{
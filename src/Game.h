@@ -4,6 +4,15 @@
 #include "Light.h"
 #include "Player.h"
 #include "Map.h"
+#include "MapWallGrid.h"
+#include "MapWallBVH.h"
+#include "MapStreamer.h"
+#include "MapLoader.h"
+#include "LightClusterBuffer.h"
+#include "FrameUniformBuffer.h"
+#include "InstancedRenderer.h"
+#include "RenderQueue.h"
+#include "DeferredRenderer.h"
 #include "Network.h"
 #include <vector>
 
@@ -67,10 +76,13 @@ namespace raw
 		// Auxiliar Functions
 		Camera* getSelectedCamera();
 		const Camera* getSelectedCamera() const;
+		const MapWallAccelerationStructure& getMapWallAccelerationStructure() const;
 		StreetLamp* createStreetLamp(const glm::vec4& position, float rotY);
 		void movePlayerAndCamerasBasedOnInput(bool* keyState, float deltaTime);
 		void updateCameras(float deltaTime);
 		void endGameIfNecessary(float leftScore, float rightScore);
+		void finishMapLoading();
+		void renderLoadingScreen() const;
 
 		// Network
 		Network* network;
@@ -83,6 +95,7 @@ namespace raw
 		Shader* flatShader;
 		Shader* gouradShader;
 		Shader* phongShader;
+		Shader* deferredShader;
 		Shader* skyboxShader;
 		Shader* hpBarShader;
 
@@ -99,13 +112,31 @@ namespace raw
 
 		// Map
 		Map* map;
-		std::vector<MapWallDescriptor> mapWallDescriptors;
+		std::vector<MapWallDescriptor>* mapWallDescriptors;
+		MapWallGrid* mapWallGrid;
+		MapWallBVH* mapWallBVH;
+		MapStreamer* mapStreamer;
+		MapLoader* mapLoader;
+		Entity* loadingBar;
 
 		// Skybox
 		Skybox* skybox;
+
+		// Per-frame camera and fog uniforms
+		FrameUniformBuffer* frameUniformBuffer;
+
+		// Street lamps and shot marks are drawn with instancing
+		InstancedRenderer* instancedRenderer;
+
+		// Map chunks, entities and players are drawn sorted by state
+		RenderQueue* renderQueue;
+
+		// G-buffer and light pass of the DEFERRED shader type
+		DeferredRenderer* deferredRenderer;
 		
 		// Entities and Light
 		std::vector<Light*> lights;
+		LightClusterBuffer* lightClusterBuffer;
 		StreetSpotLight* streetSpotLight;
 		std::vector<StreetLamp*> streetLamps;
 		std::vector<Model*> models;
@@ -124,6 +155,7 @@ namespace raw
 		bool useOrthoCamera;
 		bool useFog;
 		bool useCullFace;
+		bool useMapWallBVH;
 		bool bExit;
 		GameExitInfo exitInfo;
 	};
@@ -0,0 +1,88 @@
+#include "InstancedRenderer.h"
+#include "Shader.h"
+#include "RenderStatistics.h"
+
+using namespace raw;
+
+InstancedRenderer::InstancedRenderer()
+{
+	glGenBuffers(1, &this->instanceBuffer);
+	this->instanceBufferCapacity = 0;
+}
+
+InstancedRenderer::~InstancedRenderer()
+{
+	glDeleteBuffers(1, &this->instanceBuffer);
+}
+
+// Queue an instance of the model. It will be rendered in the next call to render().
+void InstancedRenderer::addInstance(const Model* model, const glm::mat4& modelMatrix, const glm::vec4& color)
+{
+	MeshInstance instance;
+	instance.modelMatrix = modelMatrix;
+	instance.color = color;
+
+	for (unsigned int i = 0; i < this->batches.size(); ++i)
+		if (this->batches[i].model == model)
+		{
+			this->batches[i].instances.push_back(instance);
+			return;
+		}
+
+	InstanceBatch batch;
+	batch.model = model;
+	batch.instances.push_back(instance);
+	this->batches.push_back(batch);
+}
+
+// Render all queued instances with the shader and clear the queue.
+// The camera and the lights are read from the frame and light uniform blocks, like in Entity::render().
+void InstancedRenderer::render(const Shader& shader, bool useNormalMap)
+{
+	this->streamedInstances.clear();
+	for (unsigned int i = 0; i < this->batches.size(); ++i)
+		this->streamedInstances.insert(this->streamedInstances.end(), this->batches[i].instances.begin(),
+			this->batches[i].instances.end());
+
+	if (this->streamedInstances.empty())
+		return;
+
+	// Orphan the buffer before writing, so the driver does not wait for the draws of the last frame
+	glBindBuffer(GL_ARRAY_BUFFER, this->instanceBuffer);
+	if (this->streamedInstances.size() > this->instanceBufferCapacity)
+		this->instanceBufferCapacity = this->streamedInstances.size() * 2;
+	glBufferData(GL_ARRAY_BUFFER, this->instanceBufferCapacity * sizeof(MeshInstance), 0, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, this->streamedInstances.size() * sizeof(MeshInstance),
+		&this->streamedInstances[0]);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	RenderStatistics::addGLCalls(4);
+
+	shader.useProgram();
+	GLint useInstancingLocation = shader.getUniformLocation(ShaderUniform::USE_INSTANCING);
+	glUniform1i(useInstancingLocation, true);
+	RenderStatistics::addGLCalls(1);
+
+	// Instances are spread over the scene, so the vertex lit shaders must use all lights instead of a per-entity
+	// selection
+	GLint entityLightQuantityLocation = shader.getUniformLocation(ShaderUniform::ENTITY_LIGHT_QUANTITY);
+	if (entityLightQuantityLocation != -1)
+	{
+		glUniform1i(entityLightQuantityLocation, -1);
+		RenderStatistics::addGLCalls(1);
+	}
+
+	unsigned int firstInstance = 0;
+	for (unsigned int i = 0; i < this->batches.size(); ++i)
+	{
+		unsigned int instanceQuantity = this->batches[i].instances.size();
+		this->batches[i].model->renderInstanced(shader, useNormalMap, this->instanceBuffer, firstInstance,
+			instanceQuantity);
+		firstInstance += instanceQuantity;
+
+		// Keep the batch (and its allocated memory) for the next frame, the same models are usually queued again
+		this->batches[i].instances.clear();
+	}
+
+	glUniform1i(useInstancingLocation, false);
+	RenderStatistics::addGLCalls(1);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Model.h"
+#include <vector>
+
+namespace raw
+{
+	// Instances of a model waiting to be rendered
+	struct InstanceBatch
+	{
+		const Model* model;
+		std::vector<MeshInstance> instances;
+	};
+
+	// Collects instances (model matrix and color) of shared models and renders each model with a single instanced
+	// draw call per mesh. The instances of all models are streamed to the GPU in one buffer, so the number of draw
+	// calls does not depend on the number of instances.
+	class InstancedRenderer
+	{
+	public:
+		InstancedRenderer();
+		~InstancedRenderer();
+		void addInstance(const Model* model, const glm::mat4& modelMatrix, const glm::vec4& color);
+		void render(const Shader& shader, bool useNormalMap);
+	private:
+		std::vector<InstanceBatch> batches;
+		std::vector<MeshInstance> streamedInstances;
+		GLuint instanceBuffer;
+		unsigned int instanceBufferCapacity;
+	};
+}
@@ -1,7 +1,11 @@
 #include "Light.h"
+#include <cfloat>
 
 using namespace raw;
 
+// Contribution below which a light is considered to not affect a fragment (less than one step of an 8-bit color).
+static const float influenceThreshold = 1.0f / 256.0f;
+
 Light::Light()
 {
 }
@@ -64,61 +68,74 @@ bool Light::isOn() const
 	return this->on;
 }
 
-// Send all information about the light to the shader, so it can be used when rendering.
-void Light::updateUniforms(const Shader& shader, unsigned int arrayPosition) const
-{
-	char locationBuffer[1024];
-
-	glm::vec4 lightAmbient = this->ambientColor;
-	glm::vec4 lightDiffuse = this->diffuseColor;
-	glm::vec4 lightSpecular = this->specularColor;
-	LightType lightType = this->getType();
-	bool isOn = this->on;
-
-	this->getShaderLocationString("ambientColor", locationBuffer, arrayPosition);
-	GLuint lightAmbientLocation = glGetUniformLocation(shader.getProgram(), locationBuffer);
-	this->getShaderLocationString("diffuseColor", locationBuffer, arrayPosition);
-	GLuint lightDiffuseLocation = glGetUniformLocation(shader.getProgram(), locationBuffer);
-	this->getShaderLocationString("specularColor", locationBuffer, arrayPosition);
-	GLuint lightSpecularLocation = glGetUniformLocation(shader.getProgram(), locationBuffer);
-	this->getShaderLocationString("type", locationBuffer, arrayPosition);
-	GLuint lightTypeLocation = glGetUniformLocation(shader.getProgram(), locationBuffer);
-	this->getShaderLocationString("isOn", locationBuffer, arrayPosition);
-	GLuint isOnLocation = glGetUniformLocation(shader.getProgram(), locationBuffer);
-
-	glUniform4f(lightAmbientLocation, lightAmbient.x, lightAmbient.y, lightAmbient.z, lightAmbient.w);
-	glUniform4f(lightDiffuseLocation, lightDiffuse.x, lightDiffuse.y, lightDiffuse.z, lightDiffuse.w);
-	glUniform4f(lightSpecularLocation, lightSpecular.x, lightSpecular.y, lightSpecular.z, lightSpecular.w);
-	glUniform1i(lightTypeLocation, lightType);
-	glUniform1i(isOnLocation, isOn);
-}
-
-// This function will generate a string with the following format: "lights[arrayPosition].attribute"
-// Where arrayPosition is a number, received as a paramater and attribute is a string, also received as a
-// parameter. The result is stored in the buffer received as a parameter.
-// The purpose of this function is to ease the creation of those strings, since they must be generated when
-// sending light uniforms to the fragment shader.
-// The shader has an array, named "lights", which each element is a LightDescriptor, a struct defined in
-// the fragment shader that contains all informations about each light. The strings created with this
-// function are in the correct format to access such array.
-void Light::getShaderLocationString(char* attribute, char* buffer, unsigned int arrayPosition) const
-{
-	unsigned int bufferPosition = 0;
-	const char shaderLightArray[] = "lights";
-	char arrayPositionStr[32];
-	sprintf_s(arrayPositionStr, "%d", arrayPosition);
-
-	// Manually builds the location string.
-	strcpy(buffer + bufferPosition, shaderLightArray);
-	bufferPosition += sizeof(shaderLightArray) - 1;
-	*(buffer + bufferPosition) = '[';
-	++bufferPosition;
-	strcpy(buffer + bufferPosition, arrayPositionStr);
-	bufferPosition += strlen(arrayPositionStr);
-	*(buffer + bufferPosition) = ']';
-	*(buffer + bufferPosition + 1) = '.';
-	bufferPosition += 2;
-	strcpy(buffer + bufferPosition, attribute);
-	bufferPosition += strlen(attribute);
-	*(buffer + bufferPosition) = 0;
-}
\ No newline at end of file
+// Get the distance from the light beyond which its contribution is negligible.
+// Returns a negative value if the light reaches the whole scene, which is the default.
+float Light::getInfluenceRadius() const
+{
+	return -1.0f;
+}
+
+// Solve the attenuation equation for the distance where the brightest color component of the light, scaled by
+// intensity, falls below influenceThreshold. Returns a negative value if the light is never attenuated.
+float Light::calculateInfluenceRadius(const LightAttenuation& attenuation, float intensity) const
+{
+	glm::vec4 totalColor = this->ambientColor + this->diffuseColor + this->specularColor;
+	float brightestComponent = glm::max(totalColor.r, glm::max(totalColor.g, totalColor.b)) * intensity;
+	// Attenuation factor the distance must reach: constant + linear * d + quadratic * d^2 = attenuationLimit
+	float attenuationLimit = brightestComponent / influenceThreshold;
+
+	if (attenuationLimit <= attenuation.constantTerm)
+		return 0.0f;
+
+	if (attenuation.quadraticTerm > 0.0f)
+	{
+		float a = attenuation.quadraticTerm;
+		float b = attenuation.linearTerm;
+		float c = attenuation.constantTerm - attenuationLimit;
+		return (-b + sqrtf(b * b - 4.0f * a * c)) / (2.0f * a);
+	}
+
+	if (attenuation.linearTerm > 0.0f)
+		return (attenuationLimit - attenuation.constantTerm) / attenuation.linearTerm;
+
+	return -1.0f;
+}
+
+// Get the brightest color component of the light that reaches the closest point of a world space box, given by its
+// center and half extent. Used to pick the most relevant lights of an entity.
+// Lights that are not attenuated reach everything with full intensity, so FLT_MAX is returned by default.
+float Light::getIntensityOnBox(const glm::vec3&, const glm::vec3&) const
+{
+	return FLT_MAX;
+}
+
+// Calculate the attenuated intensity of a light placed at position on the closest point of the box. Returns zero
+// if the box is beyond the influence radius of the light.
+float Light::calculateIntensityOnBox(const LightAttenuation& attenuation, float intensity, const glm::vec4& position,
+	const glm::vec3& center, const glm::vec3& extent) const
+{
+	float radius = this->calculateInfluenceRadius(attenuation, intensity);
+	glm::vec3 lightPosition = glm::vec3(position);
+	glm::vec3 closestPoint = glm::clamp(lightPosition, center - extent, center + extent);
+	float distance = glm::length(lightPosition - closestPoint);
+
+	if (radius >= 0.0f && distance > radius)
+		return 0.0f;
+
+	glm::vec4 totalColor = this->ambientColor + this->diffuseColor + this->specularColor;
+	float brightestComponent = glm::max(totalColor.r, glm::max(totalColor.g, totalColor.b)) * intensity;
+
+	return brightestComponent / (attenuation.constantTerm + attenuation.linearTerm * distance +
+		attenuation.quadraticTerm * distance * distance);
+}
+
+// Fill the attributes shared by all lights in the descriptor that is sent to the shaders.
+// The specific attributes are filled by each light type.
+void Light::fillShaderDescriptor(LightShaderDescriptor& descriptor) const
+{
+	descriptor.ambientColor = this->ambientColor;
+	descriptor.diffuseColor = this->diffuseColor;
+	descriptor.specularColor = this->specularColor;
+	descriptor.type = this->getType();
+	descriptor.isOn = this->on;
+}
@@ -19,6 +19,25 @@ namespace raw
 		float quadraticTerm;
 	};
 
+	// Mirror of the LightDescriptor struct of the lit shaders, as stored in the light descriptors texture buffer:
+	// seven texels of four 32-bit values each. Booleans and ints are read back in the shaders from their bits.
+	struct LightShaderDescriptor
+	{
+		glm::vec4 ambientColor;
+		glm::vec4 diffuseColor;
+		glm::vec4 specularColor;
+		float constantTerm;
+		float linearTerm;
+		float quadraticTerm;
+		int type;
+		glm::vec4 position;
+		glm::vec4 direction;
+		float innerCutOffAngleCos;
+		float outerCutOffAngleCos;
+		int isOn;
+		float padding;
+	};
+
 	class Light
 	{
 	public:
@@ -31,12 +50,16 @@ namespace raw
 		glm::vec4 getDiffuseColor() const;
 		void setSpecularColor(const glm::vec4& specularColor);
 		glm::vec4 getSpecularColor() const;
-		virtual void updateUniforms(const Shader& shader, unsigned int arrayPosition) const;
+		virtual void fillShaderDescriptor(LightShaderDescriptor& descriptor) const;
 		virtual LightType getType() const = 0;
+		virtual float getInfluenceRadius() const;
+		virtual float getIntensityOnBox(const glm::vec3& center, const glm::vec3& extent) const;
 		void setOn(bool on);
 		bool isOn() const;
 	protected:
-		void getShaderLocationString(char* attribute, char* buffer, unsigned int arrayPosition) const;
+		float calculateInfluenceRadius(const LightAttenuation& attenuation, float intensity) const;
+		float calculateIntensityOnBox(const LightAttenuation& attenuation, float intensity, const glm::vec4& position,
+			const glm::vec3& center, const glm::vec3& extent) const;
 	private:
 		bool on;
 		glm::vec4 position;
@@ -0,0 +1,324 @@
+#include "LightClusterBuffer.h"
+#include "Shader.h"
+#include "RenderStatistics.h"
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+
+using namespace raw;
+
+// Quantity of clusters of the grid.
+static const unsigned int lightClusterQuantity = lightClusterQuantityX * lightClusterQuantityY * lightClusterQuantityZ;
+// Initial quantity of lights of the light descriptors buffer. The buffer grows when more lights are used.
+static const unsigned int initialLightDescriptorsCapacity = 32;
+
+// Create the uniform buffer of the light cluster block and the three texture buffers.
+LightClusterBuffer::LightClusterBuffer()
+{
+	glGenBuffers(1, &this->uniformBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, this->uniformBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(LightClusterShaderDescriptor), 0, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	// Light descriptors: seven RGBA texels per light
+	this->lightDescriptorsCapacity = initialLightDescriptorsCapacity;
+	this->uploadedDescriptors.resize(this->lightDescriptorsCapacity);
+	glGenBuffers(1, &this->lightDescriptorsBuffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, this->lightDescriptorsBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, this->lightDescriptorsCapacity * sizeof(LightShaderDescriptor),
+		this->uploadedDescriptors.data(), GL_DYNAMIC_DRAW);
+	glGenTextures(1, &this->lightDescriptorsTexture);
+	glBindTexture(GL_TEXTURE_BUFFER, this->lightDescriptorsTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32UI, this->lightDescriptorsBuffer);
+
+	// Cluster table: offset in the index list and quantity of lights of each cluster
+	this->clusterTable.resize(lightClusterQuantity, glm::uvec2(0, 0));
+	glGenBuffers(1, &this->lightClustersBuffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, this->lightClustersBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, lightClusterQuantity * sizeof(glm::uvec2), this->clusterTable.data(),
+		GL_STREAM_DRAW);
+	glGenTextures(1, &this->lightClustersTexture);
+	glBindTexture(GL_TEXTURE_BUFFER, this->lightClustersTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, this->lightClustersBuffer);
+
+	// Index list: the global lights followed by the lights of each cluster
+	this->lightIndices.push_back(0);
+	glGenBuffers(1, &this->lightIndicesBuffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, this->lightIndicesBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(unsigned int), this->lightIndices.data(), GL_STREAM_DRAW);
+	glGenTextures(1, &this->lightIndicesTexture);
+	glBindTexture(GL_TEXTURE_BUFFER, this->lightIndicesTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, this->lightIndicesBuffer);
+
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	this->clusterLights.resize(lightClusterQuantity);
+	this->clusterBoxesMinimum.resize(lightClusterQuantity);
+	this->clusterBoxesMaximum.resize(lightClusterQuantity);
+	this->clusterBoxesProjectionMatrix = glm::mat4(0.0f);
+	this->depthSliceScale = 0.0f;
+	this->depthSliceBias = 0.0f;
+
+	// Force the first upload of the block
+	this->uploadedBlock = LightClusterShaderDescriptor();
+	this->uploadedBlock.lightQuantities.x = -1;
+}
+
+LightClusterBuffer::~LightClusterBuffer()
+{
+	glDeleteTextures(1, &this->lightIndicesTexture);
+	glDeleteBuffers(1, &this->lightIndicesBuffer);
+	glDeleteTextures(1, &this->lightClustersTexture);
+	glDeleteBuffers(1, &this->lightClustersBuffer);
+	glDeleteTextures(1, &this->lightDescriptorsTexture);
+	glDeleteBuffers(1, &this->lightDescriptorsBuffer);
+	glDeleteBuffers(1, &this->uniformBuffer);
+}
+
+// Upload the lights, bin them in the clusters of the camera and bind the block and the texture buffers.
+// Must be called once per frame, before rendering the lit entities, with the camera that will be used.
+void LightClusterBuffer::update(const std::vector<Light*>& lights, const Camera& camera)
+{
+	this->uploadLightDescriptors(lights);
+	this->calculateClusterBoxes(camera);
+	this->binLights(lights, camera);
+	this->uploadClusters();
+	this->uploadBlock(lights.size());
+
+	glBindBufferBase(GL_UNIFORM_BUFFER, lightClusterUniformBlockBindingPoint, this->uniformBuffer);
+	glActiveTexture(GL_TEXTURE0 + lightDescriptorsTextureUnit);
+	glBindTexture(GL_TEXTURE_BUFFER, this->lightDescriptorsTexture);
+	glActiveTexture(GL_TEXTURE0 + lightClustersTextureUnit);
+	glBindTexture(GL_TEXTURE_BUFFER, this->lightClustersTexture);
+	glActiveTexture(GL_TEXTURE0 + lightIndicesTextureUnit);
+	glBindTexture(GL_TEXTURE_BUFFER, this->lightIndicesTexture);
+	glActiveTexture(GL_TEXTURE0);
+	RenderStatistics::addGLCalls(8);
+}
+
+// Upload the lights whose state changed since the last update. The buffer is reallocated, and all lights sent
+// again, when there are more lights than it can hold.
+void LightClusterBuffer::uploadLightDescriptors(const std::vector<Light*>& lights)
+{
+	int lightQuantity = lights.size();
+	int firstChangedLight = lightQuantity, lastChangedLight = -1;
+	bool reallocate = false;
+
+	if (lights.size() > this->lightDescriptorsCapacity)
+	{
+		while (lights.size() > this->lightDescriptorsCapacity)
+			this->lightDescriptorsCapacity *= 2;
+		this->uploadedDescriptors.resize(this->lightDescriptorsCapacity);
+		reallocate = true;
+	}
+
+	for (int i = 0; i < lightQuantity; ++i)
+	{
+		LightShaderDescriptor descriptor = {};
+		lights[i]->fillShaderDescriptor(descriptor);
+
+		if (memcmp(&descriptor, &this->uploadedDescriptors[i], sizeof(LightShaderDescriptor)) != 0)
+		{
+			this->uploadedDescriptors[i] = descriptor;
+			if (i < firstChangedLight) firstChangedLight = i;
+			lastChangedLight = i;
+		}
+	}
+
+	glBindBuffer(GL_TEXTURE_BUFFER, this->lightDescriptorsBuffer);
+	RenderStatistics::addGLCalls(1);
+
+	if (reallocate)
+	{
+		glBufferData(GL_TEXTURE_BUFFER, this->lightDescriptorsCapacity * sizeof(LightShaderDescriptor),
+			this->uploadedDescriptors.data(), GL_DYNAMIC_DRAW);
+		RenderStatistics::addGLCalls(1);
+	}
+	// Changed lights are sent in a single range, from the first to the last changed light
+	else if (lastChangedLight != -1)
+	{
+		glBufferSubData(GL_TEXTURE_BUFFER, firstChangedLight * sizeof(LightShaderDescriptor),
+			(lastChangedLight - firstChangedLight + 1) * sizeof(LightShaderDescriptor),
+			&this->uploadedDescriptors[firstChangedLight]);
+		RenderStatistics::addGLCalls(1);
+	}
+
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+// Calculate the view space bounding box of each cluster. The boxes only depend on the projection matrix, so they
+// are recalculated only when it changes.
+// Each tile of the screen is a pyramid (or a box, for orthographic cameras) whose edges are obtained by
+// unprojecting the corners of the tile on the near and far planes. Each slice cuts the edges at its two depths.
+void LightClusterBuffer::calculateClusterBoxes(const Camera& camera)
+{
+	const glm::mat4& projectionMatrix = camera.getProjectionMatrix();
+
+	if (memcmp(&projectionMatrix, &this->clusterBoxesProjectionMatrix, sizeof(glm::mat4)) == 0)
+		return;
+
+	this->clusterBoxesProjectionMatrix = projectionMatrix;
+
+	float nearDistance = fabsf(camera.getNearPlane());
+	float farDistance = fabsf(camera.getFarPlane());
+	float logDepthRatio = logf(farDistance / nearDistance);
+
+	// slice = log(depth / near) * quantityZ / log(far / near)
+	this->depthSliceScale = lightClusterQuantityZ / logDepthRatio;
+	this->depthSliceBias = -(lightClusterQuantityZ * logf(nearDistance)) / logDepthRatio;
+
+	glm::mat4 inverseProjectionMatrix = glm::inverse(projectionMatrix);
+
+	for (unsigned int y = 0; y < lightClusterQuantityY; ++y)
+		for (unsigned int x = 0; x < lightClusterQuantityX; ++x)
+		{
+			glm::vec3 edgeStart[4], edgeEnd[4];
+
+			for (unsigned int corner = 0; corner < 4; ++corner)
+			{
+				float ndcX = -1.0f + 2.0f * (float)(x + corner % 2) / lightClusterQuantityX;
+				float ndcY = -1.0f + 2.0f * (float)(y + corner / 2) / lightClusterQuantityY;
+				glm::vec4 start = inverseProjectionMatrix * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+				glm::vec4 end = inverseProjectionMatrix * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+				edgeStart[corner] = glm::vec3(start) / start.w;
+				edgeEnd[corner] = glm::vec3(end) / end.w;
+			}
+
+			for (unsigned int z = 0; z < lightClusterQuantityZ; ++z)
+			{
+				unsigned int clusterIndex = (z * lightClusterQuantityY + y) * lightClusterQuantityX + x;
+				float sliceDepths[2] = {
+					nearDistance * powf(farDistance / nearDistance, (float)z / lightClusterQuantityZ),
+					nearDistance * powf(farDistance / nearDistance, (float)(z + 1) / lightClusterQuantityZ)
+				};
+				glm::vec3 minimum = glm::vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+				glm::vec3 maximum = glm::vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+				for (unsigned int corner = 0; corner < 4; ++corner)
+					for (unsigned int i = 0; i < 2; ++i)
+					{
+						// Point of the edge whose view space z is -depth
+						float t = (-sliceDepths[i] - edgeStart[corner].z) / (edgeEnd[corner].z - edgeStart[corner].z);
+						glm::vec3 point = edgeStart[corner] + t * (edgeEnd[corner] - edgeStart[corner]);
+						minimum = glm::min(minimum, point);
+						maximum = glm::max(maximum, point);
+					}
+
+				this->clusterBoxesMinimum[clusterIndex] = minimum;
+				this->clusterBoxesMaximum[clusterIndex] = maximum;
+			}
+		}
+}
+
+// Get the depth slice that contains the view space depth received as parameter, using the same formula as the
+// shaders.
+unsigned int LightClusterBuffer::getDepthSlice(float depth) const
+{
+	if (depth <= 0.0f)
+		return 0;
+
+	float slice = floorf(logf(depth) * this->depthSliceScale + this->depthSliceBias);
+
+	if (slice < 0.0f)
+		return 0;
+	if (slice > lightClusterQuantityZ - 1)
+		return lightClusterQuantityZ - 1;
+	return (unsigned int)slice;
+}
+
+// Add each light that is on to the clusters touched by its sphere of influence, and build the cluster table and
+// the index list. The light positions are read from the descriptors filled by uploadLightDescriptors().
+void LightClusterBuffer::binLights(const std::vector<Light*>& lights, const Camera& camera)
+{
+	const glm::mat4& viewMatrix = camera.getViewMatrix();
+	float nearDistance = fabsf(camera.getNearPlane());
+	float farDistance = fabsf(camera.getFarPlane());
+
+	this->globalLights.clear();
+	for (unsigned int i = 0; i < lightClusterQuantity; ++i)
+		this->clusterLights[i].clear();
+
+	for (unsigned int i = 0; i < lights.size(); ++i)
+	{
+		if (!lights[i]->isOn())
+			continue;
+
+		float radius = lights[i]->getInfluenceRadius();
+
+		if (radius < 0.0f)
+		{
+			this->globalLights.push_back(i);
+			continue;
+		}
+
+		glm::vec3 center = glm::vec3(viewMatrix * this->uploadedDescriptors[i].position);
+		float minimumDepth = -center.z - radius;
+		float maximumDepth = -center.z + radius;
+
+		// Light completely in front of the near plane or behind the far plane
+		if (maximumDepth < nearDistance || minimumDepth > farDistance)
+			continue;
+
+		unsigned int firstSlice = this->getDepthSlice(minimumDepth);
+		unsigned int lastSlice = this->getDepthSlice(maximumDepth);
+
+		for (unsigned int z = firstSlice; z <= lastSlice; ++z)
+			for (unsigned int y = 0; y < lightClusterQuantityY; ++y)
+				for (unsigned int x = 0; x < lightClusterQuantityX; ++x)
+				{
+					unsigned int clusterIndex = (z * lightClusterQuantityY + y) * lightClusterQuantityX + x;
+					glm::vec3 closestPoint = glm::clamp(center, this->clusterBoxesMinimum[clusterIndex],
+						this->clusterBoxesMaximum[clusterIndex]);
+					glm::vec3 difference = center - closestPoint;
+
+					if (glm::dot(difference, difference) <= radius * radius)
+						this->clusterLights[clusterIndex].push_back(i);
+				}
+	}
+
+	this->lightIndices = this->globalLights;
+
+	for (unsigned int i = 0; i < lightClusterQuantity; ++i)
+	{
+		this->clusterTable[i] = glm::uvec2(this->lightIndices.size(), this->clusterLights[i].size());
+		this->lightIndices.insert(this->lightIndices.end(), this->clusterLights[i].begin(),
+			this->clusterLights[i].end());
+	}
+
+	// Texture buffers can't be empty
+	if (this->lightIndices.size() == 0)
+		this->lightIndices.push_back(0);
+}
+
+// Send the cluster table and the index list. Both change whenever the camera moves, so they are sent every frame,
+// orphaning the previous storage.
+void LightClusterBuffer::uploadClusters()
+{
+	glBindBuffer(GL_TEXTURE_BUFFER, this->lightClustersBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, this->clusterTable.size() * sizeof(glm::uvec2), this->clusterTable.data(),
+		GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, this->lightIndicesBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, this->lightIndices.size() * sizeof(unsigned int), this->lightIndices.data(),
+		GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	RenderStatistics::addGLCalls(5);
+}
+
+// Send the light cluster block, if it changed since the last update.
+void LightClusterBuffer::uploadBlock(unsigned int lightQuantity)
+{
+	LightClusterShaderDescriptor block;
+	block.clusterQuantity = glm::ivec4(lightClusterQuantityX, lightClusterQuantityY, lightClusterQuantityZ, 0);
+	block.lightQuantities = glm::ivec4(lightQuantity, this->globalLights.size(), 0, 0);
+	block.depthSlicing = glm::vec4(this->depthSliceScale, this->depthSliceBias, 0.0f, 0.0f);
+
+	if (memcmp(&block, &this->uploadedBlock, sizeof(LightClusterShaderDescriptor)) != 0)
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, this->uniformBuffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(LightClusterShaderDescriptor), &block);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		this->uploadedBlock = block;
+		RenderStatistics::addGLCalls(3);
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Light.h"
+#include "Camera.h"
+#include <vector>
+
+namespace raw
+{
+	// Dimensions of the cluster grid: tiles along the screen width and height, and depth slices along the view.
+	const unsigned int lightClusterQuantityX = 16;
+	const unsigned int lightClusterQuantityY = 9;
+	const unsigned int lightClusterQuantityZ = 24;
+
+	// Mirror of the LightClusterBlock uniform block of the lit shaders (std140).
+	struct LightClusterShaderDescriptor
+	{
+		glm::ivec4 clusterQuantity;		// x, y and z dimensions of the grid
+		glm::ivec4 lightQuantities;		// x: all lights, y: lights that reach every cluster
+		glm::vec4 depthSlicing;			// slice = log(depth) * x + y
+	};
+
+	// Light data of the lit shaders, used for clustered forward shading.
+	// Every frame, the lights are binned on the CPU into the clusters of the view volume of the camera: the volume
+	// is split in screen tiles and exponential depth slices, and each light is added to the clusters its sphere of
+	// influence touches. Lights without a bounded influence (directional lights) are added to a global list.
+	// The light descriptors, the cluster table (offset and quantity in the index list) and the index list are
+	// stored in texture buffers, so there is no limit on the quantity of lights.
+	class LightClusterBuffer
+	{
+	public:
+		LightClusterBuffer();
+		~LightClusterBuffer();
+		void update(const std::vector<Light*>& lights, const Camera& camera);
+	private:
+		void uploadLightDescriptors(const std::vector<Light*>& lights);
+		void calculateClusterBoxes(const Camera& camera);
+		void binLights(const std::vector<Light*>& lights, const Camera& camera);
+		void uploadClusters();
+		void uploadBlock(unsigned int lightQuantity);
+		unsigned int getDepthSlice(float depth) const;
+		GLuint uniformBuffer;
+		GLuint lightDescriptorsBuffer;
+		GLuint lightDescriptorsTexture;
+		GLuint lightClustersBuffer;
+		GLuint lightClustersTexture;
+		GLuint lightIndicesBuffer;
+		GLuint lightIndicesTexture;
+		std::vector<LightShaderDescriptor> uploadedDescriptors;
+		unsigned int lightDescriptorsCapacity;
+		LightClusterShaderDescriptor uploadedBlock;
+		glm::mat4 clusterBoxesProjectionMatrix;
+		std::vector<glm::vec3> clusterBoxesMinimum;
+		std::vector<glm::vec3> clusterBoxesMaximum;
+		std::vector<std::vector<unsigned int>> clusterLights;
+		std::vector<unsigned int> globalLights;
+		std::vector<glm::uvec2> clusterTable;
+		std::vector<unsigned int> lightIndices;
+		float depthSliceScale;
+		float depthSliceBias;
+	};
+}
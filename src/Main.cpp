@@ -5,8 +5,16 @@
 #include <time.h>
 #include "Game.h"
 #include "Application.h"
+#include "RenderStatistics.h"
+#include "ResourcePack.h"
+#include "TextureCache.h"
+#include "Model.h"
+#include "Map.h"
+#include "ShotBenchmark.h"
+#include <cstring>
 
 #define WINDOW_TITLE "Result.exe"
+#define RESOURCE_PACK_PATH ".\\assets.pack"
 
 int windowWidth = 1366;
 int windowHeight = 768;
@@ -75,8 +83,45 @@ void refreshKeys()
 {
 }
 
-int main()
+int main(int argc, char** argv)
 {
+	// "-pack" builds the resource pack with the asset directories and exits
+	if (argc > 1 && !strcmp(argv[1], "-pack"))
+	{
+		std::vector<std::string> assetDirectories;
+		assetDirectories.push_back(".\\res");
+		assetDirectories.push_back(".\\shaders");
+		return raw::ResourcePack::pack(assetDirectories, RESOURCE_PACK_PATH) ? 0 : 1;
+	}
+
+	// "-bake-texture <image path>" and "-bake-normal-map <image path>" bake a texture and exit
+	if (argc > 2 && (!strcmp(argv[1], "-bake-texture") || !strcmp(argv[1], "-bake-normal-map")))
+	{
+		raw::CompressedTexture compressedTexture;
+		raw::TextureType type = !strcmp(argv[1], "-bake-normal-map") ? raw::TextureType::NORMAL_MAP :
+			raw::TextureType::COLOR;
+		return raw::TextureCache::bake(argv[2], type, compressedTexture) ? 0 : 1;
+	}
+
+	// "-report-model <model path>" prints the vertex quantity and the ACMR of each mesh of the model, before and after
+	// the mesh optimization, and exits
+	if (argc > 2 && !strcmp(argv[1], "-report-model"))
+		return raw::Model::reportOptimization(argv[2]) ? 0 : 1;
+
+	// "-check-map-mesh <map path>" compares the map meshes built per cell and with greedy meshing and exits
+	if (argc > 2 && !strcmp(argv[1], "-check-map-mesh"))
+		return raw::Map::checkMeshing(argv[2]) ? 0 : 1;
+
+	// "-bench-shots [ray quantity]" measures the shots per second of the wall queries on generated maps and exits
+	if (argc > 1 && !strcmp(argv[1], "-bench-shots"))
+	{
+		raw::ShotBenchmark::run((argc > 2) ? (unsigned int)atoi(argv[2]) : 100000);
+		return 0;
+	}
+
+	// Without the pack, the assets are read from their files
+	raw::ResourcePack::open(RESOURCE_PACK_PATH);
+
 	srand(time(NULL));	// init random seed
 
 	GLFWwindow* mainWindow = initGlfw();
@@ -99,6 +144,7 @@ int main()
 
 		application->update(deltaTime);
 		application->render();
+		raw::RenderStatistics::endFrame();
 		application->processInput(keyState, deltaTime);
 	
 		if (application->shouldExit())
@@ -111,7 +157,13 @@ int main()
 		double currentFrame = glfwGetTime();
 		if ((int)currentFrame > frameNumber)
 		{
-			std::cout << "FPS: " << fps << std::endl;
+			std::cout << "FPS: " << fps << " | GL calls per frame: " << raw::RenderStatistics::getLastFrameGLCalls() <<
+				" | Objects drawn: " << raw::RenderStatistics::getLastFrameDrawnObjects() << " | Objects culled: " <<
+				raw::RenderStatistics::getLastFrameCulledObjects() << " | Program binds: " <<
+				raw::RenderStatistics::getLastFrameProgramBinds() << " | Texture binds: " <<
+				raw::RenderStatistics::getLastFrameTextureBinds() << " | VAO binds: " <<
+				raw::RenderStatistics::getLastFrameVertexArrayBinds() << " | Uniform lookups (cached): " <<
+				raw::RenderStatistics::getLastFrameUniformLookups() << std::endl;
 			fps = 0;
 			frameNumber++;
 		}
@@ -125,4 +177,5 @@ int main()
 
 	delete application;
 	glfwTerminate();
+	raw::ResourcePack::close();
 }
\ No newline at end of file
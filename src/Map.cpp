@@ -1,43 +1,498 @@
 #include "Map.h"
+#include "ResourcePack.h"
 #include "stb_image.h"
+#include <iostream>
 
 static const int mapChannels = 4;
+// Half size of the box around the player used to test movement against the map
+static const float movementCollisionFactor = 0.2f;
+// Size of the map chunks, in cells. Chunk meshes never need more than 16-bit indices with this size.
+static const int mapChunkSize = 32;
+// Textures of the blocked and free terrain meshes
+static const char* blockedDiffusePath = ".\\res\\art\\brickwall_diffuse.jpg";
+static const char* blockedSpecularPath = ".\\res\\art\\black.png";
+static const char* blockedNormalPath = ".\\res\\art\\brickwall_normal.jpg";
+static const char* freeDiffusePath = ".\\res\\art\\grass01.jpg";
+static const char* freeSpecularPath = ".\\res\\art\\grass01_s.jpg";
+static const char* freeNormalPath = ".\\res\\art\\grass01_n.jpg";
 
 using namespace raw;
 
+// Rectangle of map cells, in the (u, v) coordinates of the mask it was extracted from
+struct MapRectangle
+{
+	int u;
+	int v;
+	int uLength;
+	int vLength;
+};
+
+// Merge the set cells of mask (uSize * vSize, indexed by v * uSize + u) into rectangles.
+// Each rectangle grows along u as far as possible and then along v, if growAlongV is set, while the whole
+// row is set. Merged cells are cleared from mask.
+static void getGreedyRectangles(std::vector<unsigned char>& mask, int uSize, int vSize, bool growAlongV,
+	std::vector<MapRectangle>& rectangles)
+{
+	for (int v = 0; v < vSize; ++v)
+		for (int u = 0; u < uSize; ++u)
+		{
+			if (!mask[v * uSize + u])
+				continue;
+
+			MapRectangle rectangle;
+			rectangle.u = u;
+			rectangle.v = v;
+			rectangle.uLength = 1;
+			rectangle.vLength = 1;
+
+			while (u + rectangle.uLength < uSize && mask[v * uSize + u + rectangle.uLength])
+				++rectangle.uLength;
+
+			while (growAlongV && v + rectangle.vLength < vSize)
+			{
+				int row = (v + rectangle.vLength) * uSize;
+				bool isRowSet = true;
+
+				for (int i = u; i < u + rectangle.uLength && isRowSet; ++i)
+					isRowSet = mask[row + i] != 0;
+
+				if (!isRowSet)
+					break;
+
+				++rectangle.vLength;
+			}
+
+			for (int j = v; j < v + rectangle.vLength; ++j)
+				for (int i = u; i < u + rectangle.uLength; ++i)
+					mask[j * uSize + i] = 0;
+
+			rectangles.push_back(rectangle);
+			u += rectangle.uLength - 1;
+		}
+}
+
+// Append a quad to terrainMesh. The quad starts at origin and is spanned by uEdge and vEdge.
+// Texture coordinates go from 0 to uRepeat and vRepeat, so the texture is repeated once per map cell, exactly
+// like one quad per cell would do. The tangent is the same one a single cell would have.
+static void appendTerrainQuad(TerrainMesh& terrainMesh, const glm::vec4& origin, const glm::vec4& uEdge,
+	const glm::vec4& vEdge, float uRepeat, float vRepeat, const glm::vec4& normal)
+{
+	Vertex vertex[4];
+	unsigned int firstIndex = terrainMesh.vertices.size();
+
+	glm::vec2 diffUV1 = glm::vec2(0.0f, 0.0f) - glm::vec2(1.0f, 0.0f);
+	glm::vec2 diffUV2 = glm::vec2(1.0f, 0.0f) - glm::vec2(0.0f, 1.0f);
+	glm::vec4 edge1 = -uEdge / uRepeat;
+	glm::vec4 edge2 = uEdge / uRepeat - vEdge / vRepeat;
+	glm::vec4 tangent = Mesh::getTangentVector(diffUV1, diffUV2, edge1, edge2);
+
+	vertex[0].position = origin;
+	vertex[0].textureCoordinates = glm::vec2(0.0f, 0.0f);
+	vertex[1].position = origin + uEdge;
+	vertex[1].textureCoordinates = glm::vec2(uRepeat, 0.0f);
+	vertex[2].position = origin + vEdge;
+	vertex[2].textureCoordinates = glm::vec2(0.0f, vRepeat);
+	vertex[3].position = origin + uEdge + vEdge;
+	vertex[3].textureCoordinates = glm::vec2(uRepeat, vRepeat);
+
+	for (unsigned int i = 0; i < 4; ++i)
+	{
+		vertex[i].normal = normal;
+		vertex[i].tangent = tangent;
+		terrainMesh.vertices.push_back(vertex[i]);
+	}
+
+	terrainMesh.indices.push_back(firstIndex + 0);
+	terrainMesh.indices.push_back(firstIndex + 1);
+	terrainMesh.indices.push_back(firstIndex + 2);
+	terrainMesh.indices.push_back(firstIndex + 1);
+	terrainMesh.indices.push_back(firstIndex + 3);
+	terrainMesh.indices.push_back(firstIndex + 2);
+}
+
+// Sum of the areas of the triangles of terrainMesh.
+static float getTerrainMeshArea(const TerrainMesh& terrainMesh)
+{
+	float area = 0.0f;
+
+	for (unsigned int i = 0; i + 2 < terrainMesh.indices.size(); i += 3)
+	{
+		glm::vec3 a = glm::vec3(terrainMesh.vertices[terrainMesh.indices[i]].position);
+		glm::vec3 b = glm::vec3(terrainMesh.vertices[terrainMesh.indices[i + 1]].position);
+		glm::vec3 c = glm::vec3(terrainMesh.vertices[terrainMesh.indices[i + 2]].position);
+		area += glm::length(glm::cross(b - a, c - a)) / 2.0f;
+	}
+
+	return area;
+}
+
 Map::Map(const char* mapPath)
 {
 	stbi_set_flip_vertically_on_load(1);
 
-	this->mapBytes = stbi_load(mapPath, &this->mapWidth,
-		&this->mapHeight, 0, mapChannels);
+	Resource mapResource(mapPath);
+	unsigned char* mapBytes = 0;
+
+	if (mapResource.isLoaded())
+		mapBytes = stbi_load_from_memory(mapResource.getData(), mapResource.getSize(), &this->mapWidth,
+			&this->mapHeight, 0, mapChannels);
+
+	if (!mapBytes)
+		throw "Error loading map: could not load map image";
+
+	// Only the occupancy is needed after load, the image itself is released right away
+	this->initialize(mapBytes);
+	stbi_image_free(mapBytes);
+}
 
+// Creates a map from the pixels of a map image, with four channels per pixel. Used to generate maps in memory.
+Map::Map(const unsigned char* mapBytes, int mapWidth, int mapHeight)
+{
+	this->mapWidth = mapWidth;
+	this->mapHeight = mapHeight;
+	this->initialize(mapBytes);
+}
+
+Map::~Map()
+{
+}
+
+void Map::initialize(const unsigned char* mapBytes)
+{
 	this->mapXScalement = 1.0f;
 	this->mapYScalement = 1.0f;
 	this->mapZScalement = 1.0f;
+
+	this->createOccupancyBitmap(mapBytes);
 }
 
-Map::~Map()
+// Pack the map image into one bit per cell. A cell is free if the red channel of its pixel is 255.
+// Cell (x, z) comes from pixel x * mapWidth + z, which is how the map image has always been read.
+void Map::createOccupancyBitmap(const unsigned char* mapBytes)
+{
+	int pixelQuantity = this->mapWidth * this->mapHeight;
+
+	this->occupancyWordsPerRow = (this->mapHeight + 31) / 32;
+	this->occupancyBitmap.assign(this->mapWidth * this->occupancyWordsPerRow, 0);
+
+	for (int x = 0; x < this->mapWidth; ++x)
+		for (int z = 0; z < this->mapHeight; ++z)
+		{
+			int pixel = x * this->mapWidth + z;
+
+			if (pixel < pixelQuantity && mapBytes[pixel * mapChannels] == 255)
+				this->occupancyBitmap[x * this->occupancyWordsPerRow + (z >> 5)] |= 1u << (z & 31);
+		}
+}
+
+// Generate the map model. It has two meshes: one for the blocked terrain (walls) and one for the free terrain (floor).
+// PER_CELL emits a full box for each blocked cell and a quad for each free cell.
+// GREEDY merges coplanar neighbouring faces into bigger quads and drops the faces between two blocked cells.
+Model* Map::generateMapModel(MapMeshingMode meshingMode) const
 {
-	stbi_image_free(this->mapBytes);
+	TerrainMesh blockedTerrainMesh;
+	TerrainMesh freeTerrainMesh;
+
+	this->getTerrainMeshes(this->getMapCellRange(), meshingMode, blockedTerrainMesh, freeTerrainMesh);
+
+	return this->createTerrainModel(blockedTerrainMesh, freeTerrainMesh);
 }
 
-Model* Map::generateMapModel() const
+// Build the terrain meshes of the whole map with PER_CELL and with GREEDY meshing and print their vertex and
+// triangle quantities. Only CPU work is done, so no OpenGL context is needed.
+// Returns false if the map could not be loaded, if greedy meshing produced more vertices or triangles than the per
+// cell meshing, or if the free terrain of both meshes does not cover the same area.
+bool Map::checkMeshing(const char* mapPath)
+{
+	try
+	{
+		Map map(mapPath);
+		TerrainMesh blockedTerrainMeshes[2];
+		TerrainMesh freeTerrainMeshes[2];
+		unsigned int vertexQuantities[2];
+		unsigned int triangleQuantities[2];
+		float freeAreas[2];
+		MapMeshingMode meshingModes[2] = { MapMeshingMode::PER_CELL, MapMeshingMode::GREEDY };
+		const char* meshingModeNames[2] = { "Per cell", "Greedy" };
+
+		for (unsigned int i = 0; i < 2; ++i)
+		{
+			map.getTerrainMeshes(map.getMapCellRange(), meshingModes[i], blockedTerrainMeshes[i], freeTerrainMeshes[i]);
+			vertexQuantities[i] = blockedTerrainMeshes[i].vertices.size() + freeTerrainMeshes[i].vertices.size();
+			triangleQuantities[i] = (blockedTerrainMeshes[i].indices.size() + freeTerrainMeshes[i].indices.size()) / 3;
+			freeAreas[i] = getTerrainMeshArea(freeTerrainMeshes[i]);
+
+			std::cout << meshingModeNames[i] << ": " << vertexQuantities[i] << " vertices, " << triangleQuantities[i] <<
+				" triangles, free terrain area " << freeAreas[i] << std::endl;
+		}
+
+		if (vertexQuantities[1] > vertexQuantities[0] || triangleQuantities[1] > triangleQuantities[0])
+		{
+			std::cout << "Error checking map meshing: greedy meshing generated a bigger mesh" << std::endl;
+			return false;
+		}
+
+		if (glm::abs(freeAreas[1] - freeAreas[0]) > 0.001f * freeAreas[0])
+		{
+			std::cout << "Error checking map meshing: free terrain areas do not match" << std::endl;
+			return false;
+		}
+
+		std::cout << "Greedy meshing: " << 100.0f * vertexQuantities[1] / vertexQuantities[0] <<
+			"% of the vertices, " << 100.0f * triangleQuantities[1] / triangleQuantities[0] << "% of the triangles" <<
+			std::endl;
+		return true;
+	}
+	catch (const char* error)
+	{
+		std::cout << error << std::endl;
+		return false;
+	}
+}
+
+// Generate the terrain meshes of a single chunk. Faces on the chunk border are generated by the chunk that owns
+// the blocked cell, so neighbouring chunks never overlap or leave holes.
+// Only CPU work is done here, so it can be called from any thread. Use createTerrainModel() to upload the result.
+void Map::generateChunkTerrainMeshes(int chunkX, int chunkZ, MapMeshingMode meshingMode,
+	TerrainMesh& blockedTerrainMesh, TerrainMesh& freeTerrainMesh) const
+{
+	this->getTerrainMeshes(this->getChunkCellRange(chunkX, chunkZ), meshingMode, blockedTerrainMesh, freeTerrainMesh);
+}
+
+// Generate the walls used to test shots against the map.
+// Walls are generated chunk by chunk, so memory used during generation does not grow with the map size.
+std::vector<MapWallDescriptor> Map::generateMapWallDescriptors() const
+{
+	std::vector<MapWallDescriptor> mapWallDescriptors;
+
+	for (int chunkZ = 0; chunkZ < this->getChunkZQuantity(); ++chunkZ)
+		for (int chunkX = 0; chunkX < this->getChunkXQuantity(); ++chunkX)
+		{
+			std::vector<MapWallDescriptor> chunkWallDescriptors = this->generateChunkWallDescriptors(chunkX, chunkZ);
+			// Append Vector
+			mapWallDescriptors.insert(mapWallDescriptors.end(), chunkWallDescriptors.begin(), chunkWallDescriptors.end());
+		}
+
+	return mapWallDescriptors;
+}
+
+// Generate the walls of a single chunk.
+// Walls are merged as much as possible: the ground of the chunk is a single wall, the tops of the blocked cells are
+// merged into rectangles and the sides are merged along each wall line. Sides between two blocked cells are not
+// generated.
+// Rays never start inside blocked cells, so the closest wall hit is the same as with one box per blocked cell.
+std::vector<MapWallDescriptor> Map::generateChunkWallDescriptors(int chunkX, int chunkZ) const
+{
+	MapCellRange range = this->getChunkCellRange(chunkX, chunkZ);
+	MapWallDescriptor mapWallDescriptor;
+	std::vector<MapWallDescriptor> mapWallDescriptors;
+	std::vector<MapRectangle> rectangles;
+	std::vector<unsigned char> mask(range.xQuantity * range.zQuantity);
+	float xScale = this->mapXScalement;
+	float yScale = this->mapYScalement;
+	float zScale = this->mapZScalement;
+
+	// FLOOR (every cell has floor, free or blocked)
+	mapWallDescriptor.centerPosition = glm::vec4((range.x + range.xQuantity / 2.0f) * xScale, 0.0f,
+		(range.z + range.zQuantity / 2.0f) * zScale, 1.0f);
+	mapWallDescriptor.normalVector = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
+	mapWallDescriptor.xLength = range.xQuantity * xScale;
+	mapWallDescriptor.yLength = 0.0f;
+	mapWallDescriptor.zLength = range.zQuantity * zScale;
+	mapWallDescriptors.push_back(mapWallDescriptor);
+
+	// TOP (u = x, v = z)
+	for (int v = 0; v < range.zQuantity; ++v)
+		for (int u = 0; u < range.xQuantity; ++u)
+			mask[v * range.xQuantity + u] = this->isCellBlocked(range.x + u, range.z + v);
+
+	getGreedyRectangles(mask, range.xQuantity, range.zQuantity, true, rectangles);
+
+	for (unsigned int i = 0; i < rectangles.size(); ++i)
+	{
+		const MapRectangle& r = rectangles[i];
+		mapWallDescriptor.centerPosition = glm::vec4((range.x + r.u + r.uLength / 2.0f) * xScale, yScale,
+			(range.z + r.v + r.vLength / 2.0f) * zScale, 1.0f);
+		mapWallDescriptor.normalVector = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
+		mapWallDescriptor.xLength = r.uLength * xScale;
+		mapWallDescriptor.yLength = 0.0f;
+		mapWallDescriptor.zLength = r.vLength * zScale;
+		mapWallDescriptors.push_back(mapWallDescriptor);
+	}
+
+	// LEFT and RIGHT (u = z, v = x), merged along z only
+	for (int side = 0; side < 2; ++side)
+	{
+		int neighbourOffset = (side == 0) ? -1 : 1;
+
+		for (int v = 0; v < range.xQuantity; ++v)
+			for (int u = 0; u < range.zQuantity; ++u)
+				mask[v * range.zQuantity + u] = this->isCellBlocked(range.x + v, range.z + u) &&
+					!this->isCellBlocked(range.x + v + neighbourOffset, range.z + u);
+
+		rectangles.clear();
+		getGreedyRectangles(mask, range.zQuantity, range.xQuantity, false, rectangles);
+
+		for (unsigned int i = 0; i < rectangles.size(); ++i)
+		{
+			const MapRectangle& r = rectangles[i];
+			float xPos = (side == 0) ? (range.x + r.v) * xScale : (range.x + r.v + 1) * xScale;
+			mapWallDescriptor.centerPosition = glm::vec4(xPos, yScale / 2.0f,
+				(range.z + r.u + r.uLength / 2.0f) * zScale, 1.0f);
+			mapWallDescriptor.normalVector = glm::vec4((float)neighbourOffset, 0.0f, 0.0f, 0.0f);
+			mapWallDescriptor.xLength = 0.0f;
+			mapWallDescriptor.yLength = yScale;
+			mapWallDescriptor.zLength = r.uLength * zScale;
+			mapWallDescriptors.push_back(mapWallDescriptor);
+		}
+	}
+
+	// FRONT and BACK (u = x, v = z), merged along x only
+	for (int side = 0; side < 2; ++side)
+	{
+		int neighbourOffset = (side == 0) ? -1 : 1;
+
+		for (int v = 0; v < range.zQuantity; ++v)
+			for (int u = 0; u < range.xQuantity; ++u)
+				mask[v * range.xQuantity + u] = this->isCellBlocked(range.x + u, range.z + v) &&
+					!this->isCellBlocked(range.x + u, range.z + v + neighbourOffset);
+
+		rectangles.clear();
+		getGreedyRectangles(mask, range.xQuantity, range.zQuantity, false, rectangles);
+
+		for (unsigned int i = 0; i < rectangles.size(); ++i)
+		{
+			const MapRectangle& r = rectangles[i];
+			float zPos = (side == 0) ? (range.z + r.v) * zScale : (range.z + r.v + 1) * zScale;
+			mapWallDescriptor.centerPosition = glm::vec4((range.x + r.u + r.uLength / 2.0f) * xScale, yScale / 2.0f,
+				zPos, 1.0f);
+			mapWallDescriptor.normalVector = glm::vec4(0.0f, 0.0f, (float)neighbourOffset, 0.0f);
+			mapWallDescriptor.xLength = r.uLength * xScale;
+			mapWallDescriptor.yLength = yScale;
+			mapWallDescriptor.zLength = 0.0f;
+			mapWallDescriptors.push_back(mapWallDescriptor);
+		}
+	}
+
+	return mapWallDescriptors;
+}
+
+int Map::getChunkXQuantity() const
+{
+	return (this->mapWidth + mapChunkSize - 1) / mapChunkSize;
+}
+
+int Map::getChunkZQuantity() const
+{
+	return (this->mapHeight + mapChunkSize - 1) / mapChunkSize;
+}
+
+// Get the world position of the corner of the chunk with the smallest coordinates.
+glm::vec4 Map::getChunkMinBounds(int chunkX, int chunkZ) const
+{
+	MapCellRange range = this->getChunkCellRange(chunkX, chunkZ);
+	return glm::vec4(range.x * this->mapXScalement, 0.0f, range.z * this->mapZScalement, 1.0f);
+}
+
+// Get the world position of the corner of the chunk with the biggest coordinates.
+glm::vec4 Map::getChunkMaxBounds(int chunkX, int chunkZ) const
+{
+	MapCellRange range = this->getChunkCellRange(chunkX, chunkZ);
+	return glm::vec4((range.x + range.xQuantity) * this->mapXScalement, this->mapYScalement,
+		(range.z + range.zQuantity) * this->mapZScalement, 1.0f);
+}
+
+MapCellRange Map::getMapCellRange() const
+{
+	MapCellRange range;
+	range.x = 0;
+	range.z = 0;
+	range.xQuantity = this->mapWidth;
+	range.zQuantity = this->mapHeight;
+	return range;
+}
+
+// Chunks on the last row and column may be smaller, if the map size is not a multiple of the chunk size.
+MapCellRange Map::getChunkCellRange(int chunkX, int chunkZ) const
+{
+	MapCellRange range;
+	range.x = chunkX * mapChunkSize;
+	range.z = chunkZ * mapChunkSize;
+	range.xQuantity = glm::min(mapChunkSize, this->mapWidth - range.x);
+	range.zQuantity = glm::min(mapChunkSize, this->mapHeight - range.z);
+	return range;
+}
+
+// Generate the terrain meshes of the cells in range.
+void Map::getTerrainMeshes(const MapCellRange& range, MapMeshingMode meshingMode, TerrainMesh& blockedTerrainMesh,
+	TerrainMesh& freeTerrainMesh) const
+{
+	if (meshingMode == MapMeshingMode::GREEDY)
+	{
+		blockedTerrainMesh = this->getGreedyBlockedTerrainMesh(range);
+		freeTerrainMesh = this->getGreedyFreeTerrainMesh(range);
+	}
+	else
+		this->getPerCellTerrainMeshes(range, blockedTerrainMesh, freeTerrainMesh);
+}
+
+// Create the model of the terrain meshes. Empty meshes are left out, so a chunk with no walls has a single mesh.
+// Uploads the meshes, so it must be called from the thread that owns the GL context.
+Model* Map::createTerrainModel(const TerrainMesh& blockedTerrainMesh, const TerrainMesh& freeTerrainMesh) const
 {
 	std::vector<Mesh*> mapMeshes;
 
-	std::vector<unsigned int> blockedMeshIndices;
-	std::vector<Vertex> blockedMeshVertices;
+	if (blockedTerrainMesh.indices.size() > 0)
+	{
+		Texture* blockedDiffuse = Texture::load(blockedDiffusePath);
+		Texture* blockedSpecular = Texture::load(blockedSpecularPath);
+		Texture* blockedNormal = Texture::load(blockedNormalPath, TextureType::NORMAL_MAP);
 
-	std::vector<unsigned int> freeMeshIndices;
-	std::vector<Vertex> freeMeshVertices;
+		Mesh* blockedMesh = new Mesh(blockedTerrainMesh.vertices, blockedTerrainMesh.indices, blockedDiffuse,
+			blockedSpecular, blockedNormal, 32.0f);
+		mapMeshes.push_back(blockedMesh);
+	}
+
+	if (freeTerrainMesh.indices.size() > 0)
+	{
+		Texture* freeDiffuse = Texture::load(freeDiffusePath);
+		Texture* freeSpecular = Texture::load(freeSpecularPath);
+		Texture* freeNormal = Texture::load(freeNormalPath, TextureType::NORMAL_MAP);
+
+		Mesh* freeMesh = new Mesh(freeTerrainMesh.vertices, freeTerrainMesh.indices, freeDiffuse, freeSpecular,
+			freeNormal, 32.0f);
+		mapMeshes.push_back(freeMesh);
+	}
+
+	return new Model(mapMeshes);
+}
 
+// Load the six textures used by the terrain models. The textures are not referenced, so the caller must increase
+// their references to keep them loaded. Must be called from the thread that owns the GL context.
+std::vector<Texture*> Map::loadTerrainTextures()
+{
+	std::vector<Texture*> terrainTextures;
+
+	terrainTextures.push_back(Texture::load(blockedDiffusePath));
+	terrainTextures.push_back(Texture::load(blockedSpecularPath));
+	terrainTextures.push_back(Texture::load(blockedNormalPath, TextureType::NORMAL_MAP));
+	terrainTextures.push_back(Texture::load(freeDiffusePath));
+	terrainTextures.push_back(Texture::load(freeSpecularPath));
+	terrainTextures.push_back(Texture::load(freeNormalPath, TextureType::NORMAL_MAP));
+
+	return terrainTextures;
+}
+
+// Generate one box for each blocked cell and one quad for each free cell in range.
+void Map::getPerCellTerrainMeshes(const MapCellRange& range, TerrainMesh& blockedTerrainMesh,
+	TerrainMesh& freeTerrainMesh) const
+{
 	TerrainMesh terrainMesh;
 	int blockedLastIndex = 0;
 	int freeLastIndex = 0;
 
-	for (int i = 0; i < this->mapHeight; ++i)
-		for (int j = 0; j < this->mapWidth; ++j)
+	for (int i = range.z; i < range.z + range.zQuantity; ++i)
+		for (int j = range.x; j < range.x + range.xQuantity; ++j)
 		{
 			TerrainType terrainType = this->getTerrainType(glm::vec4(this->mapXScalement * j, 0.0f,
 				this->mapZScalement * i, 1.0f));
@@ -49,16 +504,20 @@ Model* Map::generateMapModel() const
 				for (unsigned int i = 0; i < terrainMesh.indices.size(); ++i)
 					terrainMesh.indices[i] = terrainMesh.indices[i] + blockedLastIndex;
 				blockedLastIndex += terrainMesh.vertices.size();
-				blockedMeshVertices.insert(blockedMeshVertices.end(), terrainMesh.vertices.begin(), terrainMesh.vertices.end());
-				blockedMeshIndices.insert(blockedMeshIndices.end(), terrainMesh.indices.begin(), terrainMesh.indices.end());
+				blockedTerrainMesh.vertices.insert(blockedTerrainMesh.vertices.end(), terrainMesh.vertices.begin(),
+					terrainMesh.vertices.end());
+				blockedTerrainMesh.indices.insert(blockedTerrainMesh.indices.end(), terrainMesh.indices.begin(),
+					terrainMesh.indices.end());
 				break;
 			case TerrainType::FREE:
 				terrainMesh = this->getFreeTerainVerticesAndIndices(this->mapXScalement * j, this->mapZScalement * i);
 				for (unsigned int i = 0; i < terrainMesh.indices.size(); ++i)
 					terrainMesh.indices[i] = terrainMesh.indices[i] + freeLastIndex;
 				freeLastIndex += terrainMesh.vertices.size();
-				freeMeshVertices.insert(freeMeshVertices.end(), terrainMesh.vertices.begin(), terrainMesh.vertices.end());
-				freeMeshIndices.insert(freeMeshIndices.end(), terrainMesh.indices.begin(), terrainMesh.indices.end());
+				freeTerrainMesh.vertices.insert(freeTerrainMesh.vertices.end(), terrainMesh.vertices.begin(),
+					terrainMesh.vertices.end());
+				freeTerrainMesh.indices.insert(freeTerrainMesh.indices.end(), terrainMesh.indices.begin(),
+					terrainMesh.indices.end());
 				break;
 			case TerrainType::OUT:
 			default:
@@ -66,110 +525,164 @@ Model* Map::generateMapModel() const
 				break;
 			}
 		}
+}
 
-	Texture* blockedDiffuse = Texture::load(".\\res\\art\\brickwall_diffuse.jpg");
-	Texture* blockedSpecular = Texture::load(".\\res\\art\\black.png");
-	Texture* blockedNormal = Texture::load(".\\res\\art\\brickwall_normal.jpg");
+// Cells outside the map are not blocked, so the faces at the border of the map are kept.
+bool Map::isCellBlocked(int x, int z) const
+{
+	if (x < 0 || x >= this->mapWidth || z < 0 || z >= this->mapHeight)
+		return false;
 
-	Mesh* blockedMesh = new Mesh(blockedMeshVertices, blockedMeshIndices, blockedDiffuse, blockedSpecular, blockedNormal, 32.0f);
-		
-	Texture* freeDiffuse = Texture::load(".\\res\\art\\grass01.jpg");
-	Texture* freeSpecular = Texture::load(".\\res\\art\\grass01_s.jpg");
-	Texture* freeNormal = Texture::load(".\\res\\art\\grass01_n.jpg");
+	return !this->isCellFree(x, z);
+}
 
-	Mesh* freeMesh = new Mesh(freeMeshVertices, freeMeshIndices, freeDiffuse, freeSpecular, freeNormal, 32.0f);
+// Generate the blocked terrain in range with greedy meshing.
+// Floors and tops are merged in both directions. Side faces are only emitted where the neighbour cell is not blocked
+// and are merged along the wall. Faces have the same orientation, normals and texture layout of the per cell mesh.
+TerrainMesh Map::getGreedyBlockedTerrainMesh(const MapCellRange& range) const
+{
+	TerrainMesh terrainMesh;
+	std::vector<MapRectangle> rectangles;
+	std::vector<unsigned char> mask(range.xQuantity * range.zQuantity);
+	float xScale = this->mapXScalement;
+	float yScale = this->mapYScalement;
+	float zScale = this->mapZScalement;
 
-	mapMeshes.push_back(blockedMesh);
-	mapMeshes.push_back(freeMesh);
+	// FLOOR and TOP (u = x, v = z)
+	for (int v = 0; v < range.zQuantity; ++v)
+		for (int u = 0; u < range.xQuantity; ++u)
+			mask[v * range.xQuantity + u] = this->isCellBlocked(range.x + u, range.z + v);
 
-	return new Model(mapMeshes);
-}
+	getGreedyRectangles(mask, range.xQuantity, range.zQuantity, true, rectangles);
 
-std::vector<MapWallDescriptor> Map::generateMapWallDescriptors() const
-{
-	std::vector<MapWallDescriptor> mapWallDescriptors;
-	std::vector<MapWallDescriptor> auxiliar;
+	for (unsigned int i = 0; i < rectangles.size(); ++i)
+	{
+		const MapRectangle& r = rectangles[i];
+		glm::vec4 uEdge = glm::vec4(r.uLength * xScale, 0.0f, 0.0f, 0.0f);
+		glm::vec4 vEdge = glm::vec4(0.0f, 0.0f, r.vLength * zScale, 0.0f);
+		float xPos = (range.x + r.u) * xScale;
+		float zPos = (range.z + r.v) * zScale;
+
+		appendTerrainQuad(terrainMesh, glm::vec4(xPos, 0.0f, zPos, 1.0f), uEdge, vEdge,
+			(float)r.uLength, (float)r.vLength, glm::vec4(0.0f, -1.0f, 0.0f, 0.0f));
+		appendTerrainQuad(terrainMesh, glm::vec4(xPos, yScale, zPos, 1.0f), uEdge, vEdge,
+			(float)r.uLength, (float)r.vLength, glm::vec4(0.0f, 1.0f, 0.0f, 0.0f));
+	}
+
+	// LEFT and RIGHT (u = z, v = x), merged along z only
+	for (int side = 0; side < 2; ++side)
+	{
+		int neighbourOffset = (side == 0) ? -1 : 1;
 
-	for (int i = 0; i < this->mapHeight; ++i)
-		for (int j = 0; j < this->mapWidth; ++j)
+		for (int v = 0; v < range.xQuantity; ++v)
+			for (int u = 0; u < range.zQuantity; ++u)
+				mask[v * range.zQuantity + u] = this->isCellBlocked(range.x + v, range.z + u) &&
+					!this->isCellBlocked(range.x + v + neighbourOffset, range.z + u);
+
+		rectangles.clear();
+		getGreedyRectangles(mask, range.zQuantity, range.xQuantity, false, rectangles);
+
+		for (unsigned int i = 0; i < rectangles.size(); ++i)
 		{
-			TerrainType terrainType = this->getTerrainType(glm::vec4(this->mapXScalement * j, 0.0f,
-				this->mapZScalement * i, 1.0f));
+			const MapRectangle& r = rectangles[i];
+			float xPos = (side == 0) ? (range.x + r.v) * xScale : (range.x + r.v + 1) * xScale;
 
-			switch (terrainType)
-			{
-			case TerrainType::BLOCKED:
-				auxiliar = this->getMapWallDescriptorsForBlockedTerrain(this->mapXScalement * j,
-					this->mapZScalement * i);
-				// Append Vector
-				mapWallDescriptors.insert(mapWallDescriptors.end(), auxiliar.begin(), auxiliar.end());
-				break;
-			case TerrainType::FREE:
-				auxiliar = this->getMapWallDescriptorsForFreeTerrain(this->mapXScalement * j,
-					this->mapZScalement * i);
-				// Append Vector
-				mapWallDescriptors.insert(mapWallDescriptors.end(), auxiliar.begin(), auxiliar.end());
-				break;
-			case TerrainType::OUT:
-			default:
-				throw "Error generating Map Wall Descriptor: Out of Bounds";
-				break;
-			}
+			appendTerrainQuad(terrainMesh, glm::vec4(xPos, 0.0f, (range.z + r.u) * zScale, 1.0f),
+				glm::vec4(0.0f, 0.0f, r.uLength * zScale, 0.0f), glm::vec4(0.0f, yScale, 0.0f, 0.0f),
+				(float)r.uLength, 1.0f, glm::vec4((float)neighbourOffset, 0.0f, 0.0f, 0.0f));
 		}
+	}
 
-	return mapWallDescriptors;
+	// FRONT and BACK (u = x, v = z), merged along x only
+	for (int side = 0; side < 2; ++side)
+	{
+		int neighbourOffset = (side == 0) ? -1 : 1;
+
+		for (int v = 0; v < range.zQuantity; ++v)
+			for (int u = 0; u < range.xQuantity; ++u)
+				mask[v * range.xQuantity + u] = this->isCellBlocked(range.x + u, range.z + v) &&
+					!this->isCellBlocked(range.x + u, range.z + v + neighbourOffset);
+
+		rectangles.clear();
+		getGreedyRectangles(mask, range.xQuantity, range.zQuantity, false, rectangles);
+
+		for (unsigned int i = 0; i < rectangles.size(); ++i)
+		{
+			const MapRectangle& r = rectangles[i];
+			float zPos = (side == 0) ? (range.z + r.v) * zScale : (range.z + r.v + 1) * zScale;
+
+			appendTerrainQuad(terrainMesh, glm::vec4((range.x + r.u) * xScale, 0.0f, zPos, 1.0f),
+				glm::vec4(r.uLength * xScale, 0.0f, 0.0f, 0.0f), glm::vec4(0.0f, yScale, 0.0f, 0.0f),
+				(float)r.uLength, 1.0f, glm::vec4(0.0f, 0.0f, (float)neighbourOffset, 0.0f));
+		}
+	}
+
+	return terrainMesh;
 }
 
-TerrainType Map::getTerrainType(const glm::vec4& position) const
+// Generate the free terrain in range with greedy meshing, merging the floor of neighbouring free cells.
+TerrainMesh Map::getGreedyFreeTerrainMesh(const MapCellRange& range) const
 {
-	glm::vec4 pixelColor;
-	int xPos = (int)floorf(position.x);
-	int zPos = (int)floorf(position.z);
-	
-	if (xPos < 0 || xPos > (this->mapWidth - 1) * this->mapXScalement)
-		return TerrainType::OUT;
-	if (zPos < 0 || zPos > (this->mapHeight - 1) * this->mapZScalement)
-		return TerrainType::OUT;
+	TerrainMesh terrainMesh;
+	std::vector<MapRectangle> rectangles;
+	std::vector<unsigned char> mask(range.xQuantity * range.zQuantity);
 
-	int z = (int)floorf((zPos / this->mapZScalement)) * mapChannels;
-	int x = (int)floorf((xPos / this->mapXScalement)) * mapChannels;
+	for (int v = 0; v < range.zQuantity; ++v)
+		for (int u = 0; u < range.xQuantity; ++u)
+			mask[v * range.xQuantity + u] = this->isCellFree(range.x + u, range.z + v);
 
-	pixelColor.r = (float)*(this->mapBytes + (x * this->mapWidth + z));
-	pixelColor.g = (float)*(this->mapBytes + (x * this->mapWidth + z + 1));
-	pixelColor.b = (float)*(this->mapBytes + (x * this->mapWidth + z + 2));
-	pixelColor.a = (float)*(this->mapBytes + (x * this->mapWidth + z + 3));
+	getGreedyRectangles(mask, range.xQuantity, range.zQuantity, true, rectangles);
 
-	if (pixelColor.r == 255)
+	for (unsigned int i = 0; i < rectangles.size(); ++i)
+	{
+		const MapRectangle& r = rectangles[i];
+
+		appendTerrainQuad(terrainMesh,
+			glm::vec4((range.x + r.u) * this->mapXScalement, 0.0f, (range.z + r.v) * this->mapZScalement, 1.0f),
+			glm::vec4(r.uLength * this->mapXScalement, 0.0f, 0.0f, 0.0f),
+			glm::vec4(0.0f, 0.0f, r.vLength * this->mapZScalement, 0.0f),
+			(float)r.uLength, (float)r.vLength, glm::vec4(0.0f, 1.0f, 0.0f, 0.0f));
+	}
+
+	return terrainMesh;
+}
+
+TerrainType Map::getTerrainType(const glm::vec4& position) const
+{
+	int x = (int)floorf(position.x / this->mapXScalement);
+	int z = (int)floorf(position.z / this->mapZScalement);
+
+	if (x < 0 || x >= this->mapWidth || z < 0 || z >= this->mapHeight)
+		return TerrainType::OUT;
+
+	if (this->isCellFree(x, z))
 		return TerrainType::FREE;
 	else
 		return TerrainType::BLOCKED;
 }
 
-TerrainType Map::getTerrainTypeForMovement(const glm::vec4& position) const
+// Test the movement from position to newPosition against the map.
+// The player is treated as a box in the XZ plane, which is swept from position to newPosition. The result is FREE
+// only if every cell touched by the swept box is free, so fast movements can't skip thin walls.
+// The cost depends on the movement length only, not on the map size.
+TerrainType Map::getTerrainTypeForMovement(const glm::vec4& position, const glm::vec4& newPosition) const
 {
-	const float collisionFactor = 0.2f;
-	TerrainType terrainType;
-
-	terrainType = this->getTerrainType(position);
+	float minX = glm::min(position.x, newPosition.x) - movementCollisionFactor;
+	float maxX = glm::max(position.x, newPosition.x) + movementCollisionFactor;
+	float minZ = glm::min(position.z, newPosition.z) - movementCollisionFactor;
+	float maxZ = glm::max(position.z, newPosition.z) + movementCollisionFactor;
 
-	if (terrainType == TerrainType::BLOCKED || terrainType == TerrainType::OUT)
-		return terrainType;
+	int firstX = (int)floorf(minX / this->mapXScalement);
+	int lastX = (int)floorf(maxX / this->mapXScalement);
+	int firstZ = (int)floorf(minZ / this->mapZScalement);
+	int lastZ = (int)floorf(maxZ / this->mapZScalement);
 
-	glm::vec4 testPositions[6] = { position, position, position, position, position, position };
-
-	testPositions[0].x += collisionFactor;
-	testPositions[1].x -= collisionFactor;
-	testPositions[2].y += collisionFactor;
-	testPositions[3].y -= collisionFactor;
-	testPositions[4].z += collisionFactor;
-	testPositions[5].z -= collisionFactor;
+	if (firstX < 0 || lastX >= this->mapWidth || firstZ < 0 || lastZ >= this->mapHeight)
+		return TerrainType::OUT;
 
-	for (unsigned int i = 0; i < 6; ++i)
-	{
-		terrainType = this->getTerrainType(testPositions[i]);
-		if (terrainType == TerrainType::BLOCKED || terrainType == TerrainType::OUT)
-			return terrainType;
-	}
+	for (int x = firstX; x <= lastX; ++x)
+		if (!this->isCellRowFree(x, firstZ, lastZ))
+			return TerrainType::BLOCKED;
 
 	return TerrainType::FREE;
 }
@@ -438,85 +951,6 @@ TerrainMesh Map::getFreeTerainVerticesAndIndices(float xPos, float zPos) const
 	return t;
 }
 
-std::vector<MapWallDescriptor> Map::getMapWallDescriptorsForBlockedTerrain(float xPos, float zPos) const
-{
-	MapWallDescriptor mapWallDescriptor;
-	std::vector<MapWallDescriptor> mapWallDescriptors;
-
-	// FLOOR
-	mapWallDescriptor.centerPosition = glm::vec4(xPos + (this->mapXScalement / 2.0f),
-		0.0f, zPos + (this->mapZScalement / 2.0f), 1.0f);
-	mapWallDescriptor.normalVector = glm::vec4(0.0f, -1.0f, 0.0f, 0.0f);
-	mapWallDescriptor.xLength = this->mapXScalement;
-	mapWallDescriptor.yLength = 0.0f;
-	mapWallDescriptor.zLength = this->mapZScalement;
-	mapWallDescriptors.push_back(mapWallDescriptor);
-
-	// TOP
-	mapWallDescriptor.centerPosition = glm::vec4(xPos + (this->mapXScalement / 2.0f),
-		this->mapYScalement, zPos + (this->mapZScalement / 2.0f), 1.0f);
-	mapWallDescriptor.normalVector = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
-	mapWallDescriptor.xLength = this->mapXScalement;
-	mapWallDescriptor.yLength = 0.0f;
-	mapWallDescriptor.zLength = this->mapZScalement;
-	mapWallDescriptors.push_back(mapWallDescriptor);
-
-	// LEFT
-	mapWallDescriptor.centerPosition = glm::vec4(xPos,
-		this->mapYScalement / 2.0f, zPos + (this->mapZScalement / 2.0f), 1.0f);
-	mapWallDescriptor.normalVector = glm::vec4(-1.0f, 0.0f, 0.0f, 0.0f);
-	mapWallDescriptor.xLength = 0.0f;
-	mapWallDescriptor.yLength = this->mapYScalement;
-	mapWallDescriptor.zLength = this->mapZScalement;
-	mapWallDescriptors.push_back(mapWallDescriptor);
-
-	// RIGHT
-	mapWallDescriptor.centerPosition = glm::vec4(xPos + this->mapXScalement,
-		this->mapYScalement / 2.0f, zPos + (this->mapZScalement / 2.0f), 1.0f);
-	mapWallDescriptor.normalVector = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
-	mapWallDescriptor.xLength = 0.0f;
-	mapWallDescriptor.yLength = this->mapYScalement;
-	mapWallDescriptor.zLength = this->mapZScalement;
-	mapWallDescriptors.push_back(mapWallDescriptor);
-
-	// FRONT
-	mapWallDescriptor.centerPosition = glm::vec4(xPos + (this->mapXScalement / 2.0f),
-		this->mapYScalement / 2.0f, zPos, 1.0f);
-	mapWallDescriptor.normalVector = glm::vec4(0.0f, 0.0f, -1.0f, 0.0f);
-	mapWallDescriptor.xLength = this->mapXScalement;
-	mapWallDescriptor.yLength = this->mapYScalement;
-	mapWallDescriptor.zLength = 0.0f;
-	mapWallDescriptors.push_back(mapWallDescriptor);
-
-	// BACK
-	mapWallDescriptor.centerPosition = glm::vec4(xPos + (this->mapXScalement / 2.0f),
-		this->mapYScalement / 2.0f, zPos + this->mapZScalement, 1.0f);
-	mapWallDescriptor.normalVector = glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
-	mapWallDescriptor.xLength = this->mapXScalement;
-	mapWallDescriptor.yLength = this->mapYScalement;
-	mapWallDescriptor.zLength = 0.0f;
-	mapWallDescriptors.push_back(mapWallDescriptor);
-
-	return mapWallDescriptors;
-}
-
-std::vector<MapWallDescriptor> Map::getMapWallDescriptorsForFreeTerrain(float xPos, float zPos) const
-{
-	MapWallDescriptor mapWallDescriptor;
-	std::vector<MapWallDescriptor> mapWallDescriptors;
-
-	// FLOOR
-	mapWallDescriptor.centerPosition = glm::vec4(xPos + (this->mapXScalement / 2.0f),
-		0.0f, zPos + (this->mapZScalement / 2.0f), 1.0f);
-	mapWallDescriptor.normalVector = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
-	mapWallDescriptor.xLength = this->mapXScalement;
-	mapWallDescriptor.yLength = 0.0f;
-	mapWallDescriptor.zLength = this->mapZScalement;
-	mapWallDescriptors.push_back(mapWallDescriptor);
-
-	return mapWallDescriptors;
-}
-
 float Map::getMapXSize() const
 {
 	return this->mapWidth * this->mapXScalement;
@@ -11,6 +11,12 @@ namespace raw
 		OUT
 	};
 
+	enum class MapMeshingMode
+	{
+		PER_CELL,
+		GREEDY
+	};
+
 	struct MapWallDescriptor
 	{
 		glm::vec4 normalVector;
@@ -20,6 +26,33 @@ namespace raw
 		float zLength;
 	};
 
+	// Four map walls stored in SoA layout, so they can be tested against a ray with a single SSE pass.
+	// Lengths are stored already halved. Unused lanes have a null normal vector and never collide.
+	struct MapWallPacket
+	{
+		float normalX[4];
+		float normalY[4];
+		float normalZ[4];
+		float normalW[4];
+		float centerX[4];
+		float centerY[4];
+		float centerZ[4];
+		float centerW[4];
+		float halfXLength[4];
+		float halfYLength[4];
+		float halfZLength[4];
+		unsigned int wallIndex[4];
+	};
+
+	// Rectangle of map cells, used to generate only a part of the map
+	struct MapCellRange
+	{
+		int x;
+		int z;
+		int xQuantity;
+		int zQuantity;
+	};
+
 	struct TerrainMesh
 	{
 		std::vector<Vertex> vertices;
@@ -30,24 +63,75 @@ namespace raw
 	{
 	public:
 		Map(const char* mapPath);
+		Map(const unsigned char* mapBytes, int mapWidth, int mapHeight);
 		~Map();
-		Model* generateMapModel() const;
+		Model* generateMapModel(MapMeshingMode meshingMode) const;
+		void generateChunkTerrainMeshes(int chunkX, int chunkZ, MapMeshingMode meshingMode,
+			TerrainMesh& blockedTerrainMesh, TerrainMesh& freeTerrainMesh) const;
+		Model* createTerrainModel(const TerrainMesh& blockedTerrainMesh, const TerrainMesh& freeTerrainMesh) const;
 		std::vector<MapWallDescriptor> generateMapWallDescriptors() const;
+		std::vector<MapWallDescriptor> generateChunkWallDescriptors(int chunkX, int chunkZ) const;
 		TerrainType getTerrainType(const glm::vec4& position) const;
-		TerrainType getTerrainTypeForMovement(const glm::vec4& position) const;
+		TerrainType getTerrainTypeForMovement(const glm::vec4& position, const glm::vec4& newPosition) const;
 		float getMapXSize() const;
 		float getMapYSize() const;
 		float getMapZSize() const;
+		int getChunkXQuantity() const;
+		int getChunkZQuantity() const;
+		glm::vec4 getChunkMinBounds(int chunkX, int chunkZ) const;
+		glm::vec4 getChunkMaxBounds(int chunkX, int chunkZ) const;
+		static std::vector<Texture*> loadTerrainTextures();
+		static bool checkMeshing(const char* mapPath);
 	private:
+		void initialize(const unsigned char* mapBytes);
+		MapCellRange getMapCellRange() const;
+		MapCellRange getChunkCellRange(int chunkX, int chunkZ) const;
+		void getTerrainMeshes(const MapCellRange& range, MapMeshingMode meshingMode, TerrainMesh& blockedTerrainMesh,
+			TerrainMesh& freeTerrainMesh) const;
+		void getPerCellTerrainMeshes(const MapCellRange& range, TerrainMesh& blockedTerrainMesh,
+			TerrainMesh& freeTerrainMesh) const;
+		TerrainMesh getGreedyBlockedTerrainMesh(const MapCellRange& range) const;
+		TerrainMesh getGreedyFreeTerrainMesh(const MapCellRange& range) const;
+		bool isCellBlocked(int x, int z) const;
 		TerrainMesh getBlockedTerrainVerticesAndIndices(float xPos, float zPos) const;
 		TerrainMesh getFreeTerainVerticesAndIndices(float xPos, float zPos) const;
-		std::vector<MapWallDescriptor> getMapWallDescriptorsForBlockedTerrain(float xPos, float zPos) const;
-		std::vector<MapWallDescriptor> getMapWallDescriptorsForFreeTerrain(float xPos, float zPos) const;
+		void createOccupancyBitmap(const unsigned char* mapBytes);
+		bool isCellFree(int x, int z) const;
+		bool isCellRowFree(int x, int firstZ, int lastZ) const;
 		float mapXScalement;
 		float mapYScalement;
 		float mapZScalement;
-		unsigned char* mapBytes;
 		int mapWidth;
 		int mapHeight;
+		// One bit per map cell, set if the cell is free. Each x row starts at a new word.
+		std::vector<unsigned int> occupancyBitmap;
+		int occupancyWordsPerRow;
 	};
+
+	// Check if cell (x, z) is free. The cell must be inside the map.
+	inline bool Map::isCellFree(int x, int z) const
+	{
+		return ((this->occupancyBitmap[x * this->occupancyWordsPerRow + (z >> 5)] >> (z & 31)) & 1) != 0;
+	}
+
+	// Check if all cells (x, firstZ) to (x, lastZ) are free. The cells must be inside the map.
+	inline bool Map::isCellRowFree(int x, int firstZ, int lastZ) const
+	{
+		const unsigned int* row = &this->occupancyBitmap[x * this->occupancyWordsPerRow];
+
+		for (int word = firstZ >> 5; word <= (lastZ >> 5); ++word)
+		{
+			unsigned int mask = 0xFFFFFFFF;
+
+			if (word == (firstZ >> 5))
+				mask &= 0xFFFFFFFF << (firstZ & 31);
+			if (word == (lastZ >> 5))
+				mask &= 0xFFFFFFFF >> (31 - (lastZ & 31));
+
+			if ((row[word] & mask) != mask)
+				return false;
+		}
+
+		return true;
+	}
 }
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include "MapLoader.h"
+#include "WorkerPool.h"
+
+using namespace raw;
+
+// Starts loading right away. The map must stay alive until the loader is destroyed.
+MapLoader::MapLoader(const Map* map, MapMeshingMode meshingMode, bool generateTerrain, bool generateWalls)
+{
+	this->map = map;
+	this->meshingMode = meshingMode;
+	this->generateTerrain = generateTerrain;
+	this->generateWalls = generateWalls;
+	this->bandQuantity = map->getChunkZQuantity();
+	this->finishedBands = 0;
+	this->finished = false;
+	this->mapWallDescriptors = new std::vector<MapWallDescriptor>();
+	this->mapWallGrid = 0;
+	this->mapWallBVH = 0;
+	this->bandBlockedTerrainMeshes.resize(this->bandQuantity);
+	this->bandFreeTerrainMeshes.resize(this->bandQuantity);
+	this->bandMapWallDescriptors.resize(this->bandQuantity);
+	this->loadThread = std::thread(&MapLoader::load, this);
+}
+
+// Waits for the background thread, if it is still running.
+MapLoader::~MapLoader()
+{
+	this->loadThread.join();
+
+	delete this->mapWallGrid;
+	delete this->mapWallBVH;
+	delete this->mapWallDescriptors;
+}
+
+bool MapLoader::isFinished() const
+{
+	return this->finished;
+}
+
+// Fraction of the bands already generated, from 0 to 1.
+float MapLoader::getProgress() const
+{
+	if (this->finished || this->bandQuantity == 0)
+		return 1.0f;
+
+	return (float)this->finishedBands / (float)this->bandQuantity;
+}
+
+// Upload the generated terrain. Must be called from the GL thread, after the loader finished.
+Model* MapLoader::createMapModel() const
+{
+	return this->map->createTerrainModel(this->blockedTerrainMesh, this->freeTerrainMesh);
+}
+
+// Hand the generated wall descriptors and the grid and the BVH built over them to the caller, which must delete
+// them, the structures first. The loader must be finished and must have generated the walls.
+void MapLoader::takeMapWallStructures(std::vector<MapWallDescriptor>*& mapWallDescriptors, MapWallGrid*& mapWallGrid,
+	MapWallBVH*& mapWallBVH)
+{
+	mapWallDescriptors = this->mapWallDescriptors;
+	mapWallGrid = this->mapWallGrid;
+	mapWallBVH = this->mapWallBVH;
+	this->mapWallDescriptors = 0;
+	this->mapWallGrid = 0;
+	this->mapWallBVH = 0;
+}
+
+// Background thread: generate all bands in parallel, then merge them in order.
+void MapLoader::load()
+{
+	WorkerPool workerPool(WorkerPool::getDefaultWorkerQuantity());
+	workerPool.run(MapLoader::generateBandsTask, this, this->bandQuantity, 1);
+
+	for (unsigned int i = 0; i < this->bandQuantity; ++i)
+	{
+		MapLoader::appendTerrainMesh(this->blockedTerrainMesh, this->bandBlockedTerrainMeshes[i]);
+		MapLoader::appendTerrainMesh(this->freeTerrainMesh, this->bandFreeTerrainMeshes[i]);
+		this->mapWallDescriptors->insert(this->mapWallDescriptors->end(), this->bandMapWallDescriptors[i].begin(),
+			this->bandMapWallDescriptors[i].end());
+	}
+
+	// Band data is not needed anymore
+	std::vector<TerrainMesh>().swap(this->bandBlockedTerrainMeshes);
+	std::vector<TerrainMesh>().swap(this->bandFreeTerrainMeshes);
+	std::vector<std::vector<MapWallDescriptor>>().swap(this->bandMapWallDescriptors);
+
+	// The grid has about one cell per wall, so shots only test walls near the ray. The BVH can be selected instead of
+	// the grid. Both share the same descriptors
+	if (this->generateWalls)
+	{
+		this->mapWallGrid = new MapWallGrid(*this->mapWallDescriptors,
+			MapWallGrid::calculateCellSize(*this->mapWallDescriptors));
+		this->mapWallBVH = new MapWallBVH(*this->mapWallDescriptors);
+	}
+
+	this->finished = true;
+}
+
+// Generate the terrain and/or walls of all chunks in one band (one row of chunks).
+void MapLoader::generateBand(unsigned int band)
+{
+	for (int chunkX = 0; chunkX < this->map->getChunkXQuantity(); ++chunkX)
+	{
+		if (this->generateTerrain)
+		{
+			TerrainMesh chunkBlockedTerrainMesh;
+			TerrainMesh chunkFreeTerrainMesh;
+			this->map->generateChunkTerrainMeshes(chunkX, band, this->meshingMode, chunkBlockedTerrainMesh,
+				chunkFreeTerrainMesh);
+			MapLoader::appendTerrainMesh(this->bandBlockedTerrainMeshes[band], chunkBlockedTerrainMesh);
+			MapLoader::appendTerrainMesh(this->bandFreeTerrainMeshes[band], chunkFreeTerrainMesh);
+		}
+
+		if (this->generateWalls)
+		{
+			std::vector<MapWallDescriptor> chunkWallDescriptors = this->map->generateChunkWallDescriptors(chunkX, band);
+			this->bandMapWallDescriptors[band].insert(this->bandMapWallDescriptors[band].end(),
+				chunkWallDescriptors.begin(), chunkWallDescriptors.end());
+		}
+	}
+
+	++this->finishedBands;
+}
+
+void MapLoader::generateBandsTask(void* taskData, unsigned int begin, unsigned int end)
+{
+	MapLoader* mapLoader = (MapLoader*)taskData;
+
+	for (unsigned int i = begin; i < end; ++i)
+		mapLoader->generateBand(i);
+}
+
+// Append source to destination, shifting the indices of source.
+void MapLoader::appendTerrainMesh(TerrainMesh& destination, const TerrainMesh& source)
+{
+	unsigned int firstIndex = destination.vertices.size();
+
+	destination.vertices.insert(destination.vertices.end(), source.vertices.begin(), source.vertices.end());
+
+	for (unsigned int i = 0; i < source.indices.size(); ++i)
+		destination.indices.push_back(source.indices[i] + firstIndex);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Map.h"
+#include "MapWallGrid.h"
+#include "MapWallBVH.h"
+#include <vector>
+#include <thread>
+#include <atomic>
+
+namespace raw
+{
+	// Generates the terrain meshes and/or the wall descriptors of a map in a background thread.
+	// The map is split in bands (one row of chunks each) that are generated in parallel by a worker pool and merged
+	// at the end. The grid and the BVH over the walls are also built in the background thread.
+	// The GL upload is left to createMapModel(), which must be called from the GL thread.
+	class MapLoader
+	{
+	public:
+		MapLoader(const Map* map, MapMeshingMode meshingMode, bool generateTerrain, bool generateWalls);
+		~MapLoader();
+		bool isFinished() const;
+		float getProgress() const;
+		Model* createMapModel() const;
+		void takeMapWallStructures(std::vector<MapWallDescriptor>*& mapWallDescriptors, MapWallGrid*& mapWallGrid,
+			MapWallBVH*& mapWallBVH);
+	private:
+		void load();
+		void generateBand(unsigned int band);
+		static void generateBandsTask(void* taskData, unsigned int begin, unsigned int end);
+		static void appendTerrainMesh(TerrainMesh& destination, const TerrainMesh& source);
+		const Map* map;
+		MapMeshingMode meshingMode;
+		bool generateTerrain;
+		bool generateWalls;
+		std::thread loadThread;
+		unsigned int bandQuantity;
+		std::atomic<unsigned int> finishedBands;
+		std::atomic<bool> finished;
+		std::vector<TerrainMesh> bandBlockedTerrainMeshes;
+		std::vector<TerrainMesh> bandFreeTerrainMeshes;
+		std::vector<std::vector<MapWallDescriptor>> bandMapWallDescriptors;
+		TerrainMesh blockedTerrainMesh;
+		TerrainMesh freeTerrainMesh;
+		// Owned by the loader until they are taken
+		std::vector<MapWallDescriptor>* mapWallDescriptors;
+		MapWallGrid* mapWallGrid;
+		MapWallBVH* mapWallBVH;
+	};
+}
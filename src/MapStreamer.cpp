@@ -0,0 +1,231 @@
+#include "MapStreamer.h"
+#include "Model.h"
+#include "WorkerPool.h"
+
+using namespace raw;
+
+// Creates the streamer, loads the terrain textures and starts its generation thread.
+// No chunk is loaded until update() is called. unloadDistance should be bigger than loadDistance, so chunks on the
+// border are not reloaded every frame.
+MapStreamer::MapStreamer(const Map* map, MapMeshingMode meshingMode, float loadDistance, float unloadDistance)
+{
+	unsigned int chunkQuantity = map->getChunkXQuantity() * map->getChunkZQuantity();
+
+	this->map = map;
+	this->meshingMode = meshingMode;
+	this->loadDistance = loadDistance;
+	this->unloadDistance = glm::max(loadDistance, unloadDistance);
+	this->chunkEntities.assign(chunkQuantity, 0);
+	this->requestedChunks.assign(chunkQuantity, false);
+	this->terrainTextures = Map::loadTerrainTextures();
+
+	for (unsigned int i = 0; i < this->terrainTextures.size(); ++i)
+		this->terrainTextures[i]->increaseReferences();
+
+	this->stop = false;
+	this->generationThread = std::thread(&MapStreamer::generateChunks, this);
+}
+
+// Waits for the chunks being generated, then destroys all chunks and releases the terrain textures.
+MapStreamer::~MapStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->stop = true;
+	}
+	this->chunksRequested.notify_one();
+	this->generationThread.join();
+
+	for (unsigned int i = 0; i < this->generatedChunks.size(); ++i)
+		delete this->generatedChunks[i];
+
+	while (this->loadedChunks.size() > 0)
+		this->unloadChunk(this->loadedChunks.back());
+
+	for (unsigned int i = 0; i < this->terrainTextures.size(); ++i)
+	{
+		this->terrainTextures[i]->decreaseReferences();
+		Texture::destroy(this->terrainTextures[i]);
+	}
+}
+
+// Upload the chunks generated since the last update, unload the chunks farther than unloadDistance from all
+// positions and request the chunks closer than loadDistance to any of them. Only the chunks around the positions
+// are visited, so the cost does not depend on the map size.
+void MapStreamer::update(const std::vector<glm::vec4>& positions)
+{
+	this->uploadGeneratedChunks();
+
+	// Unload chunks that are far from every position
+	for (unsigned int i = 0; i < this->loadedChunks.size(); )
+	{
+		unsigned int chunkIndex = this->loadedChunks[i];
+		int chunkX = chunkIndex % this->map->getChunkXQuantity();
+		int chunkZ = chunkIndex / this->map->getChunkXQuantity();
+		bool isNear = false;
+
+		for (unsigned int j = 0; j < positions.size() && !isNear; ++j)
+			isNear = this->getDistanceToChunk(chunkX, chunkZ, positions[j]) <= this->unloadDistance;
+
+		if (isNear)
+			++i;
+		else
+			this->unloadChunk(chunkIndex);
+	}
+
+	// Request chunks near each position
+	std::vector<unsigned int> newChunks;
+	float chunkXSize = this->map->getChunkMaxBounds(0, 0).x - this->map->getChunkMinBounds(0, 0).x;
+	float chunkZSize = this->map->getChunkMaxBounds(0, 0).z - this->map->getChunkMinBounds(0, 0).z;
+
+	for (unsigned int i = 0; i < positions.size(); ++i)
+	{
+		int firstChunkX = glm::max(0, (int)floorf((positions[i].x - this->loadDistance) / chunkXSize));
+		int lastChunkX = glm::min(this->map->getChunkXQuantity() - 1,
+			(int)floorf((positions[i].x + this->loadDistance) / chunkXSize));
+		int firstChunkZ = glm::max(0, (int)floorf((positions[i].z - this->loadDistance) / chunkZSize));
+		int lastChunkZ = glm::min(this->map->getChunkZQuantity() - 1,
+			(int)floorf((positions[i].z + this->loadDistance) / chunkZSize));
+
+		for (int chunkZ = firstChunkZ; chunkZ <= lastChunkZ; ++chunkZ)
+			for (int chunkX = firstChunkX; chunkX <= lastChunkX; ++chunkX)
+			{
+				unsigned int chunkIndex = chunkZ * this->map->getChunkXQuantity() + chunkX;
+
+				if (!this->chunkEntities[chunkIndex] && !this->requestedChunks[chunkIndex] &&
+					this->getDistanceToChunk(chunkX, chunkZ, positions[i]) <= this->loadDistance)
+				{
+					this->requestedChunks[chunkIndex] = true;
+					newChunks.push_back(chunkIndex);
+				}
+			}
+	}
+
+	if (newChunks.size() > 0)
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->pendingChunks.insert(this->pendingChunks.end(), newChunks.begin(), newChunks.end());
+		}
+		this->chunksRequested.notify_one();
+	}
+}
+
+// Submit all loaded chunks to the render queue. Chunks are rendered without face culling.
+void MapStreamer::submit(RenderQueue& renderQueue, const Shader& shader, const Camera& camera,
+	const std::vector<Light*>& lights, bool useNormalMap) const
+{
+	for (unsigned int i = 0; i < this->loadedChunks.size(); ++i)
+		this->chunkEntities[this->loadedChunks[i]]->submit(renderQueue, shader, camera, lights, useNormalMap, false);
+}
+
+unsigned int MapStreamer::getLoadedChunkQuantity() const
+{
+	return this->loadedChunks.size();
+}
+
+// Distance, in the XZ plane, from position to the closest point of the chunk.
+float MapStreamer::getDistanceToChunk(int chunkX, int chunkZ, const glm::vec4& position) const
+{
+	glm::vec4 minBounds = this->map->getChunkMinBounds(chunkX, chunkZ);
+	glm::vec4 maxBounds = this->map->getChunkMaxBounds(chunkX, chunkZ);
+	float xDistance = glm::max(0.0f, glm::max(minBounds.x - position.x, position.x - maxBounds.x));
+	float zDistance = glm::max(0.0f, glm::max(minBounds.z - position.z, position.z - maxBounds.z));
+
+	return sqrtf(xDistance * xDistance + zDistance * zDistance);
+}
+
+// Upload the chunks already generated by the generation thread.
+// Chunks that got far while they were generated are uploaded as well, update() unloads them right after.
+void MapStreamer::uploadGeneratedChunks()
+{
+	std::vector<MapChunkMeshes*> uploadedChunks;
+
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		uploadedChunks.swap(this->generatedChunks);
+	}
+
+	for (unsigned int i = 0; i < uploadedChunks.size(); ++i)
+	{
+		unsigned int chunkIndex = uploadedChunks[i]->chunkIndex;
+		Model* chunkModel = this->map->createTerrainModel(uploadedChunks[i]->blockedTerrainMesh,
+			uploadedChunks[i]->freeTerrainMesh);
+
+		this->chunkEntities[chunkIndex] = new Entity(chunkModel);
+		this->requestedChunks[chunkIndex] = false;
+		this->loadedChunks.push_back(chunkIndex);
+		delete uploadedChunks[i];
+	}
+}
+
+// Destroy the chunk model, releasing its GPU buffers.
+void MapStreamer::unloadChunk(unsigned int chunkIndex)
+{
+	Entity* chunkEntity = this->chunkEntities[chunkIndex];
+
+	delete chunkEntity->getModel();
+	delete chunkEntity;
+	this->chunkEntities[chunkIndex] = 0;
+
+	for (unsigned int i = 0; i < this->loadedChunks.size(); ++i)
+		if (this->loadedChunks[i] == chunkIndex)
+		{
+			this->loadedChunks[i] = this->loadedChunks.back();
+			this->loadedChunks.pop_back();
+			break;
+		}
+}
+
+// Generation thread: wait for requested chunks and generate their terrain meshes with a worker pool.
+void MapStreamer::generateChunks()
+{
+	WorkerPool workerPool(WorkerPool::getDefaultWorkerQuantity());
+	std::vector<unsigned int> chunks;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			while (!this->stop && this->pendingChunks.empty())
+				this->chunksRequested.wait(lock);
+
+			if (this->stop)
+				return;
+
+			chunks.swap(this->pendingChunks);
+		}
+
+		for (unsigned int i = 0; i < chunks.size(); ++i)
+		{
+			MapChunkMeshes* chunkMeshes = new MapChunkMeshes();
+			chunkMeshes->chunkIndex = chunks[i];
+			this->generatingChunks.push_back(chunkMeshes);
+		}
+		chunks.clear();
+
+		workerPool.run(MapStreamer::generateChunksTask, this, this->generatingChunks.size(), 1);
+
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->generatedChunks.insert(this->generatedChunks.end(), this->generatingChunks.begin(),
+				this->generatingChunks.end());
+		}
+		this->generatingChunks.clear();
+	}
+}
+
+void MapStreamer::generateChunksTask(void* taskData, unsigned int begin, unsigned int end)
+{
+	MapStreamer* mapStreamer = (MapStreamer*)taskData;
+
+	for (unsigned int i = begin; i < end; ++i)
+	{
+		MapChunkMeshes* chunkMeshes = mapStreamer->generatingChunks[i];
+		int chunkX = chunkMeshes->chunkIndex % mapStreamer->map->getChunkXQuantity();
+		int chunkZ = chunkMeshes->chunkIndex / mapStreamer->map->getChunkXQuantity();
+
+		mapStreamer->map->generateChunkTerrainMeshes(chunkX, chunkZ, mapStreamer->meshingMode,
+			chunkMeshes->blockedTerrainMesh, chunkMeshes->freeTerrainMesh);
+	}
+}
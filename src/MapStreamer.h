@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Map.h"
+#include "Entity.h"
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace raw
+{
+	// Terrain meshes of a chunk, generated in the background and waiting to be uploaded
+	struct MapChunkMeshes
+	{
+		unsigned int chunkIndex;
+		TerrainMesh blockedTerrainMesh;
+		TerrainMesh freeTerrainMesh;
+	};
+
+	// Keeps only the map chunks near a set of positions (usually the active cameras) in memory.
+	// Chunks are requested when a position gets close to them and destroyed when all positions are far.
+	// Requested chunks are generated by a worker pool in a background thread, so the frame never waits for them,
+	// and uploaded by update(), in the GL thread, once they are ready.
+	class MapStreamer
+	{
+	public:
+		MapStreamer(const Map* map, MapMeshingMode meshingMode, float loadDistance, float unloadDistance);
+		~MapStreamer();
+		void update(const std::vector<glm::vec4>& positions);
+		void submit(RenderQueue& renderQueue, const Shader& shader, const Camera& camera,
+			const std::vector<Light*>& lights, bool useNormalMap) const;
+		unsigned int getLoadedChunkQuantity() const;
+	private:
+		float getDistanceToChunk(int chunkX, int chunkZ, const glm::vec4& position) const;
+		void uploadGeneratedChunks();
+		void unloadChunk(unsigned int chunkIndex);
+		void generateChunks();
+		static void generateChunksTask(void* taskData, unsigned int begin, unsigned int end);
+		const Map* map;
+		MapMeshingMode meshingMode;
+		float loadDistance;
+		float unloadDistance;
+		// One entry per chunk of the map, null if the chunk is not loaded
+		std::vector<Entity*> chunkEntities;
+		// One entry per chunk of the map, set while the chunk is being generated
+		std::vector<bool> requestedChunks;
+		std::vector<unsigned int> loadedChunks;
+		// Referenced for the whole life of the streamer, so unloading the last chunk does not destroy them
+		std::vector<Texture*> terrainTextures;
+		// Shared with the generation thread
+		std::thread generationThread;
+		std::mutex mutex;
+		std::condition_variable chunksRequested;
+		std::vector<unsigned int> pendingChunks;
+		std::vector<MapChunkMeshes*> generatedChunks;
+		bool stop;
+		// Only used by the generation thread and its workers
+		std::vector<MapChunkMeshes*> generatingChunks;
+	};
+}
@@ -0,0 +1,17 @@
+#include "MapWallAccelerationStructure.h"
+
+using namespace raw;
+
+MapWallAccelerationStructure::MapWallAccelerationStructure(const std::vector<MapWallDescriptor>& mapWallDescriptors)
+	: mapWallDescriptors(mapWallDescriptors)
+{
+}
+
+MapWallAccelerationStructure::~MapWallAccelerationStructure()
+{
+}
+
+const std::vector<MapWallDescriptor>& MapWallAccelerationStructure::getMapWallDescriptors() const
+{
+	return this->mapWallDescriptors;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Collision.h"
+#include <vector>
+
+namespace raw
+{
+	// Base class of the structures built over the map walls to speed up ray-wall queries.
+	// Every implementation must return exactly what Collision's linear search would return.
+	// The wall descriptors are not copied, so several structures can share them. They must outlive the structure.
+	class MapWallAccelerationStructure
+	{
+	public:
+		MapWallAccelerationStructure(const std::vector<MapWallDescriptor>& mapWallDescriptors);
+		virtual ~MapWallAccelerationStructure();
+		const std::vector<MapWallDescriptor>& getMapWallDescriptors() const;
+		virtual CollisionDescriptor getClosestWallRayIsColliding(const glm::vec4& rayPosition,
+			const glm::vec4& rayDirection) const = 0;
+	protected:
+		const std::vector<MapWallDescriptor>& mapWallDescriptors;
+	};
+}
@@ -0,0 +1,297 @@
+#include "MapWallBVH.h"
+#include <algorithm>
+#include <cfloat>
+
+using namespace raw;
+
+// Walls per leaf. Must be a multiple of the packet width.
+static const unsigned int wallsPerLeaf = 4;
+// Node bounds are enlarged by this value, so flat walls and rounding errors never make a node miss a ray.
+static const float boundsTolerance = 0.001f;
+// A node is skipped only if it starts this much (relatively) after the nearest hit found so far.
+static const float pruneTolerance = 0.0001f;
+// Enough for any tree built with median splits.
+static const unsigned int maxTraversalDepth = 64;
+
+// Orders wall indexes by the wall center in one axis.
+struct MapWallCenterComparator
+{
+	const std::vector<MapWallDescriptor>* mapWallDescriptors;
+	int axis;
+
+	bool operator()(unsigned int a, unsigned int b) const
+	{
+		return (*mapWallDescriptors)[a].centerPosition[axis] < (*mapWallDescriptors)[b].centerPosition[axis];
+	}
+};
+
+// Builds the tree splitting the walls at the median of the largest axis.
+MapWallBVH::MapWallBVH(const std::vector<MapWallDescriptor>& mapWallDescriptors)
+	: MapWallAccelerationStructure(mapWallDescriptors)
+{
+	if (mapWallDescriptors.size() == 0)
+		return;
+
+	std::vector<unsigned int> wallIndexes(mapWallDescriptors.size());
+
+	for (unsigned int i = 0; i < wallIndexes.size(); ++i)
+		wallIndexes[i] = i;
+
+	this->nodes.reserve(2 * (mapWallDescriptors.size() / wallsPerLeaf + 1));
+	this->packets.reserve(mapWallDescriptors.size() / 4 + 1);
+	this->nodes.resize(1);
+	this->buildNode(0, wallIndexes, 0, wallIndexes.size());
+}
+
+MapWallBVH::~MapWallBVH()
+{
+}
+
+unsigned int MapWallBVH::getNodeQuantity() const
+{
+	return this->nodes.size();
+}
+
+unsigned int MapWallBVH::getPacketQuantity() const
+{
+	return this->packets.size();
+}
+
+void MapWallBVH::buildNode(unsigned int nodeIndex, std::vector<unsigned int>& wallIndexes, unsigned int begin,
+	unsigned int end)
+{
+	glm::vec3 minBounds = glm::vec3(FLT_MAX);
+	glm::vec3 maxBounds = glm::vec3(-FLT_MAX);
+	glm::vec3 minCenter = glm::vec3(FLT_MAX);
+	glm::vec3 maxCenter = glm::vec3(-FLT_MAX);
+
+	for (unsigned int i = begin; i < end; ++i)
+	{
+		const MapWallDescriptor& wall = this->mapWallDescriptors[wallIndexes[i]];
+		glm::vec3 center = glm::vec3(wall.centerPosition);
+		glm::vec3 halfLength = glm::vec3(wall.xLength, wall.yLength, wall.zLength) / 2.0f;
+
+		minBounds = glm::min(minBounds, center - halfLength);
+		maxBounds = glm::max(maxBounds, center + halfLength);
+		minCenter = glm::min(minCenter, center);
+		maxCenter = glm::max(maxCenter, center);
+	}
+
+	MapWallBVHNode node;
+	node.minBounds = minBounds - glm::vec3(boundsTolerance);
+	node.maxBounds = maxBounds + glm::vec3(boundsTolerance);
+	node.leftChild = 0;
+	node.firstPacket = 0;
+	node.packetQuantity = 0;
+
+	// Leaf
+	if (end - begin <= wallsPerLeaf)
+	{
+		node.firstPacket = this->packets.size();
+
+		for (unsigned int i = begin; i < end; i += 4)
+			this->createPacket(wallIndexes, i, glm::min(i + 4, end));
+
+		node.packetQuantity = this->packets.size() - node.firstPacket;
+		this->nodes[nodeIndex] = node;
+		return;
+	}
+
+	// Interior node: split at the median of the largest axis
+	glm::vec3 centerExtent = maxCenter - minCenter;
+	MapWallCenterComparator comparator;
+	comparator.mapWallDescriptors = &this->mapWallDescriptors;
+	comparator.axis = 0;
+
+	if (centerExtent.y > centerExtent[comparator.axis])
+		comparator.axis = 1;
+	if (centerExtent.z > centerExtent[comparator.axis])
+		comparator.axis = 2;
+
+	unsigned int middle = begin + (end - begin) / 2;
+	std::nth_element(wallIndexes.begin() + begin, wallIndexes.begin() + middle, wallIndexes.begin() + end, comparator);
+
+	node.leftChild = this->nodes.size();
+	this->nodes[nodeIndex] = node;
+	this->nodes.resize(this->nodes.size() + 2);
+
+	this->buildNode(node.leftChild, wallIndexes, begin, middle);
+	this->buildNode(node.leftChild + 1, wallIndexes, middle, end);
+}
+
+void MapWallBVH::createPacket(const std::vector<unsigned int>& wallIndexes, unsigned int begin, unsigned int end)
+{
+	MapWallPacket packet;
+
+	for (unsigned int i = 0; i < 4; ++i)
+	{
+		if (begin + i < end)
+		{
+			const MapWallDescriptor& wall = this->mapWallDescriptors[wallIndexes[begin + i]];
+			packet.normalX[i] = wall.normalVector.x;
+			packet.normalY[i] = wall.normalVector.y;
+			packet.normalZ[i] = wall.normalVector.z;
+			packet.normalW[i] = wall.normalVector.w;
+			packet.centerX[i] = wall.centerPosition.x;
+			packet.centerY[i] = wall.centerPosition.y;
+			packet.centerZ[i] = wall.centerPosition.z;
+			packet.centerW[i] = wall.centerPosition.w;
+			packet.halfXLength[i] = wall.xLength / 2.0f;
+			packet.halfYLength[i] = wall.yLength / 2.0f;
+			packet.halfZLength[i] = wall.zLength / 2.0f;
+			packet.wallIndex[i] = wallIndexes[begin + i];
+		}
+		else
+		{
+			// Unused lane: a null normal is always 'parallel' to the ray
+			packet.normalX[i] = packet.normalY[i] = packet.normalZ[i] = packet.normalW[i] = 0.0f;
+			packet.centerX[i] = packet.centerY[i] = packet.centerZ[i] = packet.centerW[i] = 0.0f;
+			packet.halfXLength[i] = packet.halfYLength[i] = packet.halfZLength[i] = 0.0f;
+			packet.wallIndex[i] = 0xFFFFFFFF;
+		}
+	}
+
+	this->packets.push_back(packet);
+}
+
+// Slab test against the node bounds. Returns the ray parameter where the ray enters the node.
+static bool isRayCollidingWithNode(const glm::vec4& rayPosition, const glm::vec4& rayDirection,
+	const glm::vec3& rayInverseDirection, const MapWallBVHNode& node, float* tEnter)
+{
+	float tMin = 0.0f;
+	float tMax = FLT_MAX;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		if (rayDirection[axis] == 0.0f)
+		{
+			if (rayPosition[axis] < node.minBounds[axis] || rayPosition[axis] > node.maxBounds[axis])
+				return false;
+			continue;
+		}
+
+		float t0 = (node.minBounds[axis] - rayPosition[axis]) * rayInverseDirection[axis];
+		float t1 = (node.maxBounds[axis] - rayPosition[axis]) * rayInverseDirection[axis];
+
+		if (t0 > t1)
+			std::swap(t0, t1);
+
+		tMin = glm::max(tMin, t0);
+		tMax = glm::min(tMax, t1);
+
+		if (tMin > tMax)
+			return false;
+	}
+
+	*tEnter = tMin;
+	return true;
+}
+
+// Test ray-wall collision traversing the tree nearest node first.
+// The result is the same as testing every wall: ties are broken by the wall index, like the linear search.
+CollisionDescriptor MapWallBVH::getClosestWallRayIsColliding(const glm::vec4& rayPosition,
+	const glm::vec4& rayDirection) const
+{
+	CollisionDescriptor collisionDescriptor;
+	float nearestPositionDistance;
+	float nearestRayParameter = FLT_MAX;
+	unsigned int nearestWallIndex;
+
+	collisionDescriptor.collide = false;
+
+	if (this->nodes.size() == 0)
+		return collisionDescriptor;
+
+	glm::vec3 rayInverseDirection;
+
+	for (int axis = 0; axis < 3; ++axis)
+		rayInverseDirection[axis] = (rayDirection[axis] != 0.0f) ? 1.0f / rayDirection[axis] : 0.0f;
+
+	unsigned int nodeStack[maxTraversalDepth];
+	float nodeStackEnter[maxTraversalDepth];
+	unsigned int stackSize = 0;
+	float tEnter;
+
+	if (!isRayCollidingWithNode(rayPosition, rayDirection, rayInverseDirection, this->nodes[0], &tEnter))
+		return collisionDescriptor;
+
+	nodeStack[stackSize] = 0;
+	nodeStackEnter[stackSize] = tEnter;
+	++stackSize;
+
+	while (stackSize > 0)
+	{
+		--stackSize;
+		const MapWallBVHNode& node = this->nodes[nodeStack[stackSize]];
+
+		if (nodeStackEnter[stackSize] > nearestRayParameter * (1.0f + pruneTolerance))
+			continue;
+
+		// Leaf: test packets
+		if (node.packetQuantity > 0)
+		{
+			for (unsigned int i = node.firstPacket; i < node.firstPacket + node.packetQuantity; ++i)
+			{
+				const MapWallPacket& packet = this->packets[i];
+				CollisionDescriptor packetCollisionDescriptors[4];
+				float rayParameters[4];
+
+				if (!Collision::isRayCollidingWithWallPacket(rayPosition, rayDirection, packet,
+					packetCollisionDescriptors, rayParameters))
+					continue;
+
+				for (unsigned int j = 0; j < 4; ++j)
+				{
+					if (!packetCollisionDescriptors[j].collide)
+						continue;
+
+					unsigned int wallIndex = packet.wallIndex[j];
+					float currentPositionDistance = glm::length(rayPosition - packetCollisionDescriptors[j].worldPosition);
+
+					if (!collisionDescriptor.collide || currentPositionDistance < nearestPositionDistance ||
+						(currentPositionDistance == nearestPositionDistance && wallIndex < nearestWallIndex))
+					{
+						collisionDescriptor = packetCollisionDescriptors[j];
+						nearestPositionDistance = currentPositionDistance;
+						nearestRayParameter = rayParameters[j];
+						nearestWallIndex = wallIndex;
+					}
+				}
+			}
+
+			continue;
+		}
+
+		// Interior node: push the farther child first, so the nearer one is visited next
+		float leftEnter, rightEnter;
+		bool leftHit = isRayCollidingWithNode(rayPosition, rayDirection, rayInverseDirection,
+			this->nodes[node.leftChild], &leftEnter);
+		bool rightHit = isRayCollidingWithNode(rayPosition, rayDirection, rayInverseDirection,
+			this->nodes[node.leftChild + 1], &rightEnter);
+
+		if (leftHit && rightHit)
+		{
+			bool leftFirst = leftEnter <= rightEnter;
+			nodeStack[stackSize] = leftFirst ? node.leftChild + 1 : node.leftChild;
+			nodeStackEnter[stackSize] = leftFirst ? rightEnter : leftEnter;
+			++stackSize;
+			nodeStack[stackSize] = leftFirst ? node.leftChild : node.leftChild + 1;
+			nodeStackEnter[stackSize] = leftFirst ? leftEnter : rightEnter;
+			++stackSize;
+		}
+		else if (leftHit)
+		{
+			nodeStack[stackSize] = node.leftChild;
+			nodeStackEnter[stackSize] = leftEnter;
+			++stackSize;
+		}
+		else if (rightHit)
+		{
+			nodeStack[stackSize] = node.leftChild + 1;
+			nodeStackEnter[stackSize] = rightEnter;
+			++stackSize;
+		}
+	}
+
+	return collisionDescriptor;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "MapWallAccelerationStructure.h"
+#include <vector>
+
+namespace raw
+{
+	struct MapWallBVHNode
+	{
+		glm::vec3 minBounds;
+		glm::vec3 maxBounds;
+		unsigned int leftChild;			// Right child is always leftChild + 1
+		unsigned int firstPacket;
+		unsigned int packetQuantity;	// 0 for interior nodes
+	};
+
+	// Bounding volume hierarchy over the map walls. Leaves keep their walls in SoA packets of four,
+	// which are tested against the ray with Collision::isRayCollidingWithWallPacket.
+	class MapWallBVH : public MapWallAccelerationStructure
+	{
+	public:
+		MapWallBVH(const std::vector<MapWallDescriptor>& mapWallDescriptors);
+		~MapWallBVH();
+		unsigned int getNodeQuantity() const;
+		unsigned int getPacketQuantity() const;
+		virtual CollisionDescriptor getClosestWallRayIsColliding(const glm::vec4& rayPosition,
+			const glm::vec4& rayDirection) const;
+	private:
+		void buildNode(unsigned int nodeIndex, std::vector<unsigned int>& wallIndexes, unsigned int begin,
+			unsigned int end);
+		void createPacket(const std::vector<unsigned int>& wallIndexes, unsigned int begin, unsigned int end);
+		std::vector<MapWallBVHNode> nodes;
+		std::vector<MapWallPacket> packets;
+	};
+}
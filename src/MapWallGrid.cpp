@@ -0,0 +1,281 @@
+#include "MapWallGrid.h"
+#include <algorithm>
+#include <cfloat>
+
+using namespace raw;
+
+// Walls lying exactly on a cell border are stored in both neighbour cells.
+static const float borderTolerance = 0.001f;
+
+// Get the bounds of the walls in the XZ plane. There must be at least one wall.
+static void getWallBounds(const std::vector<MapWallDescriptor>& mapWallDescriptors, float& minX, float& maxX,
+	float& minZ, float& maxZ)
+{
+	minX = maxX = mapWallDescriptors[0].centerPosition.x;
+	minZ = maxZ = mapWallDescriptors[0].centerPosition.z;
+
+	for (unsigned int i = 0; i < mapWallDescriptors.size(); ++i)
+	{
+		const MapWallDescriptor& wall = mapWallDescriptors[i];
+		minX = glm::min(minX, wall.centerPosition.x - wall.xLength / 2.0f);
+		maxX = glm::max(maxX, wall.centerPosition.x + wall.xLength / 2.0f);
+		minZ = glm::min(minZ, wall.centerPosition.z - wall.zLength / 2.0f);
+		maxZ = glm::max(maxZ, wall.centerPosition.z + wall.zLength / 2.0f);
+	}
+}
+
+// Get a cell size that gives the grid about one cell per wall, rounded up to whole map cells.
+// The memory of the grid then grows with the quantity of walls instead of with the area of the map: large open areas
+// get big cells, which a ray crosses quickly because they hold few walls.
+float MapWallGrid::calculateCellSize(const std::vector<MapWallDescriptor>& mapWallDescriptors)
+{
+	if (mapWallDescriptors.size() == 0)
+		return 1.0f;
+
+	float minX, maxX, minZ, maxZ;
+	getWallBounds(mapWallDescriptors, minX, maxX, minZ, maxZ);
+
+	return glm::max(1.0f, ceilf(sqrtf((maxX - minX) * (maxZ - minZ) / mapWallDescriptors.size())));
+}
+
+// Creates the grid, bucketing every wall into all cells its bounds touch.
+MapWallGrid::MapWallGrid(const std::vector<MapWallDescriptor>& mapWallDescriptors, float cellSize)
+	: MapWallAccelerationStructure(mapWallDescriptors)
+{
+	this->cellSize = cellSize;
+	this->minX = 0.0f;
+	this->minZ = 0.0f;
+	this->xCellQuantity = 0;
+	this->zCellQuantity = 0;
+
+	if (mapWallDescriptors.size() == 0)
+	{
+		this->cellWallOffsets.push_back(0);
+		return;
+	}
+
+	// Find grid bounds
+	float minX, maxX, minZ, maxZ;
+	getWallBounds(mapWallDescriptors, minX, maxX, minZ, maxZ);
+
+	// Leave one empty cell around the walls, so border walls never fall outside the grid
+	this->minX = floorf(minX / cellSize) * cellSize - cellSize;
+	this->minZ = floorf(minZ / cellSize) * cellSize - cellSize;
+	this->xCellQuantity = (int)ceilf((maxX - this->minX) / cellSize) + 1;
+	this->zCellQuantity = (int)ceilf((maxZ - this->minZ) / cellSize) + 1;
+
+	unsigned int cellQuantity = this->xCellQuantity * this->zCellQuantity;
+
+	// First pass: count walls per cell
+	std::vector<unsigned int> cellWallQuantity(cellQuantity, 0);
+
+	for (unsigned int i = 0; i < mapWallDescriptors.size(); ++i)
+	{
+		const MapWallDescriptor& wall = mapWallDescriptors[i];
+		int xBegin = this->getXCell(wall.centerPosition.x - wall.xLength / 2.0f - borderTolerance);
+		int xEnd = this->getXCell(wall.centerPosition.x + wall.xLength / 2.0f + borderTolerance);
+		int zBegin = this->getZCell(wall.centerPosition.z - wall.zLength / 2.0f - borderTolerance);
+		int zEnd = this->getZCell(wall.centerPosition.z + wall.zLength / 2.0f + borderTolerance);
+
+		for (int z = zBegin; z <= zEnd; ++z)
+			for (int x = xBegin; x <= xEnd; ++x)
+				++cellWallQuantity[z * this->xCellQuantity + x];
+	}
+
+	this->cellWallOffsets.resize(cellQuantity + 1);
+	this->cellWallOffsets[0] = 0;
+
+	for (unsigned int i = 0; i < cellQuantity; ++i)
+		this->cellWallOffsets[i + 1] = this->cellWallOffsets[i] + cellWallQuantity[i];
+
+	// Second pass: fill the wall indexes. Walls are inserted in ascending order inside each cell.
+	this->cellWallIndexes.resize(this->cellWallOffsets[cellQuantity]);
+	std::vector<unsigned int> cellFillPosition(this->cellWallOffsets.begin(), this->cellWallOffsets.end() - 1);
+
+	for (unsigned int i = 0; i < mapWallDescriptors.size(); ++i)
+	{
+		const MapWallDescriptor& wall = mapWallDescriptors[i];
+		int xBegin = this->getXCell(wall.centerPosition.x - wall.xLength / 2.0f - borderTolerance);
+		int xEnd = this->getXCell(wall.centerPosition.x + wall.xLength / 2.0f + borderTolerance);
+		int zBegin = this->getZCell(wall.centerPosition.z - wall.zLength / 2.0f - borderTolerance);
+		int zEnd = this->getZCell(wall.centerPosition.z + wall.zLength / 2.0f + borderTolerance);
+
+		for (int z = zBegin; z <= zEnd; ++z)
+			for (int x = xBegin; x <= xEnd; ++x)
+				this->cellWallIndexes[cellFillPosition[z * this->xCellQuantity + x]++] = i;
+	}
+}
+
+MapWallGrid::~MapWallGrid()
+{
+}
+
+// Returns the indexes (in the map wall descriptors vector) of all walls touching the cell.
+const unsigned int* MapWallGrid::getCellWallIndexes(int xCell, int zCell, unsigned int* wallQuantity) const
+{
+	unsigned int cell = zCell * this->xCellQuantity + xCell;
+	*wallQuantity = this->cellWallOffsets[cell + 1] - this->cellWallOffsets[cell];
+
+	if (*wallQuantity == 0)
+		return 0;
+
+	return &this->cellWallIndexes[this->cellWallOffsets[cell]];
+}
+
+// Returns the x cell of the position. Positions outside the grid are clamped to the border cells.
+int MapWallGrid::getXCell(float xPosition) const
+{
+	int xCell = (int)floorf((xPosition - this->minX) / this->cellSize);
+	return glm::clamp(xCell, 0, this->xCellQuantity - 1);
+}
+
+// Returns the z cell of the position. Positions outside the grid are clamped to the border cells.
+int MapWallGrid::getZCell(float zPosition) const
+{
+	int zCell = (int)floorf((zPosition - this->minZ) / this->cellSize);
+	return glm::clamp(zCell, 0, this->zCellQuantity - 1);
+}
+
+int MapWallGrid::getXCellQuantity() const
+{
+	return this->xCellQuantity;
+}
+
+int MapWallGrid::getZCellQuantity() const
+{
+	return this->zCellQuantity;
+}
+
+float MapWallGrid::getCellSize() const
+{
+	return this->cellSize;
+}
+
+float MapWallGrid::getMinX() const
+{
+	return this->minX;
+}
+
+float MapWallGrid::getMinZ() const
+{
+	return this->minZ;
+}
+
+float MapWallGrid::getMaxX() const
+{
+	return this->minX + this->xCellQuantity * this->cellSize;
+}
+
+float MapWallGrid::getMaxZ() const
+{
+	return this->minZ + this->zCellQuantity * this->cellSize;
+}
+
+// Clip the ray against the slab [minValue, maxValue] of one axis.
+// Returns false if the ray never enters the slab.
+static bool clipRayAgainstSlab(float rayPosition, float rayDirection, float minValue, float maxValue,
+	float* tEnter, float* tExit)
+{
+	if (rayDirection == 0.0f)
+		return rayPosition >= minValue && rayPosition <= maxValue;
+
+	float t0 = (minValue - rayPosition) / rayDirection;
+	float t1 = (maxValue - rayPosition) / rayDirection;
+
+	if (t0 > t1)
+		std::swap(t0, t1);
+
+	*tEnter = glm::max(*tEnter, t0);
+	*tExit = glm::min(*tExit, t1);
+
+	return *tEnter <= *tExit;
+}
+
+// Test ray-wall collision walking only the grid cells crossed by the ray (2D DDA on the XZ plane).
+// The result is the same as testing every wall: ties are broken by the wall index, like the linear search.
+CollisionDescriptor MapWallGrid::getClosestWallRayIsColliding(const glm::vec4& rayPosition,
+	const glm::vec4& rayDirection) const
+{
+	CollisionDescriptor collisionDescriptor;
+	float nearestPositionDistance;
+	unsigned int nearestWallIndex;
+
+	collisionDescriptor.collide = false;
+
+	if (this->mapWallDescriptors.size() == 0)
+		return collisionDescriptor;
+
+	// Find the ray interval inside the grid
+	float tEnter = 0.0f;
+	float tExit = FLT_MAX;
+
+	if (!clipRayAgainstSlab(rayPosition.x, rayDirection.x, this->getMinX(), this->getMaxX(), &tEnter, &tExit))
+		return collisionDescriptor;
+	if (!clipRayAgainstSlab(rayPosition.z, rayDirection.z, this->getMinZ(), this->getMaxZ(), &tEnter, &tExit))
+		return collisionDescriptor;
+
+	float rayLength = glm::length(rayDirection);
+	int xCell = this->getXCell(rayPosition.x + tEnter * rayDirection.x);
+	int zCell = this->getZCell(rayPosition.z + tEnter * rayDirection.z);
+
+	// DDA setup: t of the next cell border and t needed to cross a whole cell, for each axis
+	int xStep = (rayDirection.x > 0.0f) ? 1 : ((rayDirection.x < 0.0f) ? -1 : 0);
+	int zStep = (rayDirection.z > 0.0f) ? 1 : ((rayDirection.z < 0.0f) ? -1 : 0);
+	float xNextBorder = this->getMinX() + (xCell + ((xStep > 0) ? 1 : 0)) * this->cellSize;
+	float zNextBorder = this->getMinZ() + (zCell + ((zStep > 0) ? 1 : 0)) * this->cellSize;
+	float tMaxX = (xStep != 0) ? (xNextBorder - rayPosition.x) / rayDirection.x : FLT_MAX;
+	float tMaxZ = (zStep != 0) ? (zNextBorder - rayPosition.z) / rayDirection.z : FLT_MAX;
+	float tDeltaX = (xStep != 0) ? this->cellSize / fabsf(rayDirection.x) : FLT_MAX;
+	float tDeltaZ = (zStep != 0) ? this->cellSize / fabsf(rayDirection.z) : FLT_MAX;
+
+	while (true)
+	{
+		unsigned int wallQuantity;
+		const unsigned int* wallIndexes = this->getCellWallIndexes(xCell, zCell, &wallQuantity);
+
+		for (unsigned int i = 0; i < wallQuantity; ++i)
+		{
+			unsigned int wallIndex = wallIndexes[i];
+			CollisionDescriptor currentCollisionDescriptor = Collision::isRayCollidingWithWall(rayPosition, rayDirection,
+				this->mapWallDescriptors[wallIndex]);
+
+			if (currentCollisionDescriptor.collide)
+			{
+				float currentPositionDistance = glm::length(rayPosition - currentCollisionDescriptor.worldPosition);
+
+				if (!collisionDescriptor.collide || currentPositionDistance < nearestPositionDistance ||
+					(currentPositionDistance == nearestPositionDistance && wallIndex < nearestWallIndex))
+				{
+					collisionDescriptor = currentCollisionDescriptor;
+					nearestPositionDistance = currentPositionDistance;
+					nearestWallIndex = wallIndex;
+				}
+			}
+		}
+
+		float tCellExit = glm::min(tMaxX, tMaxZ);
+
+		// A hit inside the current cell can't be beaten by walls in the next cells
+		if (collisionDescriptor.collide && nearestPositionDistance <= tCellExit * rayLength)
+			break;
+
+		if (tCellExit >= tExit)
+			break;
+
+		if (tMaxX < tMaxZ)
+		{
+			xCell += xStep;
+			tMaxX += tDeltaX;
+		}
+		else
+		{
+			zCell += zStep;
+			tMaxZ += tDeltaZ;
+		}
+
+		if (xCell < 0 || xCell >= this->xCellQuantity || zCell < 0 || zCell >= this->zCellQuantity)
+			break;
+	}
+
+	return collisionDescriptor;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "MapWallAccelerationStructure.h"
+#include <vector>
+
+namespace raw
+{
+	// Uniform grid over the XZ plane of the map. Each cell keeps the indexes of the walls that touch it,
+	// so a ray only needs to test the walls stored in the cells it crosses.
+	class MapWallGrid : public MapWallAccelerationStructure
+	{
+	public:
+		MapWallGrid(const std::vector<MapWallDescriptor>& mapWallDescriptors, float cellSize);
+		~MapWallGrid();
+		const unsigned int* getCellWallIndexes(int xCell, int zCell, unsigned int* wallQuantity) const;
+		int getXCell(float xPosition) const;
+		int getZCell(float zPosition) const;
+		int getXCellQuantity() const;
+		int getZCellQuantity() const;
+		float getCellSize() const;
+		float getMinX() const;
+		float getMinZ() const;
+		float getMaxX() const;
+		float getMaxZ() const;
+		static float calculateCellSize(const std::vector<MapWallDescriptor>& mapWallDescriptors);
+		virtual CollisionDescriptor getClosestWallRayIsColliding(const glm::vec4& rayPosition,
+			const glm::vec4& rayDirection) const;
+	private:
+		std::vector<unsigned int> cellWallOffsets;
+		std::vector<unsigned int> cellWallIndexes;
+		int xCellQuantity;
+		int zCellQuantity;
+		float cellSize;
+		float minX;
+		float minZ;
+	};
+}
@@ -12,12 +12,9 @@ MenuScene::MenuScene()
 	// Create sky
 	this->skybox = new Skybox();
 
-	// Create Map
+	// Create Map. Its model is generated in background threads and added in update() when ready.
 	this->map = new Map(".\\res\\map\\map.png");
-	Model* mapModel = this->map->generateMapModel();
-	this->models.push_back(mapModel);
-	Entity* mapEntity = new Entity(mapModel);
-	this->entities.push_back(mapEntity);
+	this->mapLoader = new MapLoader(this->map, MapMeshingMode::GREEDY, true, false);
 
 	// Create Shaders
 	this->phongShader = new Shader(ShaderType::PHONG);
@@ -29,6 +26,7 @@ MenuScene::MenuScene()
 	glm::vec4 lookAtCameraInitialViewVector = glm::vec4(1.0039f, -0.5f, 1.0f, 0.0f);
 	this->lookAtCamera = new PerspectiveCamera(lookAtCameraInitialPosition, lookAtCameraInitialUpVector,
 		lookAtCameraInitialViewVector);
+	this->frameUniformBuffer = new FrameUniformBuffer();
 
 	// Create Lights
 	glm::vec4 ambientLight = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
@@ -49,20 +47,26 @@ MenuScene::MenuScene()
 	DirectionalLight* directionalLight = new DirectionalLight(dlDirection, dAmbientLight, dDiffuseLight,
 		dSpecularLight);
 	this->lights.push_back(directionalLight);
+	this->lightClusterBuffer = new LightClusterBuffer();
 }
 
 MenuScene::~MenuScene()
 {
-	// Delete map
+	// Delete map. The loader must be destroyed first, it waits for the background thread to stop.
+	delete this->mapLoader;
 	delete this->map;
 
 	// Delete Shaders
 	delete this->phongShader;
 	delete this->skyboxShader;
 
+	// Delete frame uniforms
+	delete this->frameUniformBuffer;
+
 	// Destroy Lights
 	for (unsigned int i = 0; i < this->lights.size(); ++i)
 		delete this->lights[i];
+	delete this->lightClusterBuffer;
 
 	// Destroy Models
 	for (unsigned int i = 0; i < this->models.size(); ++i)
@@ -75,9 +79,15 @@ MenuScene::~MenuScene()
 
 void MenuScene::render() const
 {
+	// Upload the camera of this frame
+	this->frameUniformBuffer->update(*this->lookAtCamera);
+
 	// Render skybox
 	this->skybox->render(*skyboxShader, *lookAtCamera);
 
+	// Upload the lights that changed since the last frame and bin them in the light clusters of the camera
+	this->lightClusterBuffer->update(this->lights, *this->lookAtCamera);
+
 	// Render all entities
 	for (unsigned int i = 0; i < this->entities.size(); ++i)
 		this->entities[i]->render(*phongShader, *lookAtCamera, this->lights, false);
@@ -85,6 +95,18 @@ void MenuScene::render() const
 
 void MenuScene::update(float deltaTime)
 {
+	// Upload the map model once the loader is done
+	if (this->mapLoader && this->mapLoader->isFinished())
+	{
+		Model* mapModel = this->mapLoader->createMapModel();
+		this->models.push_back(mapModel);
+		Entity* mapEntity = new Entity(mapModel);
+		this->entities.push_back(mapEntity);
+
+		delete this->mapLoader;
+		this->mapLoader = 0;
+	}
+
 	// Update LookAt Camera
 	static const glm::vec4 lookPosition = glm::vec4(10.0f, 0.0f, 10.0f, 1.0f);
 	glm::vec4 newLookAtPosition = this->lookAtCamera->getPosition();
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "Map.h"
+#include "MapLoader.h"
+#include "LightClusterBuffer.h"
+#include "FrameUniformBuffer.h"
 
 namespace raw
 {
@@ -20,12 +23,15 @@ namespace raw
 		void update(float deltaTime);
 	private:
 		Map* map;
+		MapLoader* mapLoader;
 		Shader* phongShader;
 		Shader* skyboxShader;
 		Camera* lookAtCamera;
+		FrameUniformBuffer* frameUniformBuffer;
 		Skybox* skybox;
 
 		std::vector<Light*> lights;
+		LightClusterBuffer* lightClusterBuffer;
 		std::vector<Model*> models;
 		std::vector<Entity*> entities;
 	};
@@ -1,9 +1,44 @@
 #include "Mesh.h"
 #include "Texture.h"
 #include "Shader.h"
+#include "RenderStatistics.h"
+#include <glm\gtc\packing.hpp>
+#include <cstddef>
 
 using namespace raw;
 
+// Attribute locations of the per-instance data, after the Vertex attributes (0 to 3).
+static const GLuint instanceModelMatrixLocation = 4;
+static const GLuint instanceColorLocation = 8;
+
+// Maximum error of texture coordinates stored as half floats. Coordinates in [0, 1] and integer coordinates
+// (repeated textures) are always below it.
+static const float maximumHalfTextureCoordinateError = 1.0f / 4096.0f;
+
+// Encode a unit vector with octahedral encoding: the vector is projected on the octahedron |x| + |y| + |z| = 1,
+// whose lower half is folded over the upper half, and the x and y coordinates are stored as snorm16.
+// The decoding is done by decodeOctahedral() in the vertex shaders.
+static void encodeOctahedral(const glm::vec4& vector, GLshort* encoded)
+{
+	float length = fabsf(vector.x) + fabsf(vector.y) + fabsf(vector.z);
+
+	if (length == 0.0f)
+	{
+		encoded[0] = 0;
+		encoded[1] = 0;
+		return;
+	}
+
+	glm::vec2 octahedral = glm::vec2(vector.x, vector.y) / length;
+
+	if (vector.z < 0.0f)
+		octahedral = (1.0f - glm::abs(glm::vec2(octahedral.y, octahedral.x))) *
+			glm::vec2(octahedral.x >= 0.0f ? 1.0f : -1.0f, octahedral.y >= 0.0f ? 1.0f : -1.0f);
+
+	encoded[0] = (GLshort)glm::packSnorm1x16(octahedral.x);
+	encoded[1] = (GLshort)glm::packSnorm1x16(octahedral.y);
+}
+
 // Create a new mesh using:
 // vertices: an array containing all vertices that define the mesh.
 // indices: an array containing all indices thar define the mesh.
@@ -16,12 +51,31 @@ Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>&
 {
 	this->vertices = vertices;
 	this->indices = indices;
+	this->initialize(diffuseMap, specularMap, normalMap, specularShineness);
+}
+
+// Create a new mesh copying the vertices and the indices from arrays, such as the ones of a baked model.
+Mesh::Mesh(const Vertex* vertices, unsigned int vertexQuantity, const unsigned int* indices,
+	unsigned int indexQuantity, Texture* diffuseMap, Texture* specularMap, Texture* normalMap, float specularShineness)
+{
+	this->vertices.assign(vertices, vertices + vertexQuantity);
+	this->indices.assign(indices, indices + indexQuantity);
+	this->initialize(diffuseMap, specularMap, normalMap, specularShineness);
+}
+
+void Mesh::initialize(Texture* diffuseMap, Texture* specularMap, Texture* normalMap, float specularShineness)
+{
+	// The setters release the previous textures, so there must be none
+	this->diffuseMap = 0;
+	this->specularMap = 0;
+	this->normalMap = 0;
 	this->setDiffuseMap(diffuseMap);
 	this->setSpecularMap(specularMap);
 	this->setNormalMap(normalMap);
 	this->specularShineness = specularShineness;
 	this->renderMode = MeshRenderMode::TRIANGLES;
 	this->visible = true;
+	this->calculateBoundingBox();
 	this->createVAO();
 }
 
@@ -31,6 +85,16 @@ Mesh::~Mesh()
 	Texture::destroy(this->diffuseMap);
 	this->specularMap->decreaseReferences();
 	Texture::destroy(this->specularMap);
+	if (this->normalMap != 0)
+	{
+		this->normalMap->decreaseReferences();
+		Texture::destroy(this->normalMap);
+	}
+
+	// Release GPU buffers, meshes might be created and destroyed during the game (map chunks)
+	glDeleteVertexArrays(1, &this->VAO);
+	glDeleteBuffers(1, &this->VBO);
+	glDeleteBuffers(1, &this->EBO);
 }
 
 // Render the mesh using the shader received as parameter.
@@ -39,50 +103,120 @@ void Mesh::render(const Shader& shader, bool useNormalMap) const
 	if (!this->visible) return;
 
 	shader.useProgram();
+	this->bindMaterial(shader, useNormalMap);
+
+	glBindVertexArray(this->VAO);
+	this->draw(1);
+	glBindVertexArray(0);
+	RenderStatistics::addGLCalls(2);
+	RenderStatistics::addVertexArrayBinds(1);
+}
 
+// Render instanceQuantity instances of the mesh with a single draw call.
+// The MeshInstance data is read from instanceBuffer, starting at firstInstance. The instance attributes are only
+// enabled during this call, so the VAO can still be used by render().
+void Mesh::renderInstanced(const Shader& shader, bool useNormalMap, GLuint instanceBuffer, unsigned int firstInstance,
+	unsigned int instanceQuantity) const
+{
+	if (!this->visible || instanceQuantity == 0) return;
+
+	shader.useProgram();
+	this->bindMaterial(shader, useNormalMap);
+
+	glBindVertexArray(this->VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	RenderStatistics::addGLCalls(2);
+	RenderStatistics::addVertexArrayBinds(1);
+
+	// The model matrix takes four attribute locations, one per column
+	for (unsigned int i = 0; i < 4; ++i)
+	{
+		glEnableVertexAttribArray(instanceModelMatrixLocation + i);
+		glVertexAttribPointer(instanceModelMatrixLocation + i, 4, GL_FLOAT, GL_FALSE, sizeof(MeshInstance),
+			(void*)(firstInstance * sizeof(MeshInstance) + offsetof(MeshInstance, modelMatrix) + i * sizeof(glm::vec4)));
+		glVertexAttribDivisor(instanceModelMatrixLocation + i, 1);
+	}
+	glEnableVertexAttribArray(instanceColorLocation);
+	glVertexAttribPointer(instanceColorLocation, 4, GL_FLOAT, GL_FALSE, sizeof(MeshInstance),
+		(void*)(firstInstance * sizeof(MeshInstance) + offsetof(MeshInstance, color)));
+	glVertexAttribDivisor(instanceColorLocation, 1);
+	RenderStatistics::addGLCalls(15);
+
+	this->draw(instanceQuantity);
+
+	for (unsigned int i = 0; i < 4; ++i)
+		glDisableVertexAttribArray(instanceModelMatrixLocation + i);
+	glDisableVertexAttribArray(instanceColorLocation);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+	RenderStatistics::addGLCalls(7);
+}
+
+// Send the textures and the material properties used by the shader.
+void Mesh::bindMaterial(const Shader& shader, bool useNormalMap) const
+{
 	if (shader.getType() == ShaderType::PHONG || shader.getType() == ShaderType::GOURAD
-		|| shader.getType() == ShaderType::FLAT)
+		|| shader.getType() == ShaderType::FLAT || shader.getType() == ShaderType::DEFERRED)
 	{
 		this->getDiffuseMap()->bind(GL_TEXTURE0);
 		this->getSpecularMap()->bind(GL_TEXTURE1);
 
-		GLuint materialDiffuseMapLocation = glGetUniformLocation(shader.getProgram(), "material.diffuseMap");
-		GLuint materialSpecularMapLocation = glGetUniformLocation(shader.getProgram(), "material.specularMap");
-		GLuint materialShinenessLocation = glGetUniformLocation(shader.getProgram(), "material.shineness");
+		GLint materialDiffuseMapLocation = shader.getUniformLocation(ShaderUniform::MATERIAL_DIFFUSE_MAP);
+		GLint materialSpecularMapLocation = shader.getUniformLocation(ShaderUniform::MATERIAL_SPECULAR_MAP);
+		GLint materialShinenessLocation = shader.getUniformLocation(ShaderUniform::MATERIAL_SHINENESS);
 
 		glUniform1i(materialDiffuseMapLocation, 0);
 		glUniform1i(materialSpecularMapLocation, 1);
 		glUniform1f(materialShinenessLocation, this->specularShineness);
+		RenderStatistics::addGLCalls(3);
 
 		if (this->normalMap != 0 && useNormalMap)
 		{
 			this->getNormalMap()->bind(GL_TEXTURE2);
-			GLuint materialNormalMapLocation = glGetUniformLocation(shader.getProgram(), "material.normalMap");
-			GLuint materialUseNormalMapLocation = glGetUniformLocation(shader.getProgram(), "material.useNormalMap");
+			GLint materialNormalMapLocation = shader.getUniformLocation(ShaderUniform::MATERIAL_NORMAL_MAP);
+			GLint materialUseNormalMapLocation = shader.getUniformLocation(ShaderUniform::MATERIAL_USE_NORMAL_MAP);
 			glUniform1i(materialNormalMapLocation, 2);
 			glUniform1i(materialUseNormalMapLocation, true);
+			RenderStatistics::addGLCalls(2);
 		}
 		else
 		{
-			GLuint materialUseNormalMapLocation = glGetUniformLocation(shader.getProgram(), "material.useNormalMap");
+			GLint materialUseNormalMapLocation = shader.getUniformLocation(ShaderUniform::MATERIAL_USE_NORMAL_MAP);
 			glUniform1i(materialUseNormalMapLocation, false);
+			RenderStatistics::addGLCalls(1);
 		}
 	}
 	else if (shader.getType() == ShaderType::FIXED || shader.getType() == ShaderType::TEXTURE)
 	{
 		this->getDiffuseMap()->bind(GL_TEXTURE0);
-		GLuint fixedTextureLocation = glGetUniformLocation(shader.getProgram(), "fixedTexture");
+		GLint fixedTextureLocation = shader.getUniformLocation(ShaderUniform::FIXED_TEXTURE);
 		glUniform1i(fixedTextureLocation, 0);
+		RenderStatistics::addGLCalls(1);
 	}
+}
 
-	glBindVertexArray(this->VAO);
+// Issue the draw call of the mesh. The VAO must be bound.
+void Mesh::draw(unsigned int instanceQuantity) const
+{
+	GLenum primitive = (this->renderMode == MeshRenderMode::LINES) ? GL_LINES : GL_TRIANGLES;
 
-	if (this->renderMode == MeshRenderMode::TRIANGLES)
-		glDrawElements(GL_TRIANGLES, this->indices.size(), GL_UNSIGNED_INT, 0);
-	else if (this->renderMode == MeshRenderMode::LINES)
-		glDrawElements(GL_LINES, this->indices.size(), GL_UNSIGNED_INT, 0);
+	if (instanceQuantity == 1)
+		glDrawElements(primitive, this->indices.size(), this->indexType, 0);
+	else
+		glDrawElementsInstanced(primitive, this->indices.size(), this->indexType, 0, instanceQuantity);
+	RenderStatistics::addGLCalls(1);
+}
 
-	glBindVertexArray(0);
+// Check whether bindMaterial() would send the same textures and material properties for both meshes.
+bool Mesh::hasSameMaterial(const Mesh& mesh) const
+{
+	return this->diffuseMap == mesh.diffuseMap && this->specularMap == mesh.specularMap &&
+		this->normalMap == mesh.normalMap && this->specularShineness == mesh.specularShineness;
+}
+
+GLuint Mesh::getVAO() const
+{
+	return this->VAO;
 }
 
 Texture* Mesh::getDiffuseMap() const
@@ -210,25 +344,73 @@ void Mesh::createVAO()
 
 	glBindVertexArray(VAO);
 
+	// The GPU buffer stores the vertices in the compact format, followed by their texture coordinates.
+	// Texture coordinates are stored as half floats, unless some coordinate of the mesh can not be represented
+	// precisely enough by a half float, in which case they are stored as floats.
+	std::vector<CompactVertex> compactVertices(this->vertices.size());
+	std::vector<GLushort> halfTextureCoordinates(2 * this->vertices.size());
+	std::vector<glm::vec2> textureCoordinates(this->vertices.size());
+	bool useHalfTextureCoordinates = true;
+
+	for (unsigned int i = 0; i < this->vertices.size(); ++i)
+	{
+		const Vertex& vertex = this->vertices[i];
+		compactVertices[i].position = glm::vec3(vertex.position);
+		encodeOctahedral(vertex.normal, compactVertices[i].normal);
+		encodeOctahedral(vertex.tangent, compactVertices[i].tangent);
+		textureCoordinates[i] = vertex.textureCoordinates;
+
+		for (unsigned int j = 0; j < 2; ++j)
+		{
+			halfTextureCoordinates[2 * i + j] = glm::packHalf1x16(vertex.textureCoordinates[j]);
+			if (fabsf(glm::unpackHalf1x16(halfTextureCoordinates[2 * i + j]) - vertex.textureCoordinates[j]) >
+				maximumHalfTextureCoordinateError)
+				useHalfTextureCoordinates = false;
+		}
+	}
+
+	unsigned int compactVerticesSize = compactVertices.size() * sizeof(CompactVertex);
+	unsigned int textureCoordinatesSize = useHalfTextureCoordinates ?
+		halfTextureCoordinates.size() * sizeof(GLushort) : textureCoordinates.size() * sizeof(glm::vec2);
+	const void* textureCoordinatesData = useHalfTextureCoordinates ?
+		(const void*)halfTextureCoordinates.data() : (const void*)textureCoordinates.data();
+
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, this->vertices.size() * sizeof(Vertex), 0, GL_STATIC_DRAW);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, this->vertices.size() * sizeof(Vertex), &this->vertices[0]);
+	glBufferData(GL_ARRAY_BUFFER, compactVerticesSize + textureCoordinatesSize, 0, GL_STATIC_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, compactVerticesSize, compactVertices.data());
+	glBufferSubData(GL_ARRAY_BUFFER, compactVerticesSize, textureCoordinatesSize, textureCoordinatesData);
 
-	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 14 * sizeof(GLfloat), (void*)(0 * sizeof(GLfloat)));
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, position));
 	glEnableVertexAttribArray(0);
 
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 14 * sizeof(GLfloat), (void*)(4 * sizeof(GLfloat)));
+	glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, normal));
 	glEnableVertexAttribArray(1);
 
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 14 * sizeof(GLfloat), (void*)(8 * sizeof(GLfloat)));
+	if (useHalfTextureCoordinates)
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, 2 * sizeof(GLushort), (void*)(size_t)compactVerticesSize);
+	else
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)(size_t)compactVerticesSize);
 	glEnableVertexAttribArray(2);
 
-	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 14 * sizeof(GLfloat), (void*)(10 * sizeof(GLfloat)));
+	glVertexAttribPointer(3, 2, GL_SHORT, GL_TRUE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, tangent));
 	glEnableVertexAttribArray(3);
 
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->indices.size() * sizeof(unsigned int), 0, GL_STATIC_DRAW);
-	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, this->indices.size() * sizeof(unsigned int), &this->indices[0]);
+
+	// Use 16-bit indices whenever all vertices can be addressed by them, halving the index buffer.
+	if (this->vertices.size() <= 65536)
+	{
+		std::vector<unsigned short> shortIndices(this->indices.begin(), this->indices.end());
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(unsigned short), 0, GL_STATIC_DRAW);
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, shortIndices.size() * sizeof(unsigned short), shortIndices.data());
+		this->indexType = GL_UNSIGNED_SHORT;
+	}
+	else
+	{
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->indices.size() * sizeof(unsigned int), 0, GL_STATIC_DRAW);
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, this->indices.size() * sizeof(unsigned int), this->indices.data());
+		this->indexType = GL_UNSIGNED_INT;
+	}
 
 	glBindVertexArray(0);
 
@@ -236,6 +418,8 @@ void Mesh::createVAO()
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
 	this->VAO = VAO;
+	this->VBO = VBO;
+	this->EBO = EBO;
 }
 
 Texture* Mesh::defaultDiffuseMap = 0;
@@ -279,6 +463,43 @@ const std::vector<Vertex>& Mesh::getVertices() const
 	return this->vertices;
 }
 
+const std::vector<unsigned int>& Mesh::getIndices() const
+{
+	return this->indices;
+}
+
+// Get the minimum corner of the axis-aligned bounding box of the mesh, in model coordinates.
+const glm::vec3& Mesh::getBoundingBoxMinimum() const
+{
+	return this->boundingBoxMinimum;
+}
+
+// Get the maximum corner of the axis-aligned bounding box of the mesh, in model coordinates.
+const glm::vec3& Mesh::getBoundingBoxMaximum() const
+{
+	return this->boundingBoxMaximum;
+}
+
+// Calculate the axis-aligned bounding box of the vertices. Entities are culled with the box of their model, which
+// merges the boxes of its meshes.
+void Mesh::calculateBoundingBox()
+{
+	this->boundingBoxMinimum = glm::vec3(0.0f, 0.0f, 0.0f);
+	this->boundingBoxMaximum = glm::vec3(0.0f, 0.0f, 0.0f);
+
+	if (this->vertices.size() > 0)
+	{
+		this->boundingBoxMinimum = glm::vec3(this->vertices[0].position);
+		this->boundingBoxMaximum = glm::vec3(this->vertices[0].position);
+	}
+
+	for (const Vertex& v : this->vertices)
+	{
+		this->boundingBoxMinimum = glm::min(this->boundingBoxMinimum, glm::vec3(v.position));
+		this->boundingBoxMaximum = glm::max(this->boundingBoxMaximum, glm::vec3(v.position));
+	}
+}
+
 // Quad: A quad is a special type of Mesh which its vertices are defined as a simple square.
 // Useful to render 2D entities.
 Quad::Quad() : Mesh(Quad::quadVertices, Quad::quadIndices, 0, 0, 0, 128.0f)
@@ -16,6 +16,23 @@ namespace raw
 		glm::vec2 textureCoordinates;
 		glm::vec4 tangent;
 	};
+
+	// Vertex of the GPU buffers. Position w is always 1, so it is left to the default attribute value. The normal and
+	// the tangent are unit vectors, stored with octahedral encoding in two normalized shorts. The texture
+	// coordinates are stored after all vertices (see Mesh::createVAO()).
+	struct CompactVertex
+	{
+		glm::vec3 position;
+		GLshort normal[2];
+		GLshort tangent[2];
+	};
+
+	// Per-instance data of instanced rendering
+	struct MeshInstance
+	{
+		glm::mat4 modelMatrix;
+		glm::vec4 color;
+	};
 	#pragma pack(pop)
 
 	enum class MeshRenderMode
@@ -29,8 +46,16 @@ namespace raw
 	public:
 		Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
 			Texture* diffuseMap, Texture* specularMap, Texture* normalMap, float specularShineness);
+		Mesh(const Vertex* vertices, unsigned int vertexQuantity, const unsigned int* indices, unsigned int indexQuantity,
+			Texture* diffuseMap, Texture* specularMap, Texture* normalMap, float specularShineness);
 		~Mesh();
 		void render(const Shader& shader, bool useNormalMap) const;
+		void renderInstanced(const Shader& shader, bool useNormalMap, GLuint instanceBuffer, unsigned int firstInstance,
+			unsigned int instanceQuantity) const;
+		void bindMaterial(const Shader& shader, bool useNormalMap) const;
+		void draw(unsigned int instanceQuantity) const;
+		bool hasSameMaterial(const Mesh& mesh) const;
+		GLuint getVAO() const;
 		Texture* getDiffuseMap() const;
 		void setDiffuseMap(Texture* diffuseMap);
 		Texture* getSpecularMap() const;
@@ -44,12 +69,17 @@ namespace raw
 		bool isVisible() const;
 		void setVisible(bool visible);
 		const std::vector<Vertex>& getVertices() const;
+		const std::vector<unsigned int>& getIndices() const;
+		const glm::vec3& getBoundingBoxMinimum() const;
+		const glm::vec3& getBoundingBoxMaximum() const;
 
 		static Texture* getDefaultDiffuseMap();
 		static Texture* getDefaultSpecularMap();
 		static glm::vec4 getTangentVector(glm::vec2 diffUV1, glm::vec2 diffUV2, glm::vec4 edge1, glm::vec4 edge2);
 	private:
+		void initialize(Texture* diffuseMap, Texture* specularMap, Texture* normalMap, float specularShineness);
 		void createVAO();
+		void calculateBoundingBox();
 		std::vector<Vertex> vertices;
 		std::vector<unsigned int> indices;
 		Texture* diffuseMap;
@@ -59,6 +89,11 @@ namespace raw
 		MeshRenderMode renderMode;
 		bool visible;
 		GLuint VAO;
+		GLuint VBO;
+		GLuint EBO;
+		GLenum indexType;
+		glm::vec3 boundingBoxMinimum;
+		glm::vec3 boundingBoxMaximum;
 
 		static Texture* defaultDiffuseMap;
 		static Texture* defaultSpecularMap;
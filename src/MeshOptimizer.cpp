@@ -0,0 +1,270 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace raw;
+
+// Weights of the vertex score of the vertex cache optimization, as proposed by Tom Forsyth.
+static const float cacheDecayPower = 1.5f;
+static const float lastTriangleScore = 0.75f;
+static const float valenceBoostScale = 2.0f;
+static const float valenceBoostPower = 0.5f;
+
+static const unsigned int invalidIndex = 0xFFFFFFFF;
+
+// Hash of the bytes of a vertex (FNV-1a).
+static unsigned int hashVertex(const Vertex& vertex)
+{
+	const unsigned char* bytes = (const unsigned char*)&vertex;
+	unsigned int hash = 2166136261u;
+
+	for (unsigned int i = 0; i < sizeof(Vertex); ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+// Run the three optimization steps on the mesh.
+void MeshOptimizer::optimize(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+	MeshOptimizer::weldVertices(vertices, indices);
+	MeshOptimizer::optimizeVertexCache(indices, vertices.size());
+	MeshOptimizer::optimizeVertexFetch(vertices, indices);
+}
+
+// Merge the vertices whose attributes are bitwise identical, remapping the indices to the merged vertices.
+// The vertices are kept in the order of their first occurrence.
+void MeshOptimizer::weldVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+	// Open addressing hash table with at least twice as many buckets as vertices
+	unsigned int bucketQuantity = 1;
+	while (bucketQuantity < vertices.size() * 2)
+		bucketQuantity *= 2;
+
+	std::vector<unsigned int> buckets(bucketQuantity, invalidIndex);
+	std::vector<unsigned int> remap(vertices.size());
+	unsigned int weldedQuantity = 0;
+
+	for (unsigned int i = 0; i < vertices.size(); ++i)
+	{
+		unsigned int bucket = hashVertex(vertices[i]) & (bucketQuantity - 1);
+
+		while (buckets[bucket] != invalidIndex &&
+			memcmp(&vertices[buckets[bucket]], &vertices[i], sizeof(Vertex)) != 0)
+			bucket = (bucket + 1) & (bucketQuantity - 1);
+
+		if (buckets[bucket] == invalidIndex)
+		{
+			// The welded vertices are compacted in place: weldedQuantity <= i, so no vertex still to be read is
+			// overwritten. The bucket refers to the new position of the vertex.
+			vertices[weldedQuantity] = vertices[i];
+			buckets[bucket] = weldedQuantity;
+			remap[i] = weldedQuantity++;
+		}
+		else
+			remap[i] = buckets[bucket];
+	}
+
+	vertices.resize(weldedQuantity);
+	for (unsigned int i = 0; i < indices.size(); ++i)
+		indices[i] = remap[indices[i]];
+}
+
+// Reorder the triangles so vertices are reused while they are still in the post-transform vertex cache.
+// Each step adds the triangle with the highest score, which is the sum of the scores of its vertices. Vertices
+// recently used score higher, and so do vertices with few triangles left, so isolated vertices are finished first.
+void MeshOptimizer::optimizeVertexCache(std::vector<unsigned int>& indices, unsigned int vertexQuantity)
+{
+	unsigned int triangleQuantity = indices.size() / 3;
+
+	if (triangleQuantity == 0)
+		return;
+
+	// Triangles of each vertex, still to be added, stored in triangleLists[triangleOffsets[v]...]
+	std::vector<unsigned int> remainingTriangles(vertexQuantity, 0);
+	std::vector<unsigned int> triangleOffsets(vertexQuantity, 0);
+	std::vector<unsigned int> triangleLists(indices.size());
+
+	for (unsigned int i = 0; i < indices.size(); ++i)
+		++remainingTriangles[indices[i]];
+
+	for (unsigned int i = 1; i < vertexQuantity; ++i)
+		triangleOffsets[i] = triangleOffsets[i - 1] + remainingTriangles[i - 1];
+
+	std::fill(remainingTriangles.begin(), remainingTriangles.end(), 0);
+	for (unsigned int i = 0; i < indices.size(); ++i)
+	{
+		unsigned int vertex = indices[i];
+		triangleLists[triangleOffsets[vertex] + remainingTriangles[vertex]++] = i / 3;
+	}
+
+	std::vector<int> cachePositions(vertexQuantity, -1);
+	std::vector<float> vertexScores(vertexQuantity);
+	std::vector<float> triangleScores(triangleQuantity, 0.0f);
+	std::vector<bool> triangleAdded(triangleQuantity, false);
+
+	for (unsigned int i = 0; i < vertexQuantity; ++i)
+		vertexScores[i] = MeshOptimizer::getVertexScore(-1, remainingTriangles[i]);
+
+	for (unsigned int i = 0; i < triangleQuantity; ++i)
+		triangleScores[i] = vertexScores[indices[3 * i]] + vertexScores[indices[3 * i + 1]] +
+			vertexScores[indices[3 * i + 2]];
+
+	unsigned int bestTriangle = 0;
+	for (unsigned int i = 1; i < triangleQuantity; ++i)
+		if (triangleScores[i] > triangleScores[bestTriangle])
+			bestTriangle = i;
+
+	std::vector<unsigned int> optimizedIndices(indices.size());
+	std::vector<unsigned int> cache;
+	std::vector<unsigned int> newCache;
+	unsigned int nextUnaddedTriangle = 0;
+
+	for (unsigned int addedQuantity = 0; addedQuantity < triangleQuantity; ++addedQuantity)
+	{
+		// No triangle touches the cache anymore, continue with the next triangle in the original order
+		if (bestTriangle == invalidIndex)
+		{
+			while (triangleAdded[nextUnaddedTriangle])
+				++nextUnaddedTriangle;
+			bestTriangle = nextUnaddedTriangle;
+		}
+
+		triangleAdded[bestTriangle] = true;
+
+		// Put the vertices of the triangle at the front of the cache, followed by the vertices that were already there
+		newCache.clear();
+		for (unsigned int i = 0; i < 3; ++i)
+		{
+			unsigned int vertex = indices[3 * bestTriangle + i];
+			optimizedIndices[3 * addedQuantity + i] = vertex;
+			newCache.push_back(vertex);
+
+			// Remove the triangle from the list of the vertex
+			unsigned int* triangles = &triangleLists[triangleOffsets[vertex]];
+			for (unsigned int j = 0; j < remainingTriangles[vertex]; ++j)
+				if (triangles[j] == bestTriangle)
+				{
+					triangles[j] = triangles[remainingTriangles[vertex] - 1];
+					--remainingTriangles[vertex];
+					break;
+				}
+		}
+
+		for (unsigned int i = 0; i < cache.size(); ++i)
+			if (cache[i] != newCache[0] && cache[i] != newCache[1] && cache[i] != newCache[2])
+				newCache.push_back(cache[i]);
+
+		// Update the scores of the vertices in the cache, including the ones that were just pushed out of it
+		for (unsigned int i = 0; i < newCache.size(); ++i)
+		{
+			unsigned int vertex = newCache[i];
+			cachePositions[vertex] = (i < meshOptimizerCacheSize) ? i : -1;
+			vertexScores[vertex] = MeshOptimizer::getVertexScore(cachePositions[vertex], remainingTriangles[vertex]);
+		}
+
+		// Update the scores of the triangles of those vertices, looking for the best one
+		float bestScore = -1.0f;
+		bestTriangle = invalidIndex;
+		for (unsigned int i = 0; i < newCache.size(); ++i)
+		{
+			unsigned int vertex = newCache[i];
+			const unsigned int* triangles = &triangleLists[triangleOffsets[vertex]];
+
+			for (unsigned int j = 0; j < remainingTriangles[vertex]; ++j)
+			{
+				unsigned int triangle = triangles[j];
+				triangleScores[triangle] = vertexScores[indices[3 * triangle]] + vertexScores[indices[3 * triangle + 1]] +
+					vertexScores[indices[3 * triangle + 2]];
+
+				if (triangleScores[triangle] > bestScore)
+				{
+					bestScore = triangleScores[triangle];
+					bestTriangle = triangle;
+				}
+			}
+		}
+
+		if (newCache.size() > meshOptimizerCacheSize)
+			newCache.resize(meshOptimizerCacheSize);
+		cache.swap(newCache);
+	}
+
+	indices.swap(optimizedIndices);
+}
+
+// Reorder the vertices in the order they are first referenced by the indices. Vertices that are not referenced are
+// removed.
+void MeshOptimizer::optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+	std::vector<unsigned int> remap(vertices.size(), invalidIndex);
+	std::vector<Vertex> optimizedVertices;
+	optimizedVertices.reserve(vertices.size());
+
+	for (unsigned int i = 0; i < indices.size(); ++i)
+	{
+		unsigned int vertex = indices[i];
+
+		if (remap[vertex] == invalidIndex)
+		{
+			remap[vertex] = optimizedVertices.size();
+			optimizedVertices.push_back(vertices[vertex]);
+		}
+
+		indices[i] = remap[vertex];
+	}
+
+	vertices.swap(optimizedVertices);
+}
+
+// Simulate a FIFO post-transform cache of meshOptimizerCacheSize entries and return the average quantity of cache
+// misses (vertex shader invocations) per triangle.
+float MeshOptimizer::calculateACMR(const std::vector<unsigned int>& indices, unsigned int vertexQuantity)
+{
+	if (indices.size() < 3)
+		return 0.0f;
+
+	// Time of the cache miss that loaded each vertex. A vertex is still cached if fewer than meshOptimizerCacheSize
+	// misses happened since then.
+	std::vector<unsigned int> cacheTimes(vertexQuantity, 0);
+	unsigned int time = meshOptimizerCacheSize + 1;
+	unsigned int misses = 0;
+
+	for (unsigned int i = 0; i < indices.size(); ++i)
+	{
+		unsigned int vertex = indices[i];
+
+		if (time - cacheTimes[vertex] > meshOptimizerCacheSize)
+		{
+			cacheTimes[vertex] = time++;
+			++misses;
+		}
+	}
+
+	return (float)misses / (float)(indices.size() / 3);
+}
+
+// Score of a vertex for the vertex cache optimization. cachePosition is -1 if the vertex is not in the cache.
+float MeshOptimizer::getVertexScore(int cachePosition, unsigned int remainingTriangles)
+{
+	// Vertices without triangles left are never used again
+	if (remainingTriangles == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+
+	// The vertices of the last triangle get a fixed score, so the next triangle does not depend on the order of the
+	// vertices of the last one
+	if (cachePosition >= 0 && cachePosition < 3)
+		score = lastTriangleScore;
+	else if (cachePosition >= 3)
+		score = powf(1.0f - (float)(cachePosition - 3) / (float)(meshOptimizerCacheSize - 3), cacheDecayPower);
+
+	score += valenceBoostScale * powf((float)remainingTriangles, -valenceBoostPower);
+
+	return score;
+}
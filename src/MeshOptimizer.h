@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Mesh.h"
+#include <vector>
+
+namespace raw
+{
+	// Size of the simulated post-transform vertex cache, used by the vertex cache optimization and by the ACMR.
+	const unsigned int meshOptimizerCacheSize = 32;
+
+	// Import stage of the models loaded by Assimp. Meshes are optimized in place, in three steps:
+	// - Identical vertices are welded, so each vertex is shaded once for all triangles that share it.
+	// - Triangles are reordered for the post-transform vertex cache (Tom Forsyth's linear-speed algorithm).
+	// - Vertices are reordered in the order the triangles first use them, so vertex fetches are sequential.
+	// The quality of the index order is measured by the ACMR (average cache miss ratio), the quantity of vertex
+	// shader invocations per triangle on a FIFO cache of meshOptimizerCacheSize entries. It ranges from 3 (no reuse)
+	// to about 0.5 for regular grids.
+	class MeshOptimizer
+	{
+	public:
+		static void optimize(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+		static void weldVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+		static void optimizeVertexCache(std::vector<unsigned int>& indices, unsigned int vertexQuantity);
+		static void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+		static float calculateACMR(const std::vector<unsigned int>& indices, unsigned int vertexQuantity);
+	private:
+		static float getVertexScore(int cachePosition, unsigned int remainingTriangles);
+	};
+}
@@ -1,19 +1,143 @@
 #include "Model.h"
+#include "MeshOptimizer.h"
+#include "ModelCache.h"
+#include "ResourcePack.h"
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
 #include <iostream>
+#include <algorithm>
 #include <cstring>
 
 using namespace raw;
 
+// Assimp stream reading a model file (or a file referenced by it, such as a material library) from a resource.
+class ResourceIOStream : public Assimp::IOStream
+{
+public:
+	ResourceIOStream(const char* path) : resource(path)
+	{
+		this->position = 0;
+	}
+
+	bool isLoaded() const
+	{
+		return this->resource.isLoaded();
+	}
+
+	size_t Read(void* buffer, size_t size, size_t count)
+	{
+		if (size == 0)
+			return 0;
+
+		size_t readCount = (this->resource.getSize() - this->position) / size;
+		if (readCount > count)
+			readCount = count;
+
+		memcpy(buffer, this->resource.getData() + this->position, readCount * size);
+		this->position += readCount * size;
+		return readCount;
+	}
+
+	size_t Write(const void*, size_t, size_t)
+	{
+		return 0;
+	}
+
+	aiReturn Seek(size_t offset, aiOrigin origin)
+	{
+		size_t newPosition;
+
+		if (origin == aiOrigin_SET)
+			newPosition = offset;
+		else if (origin == aiOrigin_CUR)
+			newPosition = this->position + offset;
+		else
+			newPosition = this->resource.getSize() + offset;
+
+		if (newPosition > this->resource.getSize())
+			return aiReturn_FAILURE;
+
+		this->position = newPosition;
+		return aiReturn_SUCCESS;
+	}
+
+	size_t Tell() const
+	{
+		return this->position;
+	}
+
+	size_t FileSize() const
+	{
+		return this->resource.getSize();
+	}
+
+	void Flush()
+	{
+	}
+private:
+	Resource resource;
+	size_t position;
+};
+
+// Assimp file system reading the model files from the resource pack, or from the disk when the pack does not
+// contain them. The paths of the files opened are kept, so the baked model depends on them.
+class ResourceIOSystem : public Assimp::IOSystem
+{
+public:
+	const std::vector<std::string>& getOpenedPaths() const
+	{
+		return this->openedPaths;
+	}
+
+	bool Exists(const char* path) const
+	{
+		return Resource::exists(path);
+	}
+
+	char getOsSeparator() const
+	{
+		return '\\';
+	}
+
+	Assimp::IOStream* Open(const char* path, const char* mode)
+	{
+		// Model files are only read
+		if (strchr(mode, 'w') != 0 || strchr(mode, 'a') != 0)
+			return 0;
+
+		ResourceIOStream* stream = new ResourceIOStream(path);
+		if (!stream->isLoaded())
+		{
+			delete stream;
+			return 0;
+		}
+
+		if (std::find(this->openedPaths.begin(), this->openedPaths.end(), path) == this->openedPaths.end())
+			this->openedPaths.push_back(path);
+
+		return stream;
+	}
+
+	void Close(Assimp::IOStream* stream)
+	{
+		delete stream;
+	}
+private:
+	std::vector<std::string> openedPaths;
+};
+
 // Creates a model using a vector of meshes.
 Model::Model(const std::vector<Mesh*>& meshes)
 {
 	this->meshes = meshes;
+	this->calculateBoundingBox();
 }
 
 // Creates a model receiving a path, which will be loaded with Assimp.
 Model::Model(const char* path)
 {
 	this->loadModel(path);
+	this->calculateBoundingBox();
 }
 
 Model::~Model()
@@ -29,7 +153,16 @@ void Model::render(const Shader& shader, bool useNormalMap) const
 		m->render(shader, useNormalMap);
 }
 
-std::vector<Mesh*> Model::getMeshes() const
+// Render instanceQuantity instances of the model, reading their MeshInstance data from instanceBuffer, starting at
+// firstInstance.
+void Model::renderInstanced(const Shader& shader, bool useNormalMap, GLuint instanceBuffer, unsigned int firstInstance,
+	unsigned int instanceQuantity) const
+{
+	for (Mesh* m : this->meshes)
+		m->renderInstanced(shader, useNormalMap, instanceBuffer, firstInstance, instanceQuantity);
+}
+
+const std::vector<Mesh*>& Model::getMeshes() const
 {
 	return this->meshes;
 }
@@ -37,6 +170,40 @@ std::vector<Mesh*> Model::getMeshes() const
 void Model::setMeshes(const std::vector<Mesh*>& meshes)
 {
 	this->meshes = meshes;
+	this->calculateBoundingBox();
+}
+
+// Get the minimum corner of the axis-aligned box that bounds all meshes of the model, in model coordinates.
+const glm::vec3& Model::getBoundingBoxMinimum() const
+{
+	return this->boundingBoxMinimum;
+}
+
+// Get the maximum corner of the axis-aligned box that bounds all meshes of the model, in model coordinates.
+const glm::vec3& Model::getBoundingBoxMaximum() const
+{
+	return this->boundingBoxMaximum;
+}
+
+// Merge the bounding boxes of all meshes into the bounding box of the model.
+void Model::calculateBoundingBox()
+{
+	this->boundingBoxMinimum = glm::vec3(0.0f, 0.0f, 0.0f);
+	this->boundingBoxMaximum = glm::vec3(0.0f, 0.0f, 0.0f);
+
+	for (unsigned int i = 0; i < this->meshes.size(); ++i)
+	{
+		if (i == 0)
+		{
+			this->boundingBoxMinimum = this->meshes[i]->getBoundingBoxMinimum();
+			this->boundingBoxMaximum = this->meshes[i]->getBoundingBoxMaximum();
+		}
+		else
+		{
+			this->boundingBoxMinimum = glm::min(this->boundingBoxMinimum, this->meshes[i]->getBoundingBoxMinimum());
+			this->boundingBoxMaximum = glm::max(this->boundingBoxMaximum, this->meshes[i]->getBoundingBoxMaximum());
+		}
+	}
 }
 
 void Model::setDiffuseMapOfAllMeshes(Texture* diffuseMap)
@@ -64,9 +231,15 @@ void Model::setSpecularShinenessOfAllMeshes(float specularShineness)
 }
 
 // Load the model using Assimp. An array of meshes will be created for the model.
+// The meshes are baked after they are loaded, and later runs load the baked model instead of parsing the model file.
 void Model::loadModel(const char* path)
 {
+	if (ModelCache::load(path, this->meshes))
+		return;
+
 	Assimp::Importer importer;
+	ResourceIOSystem* ioSystem = new ResourceIOSystem();
+	importer.SetIOHandler(ioSystem);	// owned by the importer
 	const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | /*aiProcess_FlipUVs |*/
 		aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace);
 
@@ -80,6 +253,42 @@ void Model::loadModel(const char* path)
 	char directory[DIRECTORY_MAX_SIZE];
 	this->getPathDirectory(path, directory, DIRECTORY_MAX_SIZE);
 	this->processNode(scene->mRootNode, scene, directory);
+
+	ModelCache::save(path, this->meshes, ioSystem->getOpenedPaths());
+}
+
+// Import the model file and print, for each of its meshes, the vertex quantity and the ACMR before and after the
+// mesh optimization. No mesh is created, so no OpenGL context is needed. Returns false if the model could not be read.
+bool Model::reportOptimization(const char* path)
+{
+	Assimp::Importer importer;
+	importer.SetIOHandler(new ResourceIOSystem());	// owned by the importer
+	const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals |
+		aiProcess_CalcTangentSpace);
+
+	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+	{
+		std::cout << "Error loading model with path " << path << ":";
+		std::cout << "Error: " << importer.GetErrorString() << std::endl;
+		return false;
+	}
+
+	for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+	{
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+
+		Model::fillGeometry(scene->mMeshes[i], vertices, indices);
+		unsigned int importedVertexQuantity = vertices.size();
+		float importedACMR = MeshOptimizer::calculateACMR(indices, vertices.size());
+		MeshOptimizer::optimize(vertices, indices);
+
+		std::cout << "Mesh " << scene->mMeshes[i]->mName.C_Str() << ": " << importedVertexQuantity << " -> " <<
+			vertices.size() << " vertices, ACMR " << importedACMR << " -> " <<
+			MeshOptimizer::calculateACMR(indices, vertices.size()) << std::endl;
+	}
+
+	return true;
 }
 
 // Receives a path and stores the directory of the path into the "buffer" received as parameter.
@@ -122,6 +331,25 @@ Mesh* Model::processMesh(aiMesh* mesh, const aiScene* scene, char* directory)
 	Texture* specularMap = 0;
 	Texture* normalMap = 0;
 
+	// Weld duplicated vertices and reorder the mesh for the vertex caches
+	Model::fillGeometry(mesh, vertices, indices);
+	MeshOptimizer::optimize(vertices, indices);
+
+	// Fill Material
+	if (mesh->mMaterialIndex >= 0)
+	{
+		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+		diffuseMap = this->loadMaterialTexture(material, aiTextureType_DIFFUSE, directory);
+		specularMap = this->loadMaterialTexture(material, aiTextureType_SPECULAR, directory);
+		normalMap = this->loadMaterialTexture(material, aiTextureType_HEIGHT, directory);
+	}
+
+	return new Mesh(vertices, indices, diffuseMap, specularMap, normalMap, 128.0f);
+}
+
+// Fill the vertices and the indices of the aiMesh, as imported by Assimp.
+void Model::fillGeometry(aiMesh* mesh, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
 	// Fill Vertices
 	for (unsigned int i = 0; i < mesh->mNumVertices; ++i)
 	{
@@ -144,7 +372,9 @@ Mesh* Model::processMesh(aiMesh* mesh, const aiScene* scene, char* directory)
 			vertex.tangent.z = mesh->mTangents[i].z;
 			vertex.tangent.w = 0.0f;
 		}
-		
+		else
+			vertex.tangent = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+
 		if (mesh->mTextureCoords[0])
 		{
 			vertex.textureCoordinates.x = mesh->mTextureCoords[0][i].x;
@@ -160,17 +390,6 @@ Mesh* Model::processMesh(aiMesh* mesh, const aiScene* scene, char* directory)
 	for (unsigned int i = 0; i < mesh->mNumFaces; ++i)
 		for (unsigned int j = 0; j < mesh->mFaces[i].mNumIndices; ++j)
 			indices.push_back(mesh->mFaces[i].mIndices[j]);
-
-	// Fill Material
-	if (mesh->mMaterialIndex >= 0)
-	{
-		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-		diffuseMap = this->loadMaterialTexture(material, aiTextureType_DIFFUSE, directory);
-		specularMap = this->loadMaterialTexture(material, aiTextureType_SPECULAR, directory);
-		normalMap = this->loadMaterialTexture(material, aiTextureType_HEIGHT, directory);
-	}
-
-	return new Mesh(vertices, indices, diffuseMap, specularMap, normalMap, 128.0f);
 }
 
 Texture* Model::loadMaterialTexture(aiMaterial* material, aiTextureType type, char* directory)
@@ -187,7 +406,8 @@ Texture* Model::loadMaterialTexture(aiMaterial* material, aiTextureType type, ch
 	strcat(fullPath, "\\");
 	strcat(fullPath, relativePath.C_Str());
 
-	// Create and Return Texture
-	Texture* texture = Texture::load(fullPath);
+	// Create and Return Texture. Height maps are used as the normal maps of the meshes
+	Texture* texture = Texture::load(fullPath, (type == aiTextureType_HEIGHT) ? TextureType::NORMAL_MAP :
+		TextureType::COLOR);
 	return texture;
 }
\ No newline at end of file
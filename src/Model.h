@@ -18,18 +18,27 @@ namespace raw
 		Model(const char* path);
 		~Model();
 		void render(const Shader& shader, bool useNormalMap) const;
-		std::vector<Mesh*> getMeshes() const;
+		void renderInstanced(const Shader& shader, bool useNormalMap, GLuint instanceBuffer, unsigned int firstInstance,
+			unsigned int instanceQuantity) const;
+		const std::vector<Mesh*>& getMeshes() const;
 		void setMeshes(const std::vector<Mesh*>& meshes);
 		void setDiffuseMapOfAllMeshes(Texture* diffuseMap);
 		void setSpecularMapOfAllMeshes(Texture* specularMap);
 		void setNormalMapOfAllMeshes(Texture* normalMap);
 		void setSpecularShinenessOfAllMeshes(float specularShineness);
+		const glm::vec3& getBoundingBoxMinimum() const;
+		const glm::vec3& getBoundingBoxMaximum() const;
+		static bool reportOptimization(const char* path);
 	private:
 		void loadModel(const char* path);
+		void calculateBoundingBox();
 		int getPathDirectory(const char* path, char* buffer, unsigned int bufferSize) const;
 		void processNode(aiNode* node, const aiScene* scene, char* directory);
 		Mesh* processMesh(aiMesh* mesh, const aiScene* scene, char* directory);
+		static void fillGeometry(aiMesh* mesh, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
 		Texture* loadMaterialTexture(aiMaterial* material, aiTextureType type, char* directory);
 		std::vector<Mesh*> meshes;
+		glm::vec3 boundingBoxMinimum;
+		glm::vec3 boundingBoxMaximum;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,233 @@
+#include "ModelCache.h"
+#include "Texture.h"
+#include "ResourcePack.h"
+#include <fstream>
+#include <iostream>
+#include <cstring>
+
+using namespace raw;
+
+// Version of the baked model format. Must be increased whenever the format, the Vertex struct or the mesh
+// optimization done by Model::processMesh() changes, so old baked models are baked again.
+static const unsigned int bakedModelVersion = 2;
+static const char bakedModelMagic[4] = { 'R', 'A', 'W', 'M' };
+static const char bakedModelExtension[] = ".baked";
+
+// Strings are padded to this alignment, so the vertices and the indices that follow them stay aligned.
+static const unsigned int bakedAlignment = 4;
+
+#pragma pack(push, 1)
+// Followed by the dependencies and the meshes
+struct BakedModelHeader
+{
+	char magic[4];
+	unsigned int version;
+	unsigned int vertexSize;
+	unsigned int meshQuantity;
+	unsigned int dependencyQuantity;
+};
+
+// File read while loading the model (the model file, its material library...). Followed by its path
+struct BakedDependencyHeader
+{
+	long long modificationTime;
+	unsigned int pathSize;
+};
+
+// Followed by the paths of the textures, the vertices and the indices of the mesh
+struct BakedMeshHeader
+{
+	unsigned int vertexQuantity;
+	unsigned int indexQuantity;
+	float specularShineness;
+	unsigned int diffuseMapPathSize;
+	unsigned int specularMapPathSize;
+	unsigned int normalMapPathSize;
+};
+#pragma pack(pop)
+
+// Computed in 64 bits, so the size read from a corrupted baked model can't wrap around to a small value.
+static unsigned long long getPaddedSize(unsigned long long size)
+{
+	return (size + bakedAlignment - 1) / bakedAlignment * bakedAlignment;
+}
+
+// Write a string without its terminator, padded to bakedAlignment.
+static void writeBakedString(std::ofstream& bakedStream, const std::string& string)
+{
+	static const char padding[bakedAlignment] = { 0 };
+
+	bakedStream.write(string.c_str(), string.size());
+	bakedStream.write(padding, getPaddedSize(string.size()) - string.size());
+}
+
+// Read a string written by writeBakedString. Returns false if it goes past the end of the baked model.
+static bool readBakedString(const unsigned char*& position, const unsigned char* end, unsigned int size,
+	std::string& string)
+{
+	unsigned long long remainingSize = end - position;
+
+	if (size > remainingSize || getPaddedSize(size) > remainingSize)
+		return false;
+
+	string.assign((const char*)position, size);
+	position += getPaddedSize(size);
+	return true;
+}
+
+static Texture* loadBakedTexture(const std::string& texturePath, TextureType type)
+{
+	return texturePath.empty() ? 0 : Texture::load(texturePath.c_str(), type);
+}
+
+// Load the baked model of the model file, from the resource pack or from the disk, creating its meshes straight from
+// the baked vertices and indices.
+// Returns false if there is no valid baked model, in which case the model must be loaded from the model file.
+bool ModelCache::load(const char* modelPath, std::vector<Mesh*>& meshes)
+{
+	Resource bakedResource(ModelCache::getBakedPath(modelPath).c_str());
+
+	if (!bakedResource.isLoaded() || bakedResource.getSize() < sizeof(BakedModelHeader))
+		return false;
+
+	const unsigned char* data = bakedResource.getData();
+	const unsigned char* end = data + bakedResource.getSize();
+	const BakedModelHeader* modelHeader = (const BakedModelHeader*)data;
+	const unsigned char* position = data + sizeof(BakedModelHeader);
+
+	if (memcmp(modelHeader->magic, bakedModelMagic, sizeof(bakedModelMagic)) != 0 ||
+		modelHeader->version != bakedModelVersion || modelHeader->vertexSize != sizeof(Vertex))
+		return false;
+
+	// A dependency modified after the model was baked invalidates it. Dependencies are not on the disk when only the
+	// resource pack is shipped
+	for (unsigned int i = 0; i < modelHeader->dependencyQuantity; ++i)
+	{
+		if ((unsigned int)(end - position) < sizeof(BakedDependencyHeader))
+			return false;
+
+		const BakedDependencyHeader* dependencyHeader = (const BakedDependencyHeader*)position;
+		position += sizeof(BakedDependencyHeader);
+
+		std::string dependencyPath;
+		if (!readBakedString(position, end, dependencyHeader->pathSize, dependencyPath))
+			return false;
+
+		long long modificationTime = Resource::getModificationTime(dependencyPath.c_str());
+		if (modificationTime != 0 && modificationTime != dependencyHeader->modificationTime)
+			return false;
+	}
+
+	// Validate all meshes before creating any of them
+	const unsigned char* meshesPosition = position;
+	for (unsigned int i = 0; i < modelHeader->meshQuantity; ++i)
+	{
+		if ((unsigned int)(end - position) < sizeof(BakedMeshHeader))
+			return false;
+
+		const BakedMeshHeader* meshHeader = (const BakedMeshHeader*)position;
+		position += sizeof(BakedMeshHeader);
+
+		unsigned long long meshDataSize = getPaddedSize(meshHeader->diffuseMapPathSize) +
+			getPaddedSize(meshHeader->specularMapPathSize) + getPaddedSize(meshHeader->normalMapPathSize) +
+			(unsigned long long)meshHeader->vertexQuantity * sizeof(Vertex) +
+			(unsigned long long)meshHeader->indexQuantity * sizeof(unsigned int);
+		if ((unsigned long long)(end - position) < meshDataSize)
+			return false;
+
+		position += meshDataSize;
+	}
+
+	position = meshesPosition;
+	for (unsigned int i = 0; i < modelHeader->meshQuantity; ++i)
+	{
+		const BakedMeshHeader* meshHeader = (const BakedMeshHeader*)position;
+		position += sizeof(BakedMeshHeader);
+
+		std::string diffuseMapPath, specularMapPath, normalMapPath;
+		readBakedString(position, end, meshHeader->diffuseMapPathSize, diffuseMapPath);
+		readBakedString(position, end, meshHeader->specularMapPathSize, specularMapPath);
+		readBakedString(position, end, meshHeader->normalMapPathSize, normalMapPath);
+
+		const Vertex* vertices = (const Vertex*)position;
+		position += meshHeader->vertexQuantity * sizeof(Vertex);
+		const unsigned int* indices = (const unsigned int*)position;
+		position += meshHeader->indexQuantity * sizeof(unsigned int);
+
+		meshes.push_back(new Mesh(vertices, meshHeader->vertexQuantity, indices, meshHeader->indexQuantity,
+			loadBakedTexture(diffuseMapPath, TextureType::COLOR), loadBakedTexture(specularMapPath, TextureType::COLOR),
+			loadBakedTexture(normalMapPath, TextureType::NORMAL_MAP), meshHeader->specularShineness));
+	}
+
+	return true;
+}
+
+// Bake the meshes loaded from the model file. Meshes must still have the textures of the model file.
+// dependencyPaths are the files read while loading the model, which invalidate the baked model when modified.
+void ModelCache::save(const char* modelPath, const std::vector<Mesh*>& meshes,
+	const std::vector<std::string>& dependencyPaths)
+{
+	// Models read from the resource pack have no model file to bake next to
+	if (Resource::getModificationTime(modelPath) == 0)
+		return;
+
+	std::string bakedPath = ModelCache::getBakedPath(modelPath);
+	std::ofstream bakedStream(bakedPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+	if (!bakedStream)
+	{
+		std::cout << "Error baking model " << modelPath << ": could not open " << bakedPath << std::endl;
+		return;
+	}
+
+	BakedModelHeader modelHeader;
+	memcpy(modelHeader.magic, bakedModelMagic, sizeof(bakedModelMagic));
+	modelHeader.version = bakedModelVersion;
+	modelHeader.vertexSize = sizeof(Vertex);
+	modelHeader.meshQuantity = meshes.size();
+	modelHeader.dependencyQuantity = dependencyPaths.size();
+	bakedStream.write((const char*)&modelHeader, sizeof(BakedModelHeader));
+
+	for (unsigned int i = 0; i < dependencyPaths.size(); ++i)
+	{
+		BakedDependencyHeader dependencyHeader;
+		dependencyHeader.modificationTime = Resource::getModificationTime(dependencyPaths[i].c_str());
+		dependencyHeader.pathSize = dependencyPaths[i].size();
+		bakedStream.write((const char*)&dependencyHeader, sizeof(BakedDependencyHeader));
+		writeBakedString(bakedStream, dependencyPaths[i]);
+	}
+
+	for (unsigned int i = 0; i < meshes.size(); ++i)
+	{
+		const std::vector<Vertex>& vertices = meshes[i]->getVertices();
+		const std::vector<unsigned int>& indices = meshes[i]->getIndices();
+		std::string diffuseMapPath = meshes[i]->getDiffuseMap()->getPath();
+		std::string specularMapPath = meshes[i]->getSpecularMap()->getPath();
+		std::string normalMapPath = (meshes[i]->getNormalMap() != 0) ? meshes[i]->getNormalMap()->getPath() : "";
+
+		BakedMeshHeader meshHeader;
+		meshHeader.vertexQuantity = vertices.size();
+		meshHeader.indexQuantity = indices.size();
+		meshHeader.specularShineness = meshes[i]->getSpecularShineness();
+		meshHeader.diffuseMapPathSize = diffuseMapPath.size();
+		meshHeader.specularMapPathSize = specularMapPath.size();
+		meshHeader.normalMapPathSize = normalMapPath.size();
+
+		bakedStream.write((const char*)&meshHeader, sizeof(BakedMeshHeader));
+		writeBakedString(bakedStream, diffuseMapPath);
+		writeBakedString(bakedStream, specularMapPath);
+		writeBakedString(bakedStream, normalMapPath);
+		if (!vertices.empty())
+			bakedStream.write((const char*)&vertices[0], vertices.size() * sizeof(Vertex));
+		if (!indices.empty())
+			bakedStream.write((const char*)&indices[0], indices.size() * sizeof(unsigned int));
+	}
+
+	if (!bakedStream)
+		std::cout << "Error baking model " << modelPath << ": could not write " << bakedPath << std::endl;
+}
+
+std::string ModelCache::getBakedPath(const char* modelPath)
+{
+	return std::string(modelPath) + bakedModelExtension;
+}
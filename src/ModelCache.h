@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Mesh.h"
+#include <string>
+#include <vector>
+
+namespace raw
+{
+	// Binary cache of the models loaded by Assimp, so the models are only parsed and optimized on the first run.
+	// The baked model is written next to the model file, with the ".baked" extension. It stores the vertices and the
+	// indices of each mesh, already optimized, and the paths of their textures. The vertices include the hull of the
+	// player bounding box model, used by Player::createBoundingBox().
+	// A baked model is ignored if it was written by another version of the baker or if any file read to load the model
+	// (the model file, its material library...) was modified after it was baked. Baked models read from the resource
+	// pack are used even if those files are not there.
+	class ModelCache
+	{
+	public:
+		static bool load(const char* modelPath, std::vector<Mesh*>& meshes);
+		static void save(const char* modelPath, const std::vector<Mesh*>& meshes,
+			const std::vector<std::string>& dependencyPaths);
+	private:
+		static std::string getBakedPath(const char* modelPath);
+	};
+}
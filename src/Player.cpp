@@ -5,11 +5,16 @@
 #include "Entity.h"
 #include "Network.h"
 #include "PointLight.h"
+#include "ShotMarkBuffer.h"
 
 #include <GLFW\glfw3.h>
+#include <cfloat>
 
 using namespace raw;
 
+// Maximum quantity of shot marks of each player. The oldest ones are replaced when there are more.
+static const unsigned int shotMarkCapacity = 1024;
+
 // Amount of acceleration player receives when user press movement key
 const float Player::playerMovementAccelerationLength = 5.0f;
 // Maximum velocity player can reach
@@ -52,6 +57,7 @@ Player::Player(Model* model) : Entity(model)
 	std::vector<Mesh*> shotMarkModelMeshes;
 	shotMarkModelMeshes.push_back(StaticModels::getCubeMesh(0.02f, 0, 0, 0, 0));
 	this->shotMarkModel = new Model(shotMarkModelMeshes);
+	this->shotMarks = new ShotMarkBuffer(this->shotMarkModel, shotMarkCapacity);
 
 	// Create damage animation
 	const float damageAnimationScale = 3.6f;
@@ -134,12 +140,6 @@ Player::~Player()
 	delete this->boundingBoxEntity;
 	delete this->boundingBoxModel;
 
-	// Free bounding box vertices that are allocated in BoundingShapes.
-	for (unsigned int i = 0; i < this->boundingBoxInModelCoordinates.size(); ++i)
-		free(this->boundingBoxInModelCoordinates[i].vertices);
-	for (unsigned int i = 0; i < this->boundingBoxInModelCoordinates.size(); ++i)
-		free(this->boundingBoxInWorldCoordinates[i].vertices);
-
 	// Delete gun model and entity
 	delete this->gun->getModel();
 	delete this->gun;
@@ -154,7 +154,8 @@ Player::~Player()
 	delete this->firstPersonGunFiring->getModel();
 	delete this->firstPersonGunFiring;
 
-	// Delete shot mark model
+	// Delete shot marks and their model
+	delete this->shotMarks;
 	delete this->shotMarkModel;
 
 	// Delete health related
@@ -163,10 +164,6 @@ Player::~Player()
 	delete this->healthBar->getModel();
 	delete this->healthBar;
 
-	// Destroy Shot Marks
-	for (unsigned int i = 0; i < this->shotMarks.size(); ++i)
-		delete this->shotMarks[i].entity;
-
 	// Delete damage animation model and entity
 	delete this->damageAnimationEntity->getModel();
 	delete this->damageAnimationEntity;
@@ -174,11 +171,10 @@ Player::~Player()
 
 // Create player bounding box
 // This function will create two vectors of BoundingShapes. These vectors of bounding shapes will contain
-// all vertices of the bounding box and they will be used when calling GJK collisions functions. The space for the
-// vertices must be allocated. The first vector will contain the vertices in model coordinates, while the second one
-// will contain them in world coordinates. However, this function will only fill the model coordinates vector, and will
-// just allocate the world coordinates vector. This is done this way because the world coordinate vertices might change
-// so they will be update whenever necessary (ie, whenever they are accessed by the program later).
+// all vertices of the bounding box and they will be used to test collisions against the player. The vertices of all
+// shapes live in a single arena: first the vertices in model coordinates, then the vertices in world coordinates,
+// in the same order. This function will only fill the model coordinates half. The world coordinates half is filled
+// whenever it is accessed after the bounding box transform changed.
 // This function will also create a Bounding Box Entity, based on the loaded model. This is just to make it possible
 // to render the bounding box with the player whenever necessary.
 void Player::createBoundingBox()
@@ -195,22 +191,35 @@ void Player::createBoundingBox()
 	this->boundingBoxEntity->getTransform().setWorldRotation(this->getTransform().getWorldRotation());
 	this->boundingBoxEntity->getTransform().setWorldScale(this->getTransform().getWorldScale());
 
+	// Allocate the arena. It must not be resized after this, since the bounding shapes point to it.
+	unsigned int vertexQuantity = 0;
+
+	for (unsigned int i = 0; i < boundingBoxMeshes.size(); ++i)
+		vertexQuantity += boundingBoxMeshes[i]->getVertices().size();
+
+	this->boundingBoxVertexArena.resize(2 * vertexQuantity);
+	this->isBoundingBoxInWorldCoordinatesValid = false;
+
 	// Iterate over bounding box meshes
+	unsigned int arenaOffset = 0;
+
 	for (unsigned int i = 0; i < boundingBoxMeshes.size(); ++i)
 	{
 		// Get mesh vertices
 		const std::vector<Vertex>& vertices = boundingBoxMeshes[i]->getVertices();
 
-		// Allocate bounding shape vertices space (model coords)
+		// Bounding shape vertices (model coords)
 		BoundingShape boundingBoxModelCoords;
-		boundingBoxModelCoords.vertices = (vec3*)malloc(vertices.size() * sizeof(vec3));
+		boundingBoxModelCoords.vertices = &this->boundingBoxVertexArena[arenaOffset];
 		boundingBoxModelCoords.num_vertices = vertices.size();
 
-		// Allocate bounding shape vertices space (world coords)
+		// Bounding shape vertices (world coords)
 		BoundingShape boundingBoxWorldCoords;
-		boundingBoxWorldCoords.vertices = (vec3*)malloc(vertices.size() * sizeof(vec3));
+		boundingBoxWorldCoords.vertices = &this->boundingBoxVertexArena[vertexQuantity + arenaOffset];
 		boundingBoxWorldCoords.num_vertices = vertices.size();
 
+		arenaOffset += vertices.size();
+
 		// Fill bounding shape with vertices (model coords)
 		for (unsigned int j = 0; j < vertices.size(); ++j)
 		{
@@ -221,10 +230,38 @@ void Player::createBoundingBox()
 			boundingBoxModelCoords.vertices[j] = aux;
 		}
 
-		// Push bounding boxes (world coordinates just allocaed, not initialized).
+		// Push bounding boxes (world coordinates not initialized yet).
 		this->boundingBoxInModelCoordinates.push_back(boundingBoxModelCoords);
 		this->boundingBoxInWorldCoordinates.push_back(boundingBoxWorldCoords);
+
+		// Find the hull faces, they are used to test rays against the bounding box
+		this->boundingBoxFaces.push_back(Collision::getConvexHullFaces(boundingBoxModelCoords));
 	}
+
+	// Create a sphere around the whole bounding box, used to discard rays quickly
+	glm::vec3 minBounds = glm::vec3(FLT_MAX);
+	glm::vec3 maxBounds = glm::vec3(-FLT_MAX);
+
+	for (unsigned int i = 0; i < this->boundingBoxInModelCoordinates.size(); ++i)
+		for (int j = 0; j < this->boundingBoxInModelCoordinates[i].num_vertices; ++j)
+		{
+			const vec3& vertex = this->boundingBoxInModelCoordinates[i].vertices[j];
+			minBounds = glm::min(minBounds, glm::vec3(vertex.x, vertex.y, vertex.z));
+			maxBounds = glm::max(maxBounds, glm::vec3(vertex.x, vertex.y, vertex.z));
+		}
+
+	glm::vec3 center = (minBounds + maxBounds) / 2.0f;
+	float radius = 0.0f;
+
+	for (unsigned int i = 0; i < this->boundingBoxInModelCoordinates.size(); ++i)
+		for (int j = 0; j < this->boundingBoxInModelCoordinates[i].num_vertices; ++j)
+		{
+			const vec3& vertex = this->boundingBoxInModelCoordinates[i].vertices[j];
+			radius = glm::max(radius, glm::length(glm::vec3(vertex.x, vertex.y, vertex.z) - center));
+		}
+
+	this->boundingSphereInModelCoordinates.center = glm::vec4(center, 1.0f);
+	this->boundingSphereInModelCoordinates.radius = radius;
 }
 
 // Create player camera
@@ -324,18 +361,18 @@ Camera* Player::getCamera()
 	return this->camera;
 }
 
-// Render all shotmarks
-void Player::renderShotMarks(const Shader& shader, const Camera& camera) const
+// Render all shotmarks with a single instanced draw
+void Player::renderShotMarks(const Shader& shader) const
 {
 	if (this->bRenderShotMarks)
-		for (unsigned int i = 0; i < this->shotMarks.size(); ++i)
-			this->shotMarks[i].entity->render(shader, camera, this->shotMarks[i].color);
+		this->shotMarks->render(shader);
 }
 
-// Render gun
-void Player::renderGun(const Shader& shader, const Camera& camera, const std::vector<Light*>& lights, bool useNormalMap) const
+// Submit gun to the render queue
+void Player::submitGun(RenderQueue& renderQueue, const Shader& shader, const Camera& camera,
+	const std::vector<Light*>& lights, bool useNormalMap, bool cullFace) const
 {
-	this->gun->render(shader, camera, lights, useNormalMap);
+	this->gun->submit(renderQueue, shader, camera, lights, useNormalMap, cullFace);
 }
 
 // Render aim and first person gun
@@ -581,16 +618,19 @@ glm::vec4 Player::getNewPositionForMovement(Map* map, float deltaTime) const
 	// Check if there is a collision in x coordinate
 	auxiliarVector = playerPosition;
 	auxiliarVector.x = newPos.x;
-	TerrainType terrainType = map->getTerrainTypeForMovement(auxiliarVector);
+	TerrainType terrainType = map->getTerrainTypeForMovement(playerPosition, auxiliarVector);
 	if (terrainType != TerrainType::FREE)
-		newPos.x = playerPosition.x;
+		auxiliarVector.x = playerPosition.x;
 
-	// Check if there is a collision in z coordinate
-	auxiliarVector = playerPosition;
+	// Check if there is a collision in z coordinate, starting from the position found above
+	glm::vec4 slidePosition = auxiliarVector;
 	auxiliarVector.z = newPos.z;
-	terrainType = map->getTerrainTypeForMovement(auxiliarVector);
+	terrainType = map->getTerrainTypeForMovement(slidePosition, auxiliarVector);
 	if (terrainType != TerrainType::FREE)
-		newPos.z = playerPosition.z;
+		auxiliarVector.z = playerPosition.z;
+
+	newPos.x = auxiliarVector.x;
+	newPos.z = auxiliarVector.z;
 
 	return newPos;
 }
@@ -613,30 +653,28 @@ void Player::setMovementAcceleration(const glm::vec4& movementAcceleration)
 
 // Shoot, test collisions with second player and map walls.
 // If network is not null, this function will also send collision information to the second player (multiplayer mode)
-void Player::shoot(Player* secondPlayer, const std::vector<MapWallDescriptor>& mapWallDescriptors, Network* network)
+void Player::shoot(Player* secondPlayer, const MapWallAccelerationStructure& mapWallAccelerationStructure, Network* network)
 {
 	// Ray attributes
 	glm::vec4 rayPosition = this->camera->getPosition();
 	glm::vec4 rayDirection = this->camera->getViewVector();
-	glm::vec4 rayXAxis = this->camera->getXAxis();
-	glm::vec4 rayYAxis = this->camera->getYAxis();
 
 	// Test collision with second Player
 	PlayerCollisionDescriptor playerCollisionDescriptor = Collision::isRayCollidingWithBoundingBox(rayPosition,
-		rayDirection, rayXAxis, rayYAxis, secondPlayer->getBoundingBoxInWorldCoordinates());
+		rayDirection, secondPlayer->getBoundingBoxInWorldCoordinates(), secondPlayer->getBoundingBoxFaces(),
+		secondPlayer->getBoundingSphereInWorldCoordinates());
 
 	// Test collision with map walls
 	CollisionDescriptor mapWallsCollisionDescriptor = Collision::getClosestWallRayIsColliding(rayPosition, 
-		rayDirection, mapWallDescriptors);
+		rayDirection, mapWallAccelerationStructure);
 
 	// If there was a collision with second player AND a wall
 	if (playerCollisionDescriptor.collision.collide && mapWallsCollisionDescriptor.collide)
 	{
 		// Check closer collision - wall or player?
-		glm::vec4 secondPlayerCollisionPosition = secondPlayer->getTransform().getWorldPosition();	// Approximation
 		glm::vec4 wallCollisionPosition = mapWallsCollisionDescriptor.worldPosition;
 
-		float distancePlayerToPlayer = glm::length(rayPosition - secondPlayerCollisionPosition);
+		float distancePlayerToPlayer = playerCollisionDescriptor.distance;
 		float distancePlayerToWall = glm::length(rayPosition - wallCollisionPosition);
 
 		if (distancePlayerToPlayer < distancePlayerToWall)
@@ -690,13 +728,13 @@ void Player::shoot(Player* secondPlayer, const std::vector<MapWallDescriptor>& m
 
 // Shoot, test collisions with second player and map walls.
 // This is offline mode, secondPlayer should probably be a bot or something
-void Player::shoot(Player* secondPlayer, const std::vector<MapWallDescriptor>& mapWallDescriptors)
+void Player::shoot(Player* secondPlayer, const MapWallAccelerationStructure& mapWallAccelerationStructure)
 {
-	this->shoot(secondPlayer, mapWallDescriptors, 0);
+	this->shoot(secondPlayer, mapWallAccelerationStructure, 0);
 }
 
 // Shoot, test collisions with map walls only.
-void Player::shoot(const std::vector<MapWallDescriptor>& mapWallDescriptors)
+void Player::shoot(const MapWallAccelerationStructure& mapWallAccelerationStructure)
 {
 	// Ray attributes
 	glm::vec4 rayPosition = this->camera->getPosition();
@@ -704,7 +742,7 @@ void Player::shoot(const std::vector<MapWallDescriptor>& mapWallDescriptors)
 
 	// Test collision with map walls
 	CollisionDescriptor mapWallsCollisionDescriptor = Collision::getClosestWallRayIsColliding(rayPosition,
-		rayDirection, mapWallDescriptors);
+		rayDirection, mapWallAccelerationStructure);
 
 	// If there was a collision
 	if (mapWallsCollisionDescriptor.collide)
@@ -771,21 +809,57 @@ const std::vector<BoundingShape>& Player::getBoundingBoxInModelCoordinates() con
 // Get player bounding box in world coordinates. Dynamic, might change as player moves.
 std::vector<BoundingShape>& Player::getBoundingBoxInWorldCoordinates()
 {
-	mat4 modelMatrix;
-	glm::mat4 m;
+	this->updateBoundingBoxInWorldCoordinates();
 
-	// For each boundingShape in model coordinates, multiply vertices by the model matrix by calling
-	// transform_shape and passing the matrix. Store the result in boundingBoxInWorldCoordinates vector.
-	for (unsigned int i = 0; i < this->boundingBoxInModelCoordinates.size(); ++i)
-	{
-		m = glm::transpose(this->boundingBoxEntity->getTransform().getModelMatrix());
-		memcpy(modelMatrix.data, glm::value_ptr(m), 16 * sizeof(float));
+	// Return the bounding box in world coords.
+	return this->boundingBoxInWorldCoordinates;
+}
+
+// Get the faces of each bounding shape of the bounding box. Valid for both model and world coordinates.
+const std::vector<BoundingShapeFaces>& Player::getBoundingBoxFaces() const
+{
+	return this->boundingBoxFaces;
+}
+
+// Get the sphere around the whole bounding box in world coordinates.
+const BoundingSphere& Player::getBoundingSphereInWorldCoordinates()
+{
+	this->updateBoundingBoxInWorldCoordinates();
+	return this->boundingSphereInWorldCoordinates;
+}
+
+// Transform the bounding box vertices and sphere to world coordinates.
+// Nothing is done if the bounding box transform did not change since the last update.
+void Player::updateBoundingBoxInWorldCoordinates()
+{
+	const Transform& boundingBoxTransform = this->boundingBoxEntity->getTransform();
+	unsigned int transformVersion = boundingBoxTransform.getVersion();
+
+	if (this->isBoundingBoxInWorldCoordinatesValid && this->boundingBoxWorldCoordinatesVersion == transformVersion)
+		return;
+
+	glm::mat4 modelMatrix = boundingBoxTransform.getModelMatrix();
+	unsigned int vertexQuantity = this->boundingBoxVertexArena.size() / 2;
 
-		transform_shape(&this->boundingBoxInModelCoordinates[i], &this->boundingBoxInWorldCoordinates[i], modelMatrix);
+	// Model coordinates are in the first half of the arena and world coordinates in the second half
+	for (unsigned int i = 0; i < vertexQuantity; ++i)
+	{
+		const vec3& modelVertex = this->boundingBoxVertexArena[i];
+		glm::vec4 worldVertex = modelMatrix * glm::vec4(modelVertex.x, modelVertex.y, modelVertex.z, 1.0f);
+		vec3& aux = this->boundingBoxVertexArena[vertexQuantity + i];
+		aux.x = worldVertex.x;
+		aux.y = worldVertex.y;
+		aux.z = worldVertex.z;
 	}
 
-	// Return the bounding box in world coords.
-	return this->boundingBoxInWorldCoordinates;
+	float maxScale = glm::max(glm::length(glm::vec3(modelMatrix[0])),
+		glm::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+
+	this->boundingSphereInWorldCoordinates.center = modelMatrix * this->boundingSphereInModelCoordinates.center;
+	this->boundingSphereInWorldCoordinates.radius = this->boundingSphereInModelCoordinates.radius * maxScale;
+
+	this->boundingBoxWorldCoordinatesVersion = transformVersion;
+	this->isBoundingBoxInWorldCoordinatesValid = true;
 }
 
 // This function receives an index identifying a bounding box mesh and returns the body part related.
@@ -880,14 +954,10 @@ glm::vec4 Player::getAcceleration() const
 	return this->movementAcceleration + this->jumpAcceleration;
 }
 
+// Create a shot mark at the position. Only the last shotMarkCapacity shot marks are kept.
 void Player::createShotMark(glm::vec4 position)
 {
-	ShotMark shotMark;
-	Entity* shotMarkEntity = new Entity(this->shotMarkModel);
-	shotMarkEntity->getTransform().setWorldPosition(position);
-	shotMark.entity = shotMarkEntity;
-	shotMark.color = this->wallShotMarkColor;
-	this->shotMarks.push_back(shotMark);
+	this->shotMarks->addShotMark(position, this->wallShotMarkColor);
 }
 
 void Player::setRenderShotMarks(bool renderShotMarks)
@@ -10,6 +10,8 @@ namespace raw
 {
 	class Network;
 	class PointLight;
+	class MapWallAccelerationStructure;
+	class ShotMarkBuffer;
 
 	enum class PlayerBodyPart
 	{
@@ -36,10 +38,18 @@ namespace raw
 		DECREASING
 	};
 
-	struct ShotMark
+	struct BoundingSphere
 	{
-		Entity* entity;
-		glm::vec4 color;
+		glm::vec4 center;
+		float radius;
+	};
+
+	// Faces of the convex hull of a BoundingShape, stored as triples of indexes into its vertices.
+	// Vertices of each face are counter-clockwise when seen from outside. The faces are found once in model
+	// coordinates and stay valid for the shape in world coordinates.
+	struct BoundingShapeFaces
+	{
+		std::vector<unsigned int> vertexIndexes;
 	};
 
 	class Player : public Entity
@@ -64,8 +74,9 @@ namespace raw
 		glm::vec4 getVelocity() const;
 		glm::vec4 getAcceleration() const;
 		Camera* getCamera();
-		void renderGun(const Shader& shader, const Camera& camera, const std::vector<Light*>& lights, bool useNormalMap) const;
-		void Player::renderShotMarks(const Shader& shader, const Camera& camera) const;
+		void submitGun(RenderQueue& renderQueue, const Shader& shader, const Camera& camera,
+			const std::vector<Light*>& lights, bool useNormalMap, bool cullFace) const;
+		void renderShotMarks(const Shader& shader) const;
 		void renderScreenImages(const Shader& shader, const Shader& hpBarShader) const;
 		void setMovementInterpolationOn(bool movementInterpolationOn);
 		void pushMovementInterpolation(const glm::vec4& finalPosition, const glm::vec4& velocity,
@@ -76,9 +87,9 @@ namespace raw
 		void changeLookDirection(const glm::vec4& lookDirection);
 		glm::vec4 getLookDirection() const;
 		glm::vec4 getPerpendicularDirection() const;
-		void shoot(Player* secondPlayer, const std::vector<MapWallDescriptor>& mapWallDescriptors, Network* network);
-		void shoot(Player* secondPlayer, const std::vector<MapWallDescriptor>& mapWallDescriptors);
-		void shoot(const std::vector<MapWallDescriptor>& mapWallDescriptors);
+		void shoot(Player* secondPlayer, const MapWallAccelerationStructure& mapWallAccelerationStructure, Network* network);
+		void shoot(Player* secondPlayer, const MapWallAccelerationStructure& mapWallAccelerationStructure);
+		void shoot(const MapWallAccelerationStructure& mapWallAccelerationStructure);
 		void startShootingAnimation();
 		void startDamageAnimation();
 		void jump();
@@ -88,6 +99,8 @@ namespace raw
 		// GJK & COLLISION
 		const std::vector<BoundingShape>& getBoundingBoxInModelCoordinates() const;
 		std::vector<BoundingShape>& getBoundingBoxInWorldCoordinates();
+		const std::vector<BoundingShapeFaces>& getBoundingBoxFaces() const;
+		const BoundingSphere& getBoundingSphereInWorldCoordinates();
 		static PlayerBodyPart getBoundingBoxBodyPart(unsigned int boundingBoxVectorIndex);
 	private:
 		void createCamera();
@@ -98,6 +111,7 @@ namespace raw
 		void setIsShootingAnimationOn(bool isShootingAnimationOn);
 		void setIsDamageAnimationOn(bool isDamageAnimationOn);
 		void updateMovement(Map* map, float deltaTime);
+		void updateBoundingBoxInWorldCoordinates();
 		glm::vec4 getNewPositionForMovement(Map* map, float deltaTime) const;
 		void setMovementVelocity(const glm::vec4& movementVelocity);
 		void setMovementAcceleration(const glm::vec4& movementAcceleration);
@@ -133,7 +147,7 @@ namespace raw
 
 		// Shot Marks
 		glm::vec4 wallShotMarkColor;
-		std::vector<ShotMark> shotMarks;
+		ShotMarkBuffer* shotMarks;
 		Model* shotMarkModel;
 		bool bRenderShotMarks;
 
@@ -142,6 +156,12 @@ namespace raw
 		Model* boundingBoxModel;
 		std::vector<BoundingShape> boundingBoxInModelCoordinates;
 		std::vector<BoundingShape> boundingBoxInWorldCoordinates;
+		std::vector<vec3> boundingBoxVertexArena;
+		std::vector<BoundingShapeFaces> boundingBoxFaces;
+		BoundingSphere boundingSphereInModelCoordinates;
+		BoundingSphere boundingSphereInWorldCoordinates;
+		unsigned int boundingBoxWorldCoordinatesVersion;
+		bool isBoundingBoxInWorldCoordinatesValid;
 
 		// Shooting Animation Related
 		bool isShootingAnimationOn;
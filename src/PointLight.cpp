@@ -37,34 +37,30 @@ LightAttenuation PointLight::getAttenuation() const
 	return this->attenuation;
 }
 
-// Send all information about the light to the shader, so it can be used when rendering.
-void PointLight::updateUniforms(const Shader& shader, unsigned int arrayPosition) const
+// Fill the light descriptor that is sent to the shaders.
+void PointLight::fillShaderDescriptor(LightShaderDescriptor& descriptor) const
 {
-	Light::updateUniforms(shader, arrayPosition);
+	Light::fillShaderDescriptor(descriptor);
 
-	char locationBuffer[1024];
-
-	glm::vec4 lightPosition = this->getPosition();
-	float lightConstantTerm = this->attenuation.constantTerm;
-	float lightLinearTerm = this->attenuation.linearTerm;
-	float lightQuadraticTerm = this->attenuation.quadraticTerm;
-
-	this->getShaderLocationString("position", locationBuffer, arrayPosition);
-	GLuint lightPositionLocation = glGetUniformLocation(shader.getProgram(), locationBuffer);
-	this->getShaderLocationString("constantTerm", locationBuffer, arrayPosition);
-	GLuint lightConstantTermLocation = glGetUniformLocation(shader.getProgram(), locationBuffer);
-	this->getShaderLocationString("linearTerm", locationBuffer, arrayPosition);
-	GLuint lightLinearTermLocation = glGetUniformLocation(shader.getProgram(), locationBuffer);
-	this->getShaderLocationString("quadraticTerm", locationBuffer, arrayPosition);
-	GLuint lightQuadraticTermLocation = glGetUniformLocation(shader.getProgram(), locationBuffer);
-
-	glUniform4f(lightPositionLocation, lightPosition.x, lightPosition.y, lightPosition.z, lightPosition.w);
-	glUniform1f(lightConstantTermLocation, lightConstantTerm);
-	glUniform1f(lightLinearTermLocation, lightLinearTerm);
-	glUniform1f(lightQuadraticTermLocation, lightQuadraticTerm);
+	descriptor.position = this->getPosition();
+	descriptor.constantTerm = this->attenuation.constantTerm;
+	descriptor.linearTerm = this->attenuation.linearTerm;
+	descriptor.quadraticTerm = this->attenuation.quadraticTerm;
 }
 
 LightType PointLight::getType() const
 {
 	return LT_POINTLIGHT;
+}
+
+// Get the distance beyond which the attenuated light is negligible.
+float PointLight::getInfluenceRadius() const
+{
+	return this->calculateInfluenceRadius(this->attenuation, 1.0f);
+}
+
+// Get the attenuated intensity of the light on the closest point of the box.
+float PointLight::getIntensityOnBox(const glm::vec3& center, const glm::vec3& extent) const
+{
+	return this->calculateIntensityOnBox(this->attenuation, 1.0f, this->position, center, extent);
 }
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include "RenderQueue.h"
+#include "RenderStatistics.h"
+#include <algorithm>
+
+using namespace raw;
+
+// Layout of the sort key. The most significant bit separates the opaque draws from the transparent draws.
+// Opaque: face culling (1 bit), shader (8 bits), material (16 bits), VAO (16 bits), depth (22 bits).
+// Transparent: inverted depth (22 bits), face culling (1 bit), shader (8 bits), material (16 bits), VAO (16 bits).
+// The shader, material and VAO fields only hold the low bits of their GL names, so two of them may share a field
+// value. This only affects the grouping, the state is always compared with the state of the last draw.
+static const unsigned long long transparentKeyBit = 1ULL << 63;
+static const unsigned int depthKeyBits = 22;
+static const unsigned long long depthKeyMaximum = (1ULL << depthKeyBits) - 1;
+
+// Start a new frame. The depth of the draws is their distance to the camera, relative to its far plane.
+void RenderQueue::begin(const Camera& camera)
+{
+	this->commands.clear();
+	this->sortedCommands.clear();
+	this->cameraPosition = glm::vec3(camera.getPosition());
+	this->cameraRange = fabsf(camera.getFarPlane());
+}
+
+// Queue a draw. position is the world position used to sort the draw by depth, usually the center of the bounding
+// box of the entity. Transparent draws are rendered with alpha blending and without writing to the depth buffer.
+void RenderQueue::submit(const RenderCommand& command, const glm::vec3& position, bool transparent)
+{
+	if (!command.mesh->isVisible())
+		return;
+
+	this->sortedCommands.push_back(std::make_pair(this->getKey(command, position, transparent),
+		(unsigned int)this->commands.size()));
+	this->commands.push_back(command);
+}
+
+// Issue all queued draws, sorted by their keys, and clear the queue.
+// The camera and the lights are read by the shaders from the frame block and the light cluster buffers, like in
+// Entity::render().
+void RenderQueue::execute()
+{
+	std::sort(this->sortedCommands.begin(), this->sortedCommands.end());
+
+	const Shader* boundShader = 0;
+	const Mesh* boundMaterial = 0;
+	bool boundUseNormalMap = false;
+	GLuint boundVAO = 0;
+	bool cullFace = false;
+	bool transparent = false;
+
+	for (unsigned int i = 0; i < this->sortedCommands.size(); ++i)
+	{
+		const RenderCommand& command = this->commands[this->sortedCommands[i].second];
+
+		if (!transparent && (this->sortedCommands[i].first & transparentKeyBit))
+		{
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			glEnable(GL_BLEND);
+			glDepthMask(GL_FALSE);
+			RenderStatistics::addGLCalls(3);
+			transparent = true;
+		}
+
+		if (command.cullFace != cullFace)
+		{
+			if (command.cullFace)
+			{
+				glEnable(GL_CULL_FACE);
+				glFrontFace(GL_CCW);
+				RenderStatistics::addGLCalls(2);
+			}
+			else
+			{
+				glDisable(GL_CULL_FACE);
+				RenderStatistics::addGLCalls(1);
+			}
+			cullFace = command.cullFace;
+		}
+
+		// Material uniforms belong to the program, so they must be sent again after a program change
+		if (command.shader != boundShader)
+		{
+			command.shader->useProgram();
+			boundShader = command.shader;
+			boundMaterial = 0;
+		}
+
+		if (boundMaterial == 0 || !command.mesh->hasSameMaterial(*boundMaterial) ||
+			command.useNormalMap != boundUseNormalMap)
+		{
+			command.mesh->bindMaterial(*command.shader, command.useNormalMap);
+			boundMaterial = command.mesh;
+			boundUseNormalMap = command.useNormalMap;
+		}
+
+		if (command.mesh->getVAO() != boundVAO)
+		{
+			glBindVertexArray(command.mesh->getVAO());
+			RenderStatistics::addGLCalls(1);
+			RenderStatistics::addVertexArrayBinds(1);
+			boundVAO = command.mesh->getVAO();
+		}
+
+		GLint modelMatrixLocation = command.shader->getUniformLocation(ShaderUniform::MODEL_MATRIX);
+		glUniformMatrix4fv(modelMatrixLocation, 1, GL_FALSE, glm::value_ptr(command.modelMatrix));
+		RenderStatistics::addGLCalls(1);
+
+		// Vertex lit shaders only evaluate the lights selected for the entity
+		GLint entityLightsLocation = command.shader->getUniformLocation(ShaderUniform::ENTITY_LIGHTS);
+		if (entityLightsLocation != -1)
+		{
+			GLint entityLightQuantityLocation = command.shader->getUniformLocation(ShaderUniform::ENTITY_LIGHT_QUANTITY);
+
+			if (command.entityLightQuantity > 0)
+			{
+				glUniform1iv(entityLightsLocation, command.entityLightQuantity, command.entityLights);
+				RenderStatistics::addGLCalls(1);
+			}
+			glUniform1i(entityLightQuantityLocation, command.entityLightQuantity);
+			RenderStatistics::addGLCalls(1);
+		}
+
+		command.mesh->draw(1);
+	}
+
+	if (boundVAO != 0)
+	{
+		glBindVertexArray(0);
+		RenderStatistics::addGLCalls(1);
+	}
+
+	if (cullFace)
+	{
+		glDisable(GL_CULL_FACE);
+		RenderStatistics::addGLCalls(1);
+	}
+
+	if (transparent)
+	{
+		glDepthMask(GL_TRUE);
+		glDisable(GL_BLEND);
+		RenderStatistics::addGLCalls(2);
+	}
+
+	this->commands.clear();
+	this->sortedCommands.clear();
+}
+
+unsigned long long RenderQueue::getKey(const RenderCommand& command, const glm::vec3& position, bool transparent) const
+{
+	unsigned long long shader = command.shader->getProgram() & 0xFF;
+	unsigned long long material = command.mesh->getDiffuseMap()->getTextureId() & 0xFFFF;
+	unsigned long long vao = command.mesh->getVAO() & 0xFFFF;
+	unsigned long long cullFace = command.cullFace ? 1 : 0;
+	float distance = glm::clamp(glm::length(position - this->cameraPosition) / this->cameraRange, 0.0f, 1.0f);
+	unsigned long long depth = (unsigned long long)(distance * depthKeyMaximum);
+
+	if (transparent)
+		return transparentKeyBit | ((depthKeyMaximum - depth) << 41) | (cullFace << 40) | (shader << 32) |
+			(material << 16) | vao;
+	else
+		return (cullFace << 62) | (shader << 54) | (material << 38) | (vao << 22) | depth;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Entity.h"
+#include "Mesh.h"
+#include <vector>
+#include <utility>
+
+namespace raw
+{
+	// Draw of one mesh, submitted to the render queue.
+	struct RenderCommand
+	{
+		const Shader* shader;
+		const Mesh* mesh;
+		glm::mat4 modelMatrix;
+		bool useNormalMap;
+		bool cullFace;
+		GLint entityLights[entityMaximumLights];
+		GLint entityLightQuantity;
+	};
+
+	// Collects the draws of a frame and issues them sorted by a 64-bit key, so the program, texture and VAO binds
+	// are only issued when they change between two consecutive draws.
+	// Opaque draws are issued first, grouped by face culling, shader, material and VAO, and then from the nearest to
+	// the farthest. Transparent draws are issued after them with blending enabled, from the farthest to the nearest.
+	class RenderQueue
+	{
+	public:
+		void begin(const Camera& camera);
+		void submit(const RenderCommand& command, const glm::vec3& position, bool transparent);
+		void execute();
+	private:
+		unsigned long long getKey(const RenderCommand& command, const glm::vec3& position, bool transparent) const;
+		std::vector<RenderCommand> commands;
+		std::vector<std::pair<unsigned long long, unsigned int>> sortedCommands;
+		glm::vec3 cameraPosition;
+		float cameraRange;
+	};
+}
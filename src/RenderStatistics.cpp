@@ -0,0 +1,123 @@
+#include "RenderStatistics.h"
+
+using namespace raw;
+
+unsigned int RenderStatistics::currentFrameGLCalls = 0;
+unsigned int RenderStatistics::lastFrameGLCalls = 0;
+unsigned int RenderStatistics::currentFrameDrawnObjects = 0;
+unsigned int RenderStatistics::lastFrameDrawnObjects = 0;
+unsigned int RenderStatistics::currentFrameCulledObjects = 0;
+unsigned int RenderStatistics::lastFrameCulledObjects = 0;
+unsigned int RenderStatistics::currentFrameProgramBinds = 0;
+unsigned int RenderStatistics::lastFrameProgramBinds = 0;
+unsigned int RenderStatistics::currentFrameTextureBinds = 0;
+unsigned int RenderStatistics::lastFrameTextureBinds = 0;
+unsigned int RenderStatistics::currentFrameVertexArrayBinds = 0;
+unsigned int RenderStatistics::lastFrameVertexArrayBinds = 0;
+unsigned int RenderStatistics::currentFrameUniformLookups = 0;
+unsigned int RenderStatistics::lastFrameUniformLookups = 0;
+
+// Add GL calls to the counter of the current frame. Must be called from the GL thread.
+void RenderStatistics::addGLCalls(unsigned int quantity)
+{
+	RenderStatistics::currentFrameGLCalls += quantity;
+}
+
+// Close the current frame, storing its counters and resetting them for the next frame.
+void RenderStatistics::endFrame()
+{
+	RenderStatistics::lastFrameGLCalls = RenderStatistics::currentFrameGLCalls;
+	RenderStatistics::currentFrameGLCalls = 0;
+	RenderStatistics::lastFrameDrawnObjects = RenderStatistics::currentFrameDrawnObjects;
+	RenderStatistics::currentFrameDrawnObjects = 0;
+	RenderStatistics::lastFrameCulledObjects = RenderStatistics::currentFrameCulledObjects;
+	RenderStatistics::currentFrameCulledObjects = 0;
+	RenderStatistics::lastFrameProgramBinds = RenderStatistics::currentFrameProgramBinds;
+	RenderStatistics::currentFrameProgramBinds = 0;
+	RenderStatistics::lastFrameTextureBinds = RenderStatistics::currentFrameTextureBinds;
+	RenderStatistics::currentFrameTextureBinds = 0;
+	RenderStatistics::lastFrameVertexArrayBinds = RenderStatistics::currentFrameVertexArrayBinds;
+	RenderStatistics::currentFrameVertexArrayBinds = 0;
+	RenderStatistics::lastFrameUniformLookups = RenderStatistics::currentFrameUniformLookups;
+	RenderStatistics::currentFrameUniformLookups = 0;
+}
+
+// Get the quantity of GL calls issued by the last frame.
+unsigned int RenderStatistics::getLastFrameGLCalls()
+{
+	return RenderStatistics::lastFrameGLCalls;
+}
+
+
+// Add objects that passed the frustum test to the counter of the current frame.
+void RenderStatistics::addDrawnObjects(unsigned int quantity)
+{
+	RenderStatistics::currentFrameDrawnObjects += quantity;
+}
+
+// Get the quantity of objects drawn by the last frame.
+unsigned int RenderStatistics::getLastFrameDrawnObjects()
+{
+	return RenderStatistics::lastFrameDrawnObjects;
+}
+
+// Add objects that were skipped by the frustum test to the counter of the current frame.
+void RenderStatistics::addCulledObjects(unsigned int quantity)
+{
+	RenderStatistics::currentFrameCulledObjects += quantity;
+}
+
+// Get the quantity of objects culled by the last frame.
+unsigned int RenderStatistics::getLastFrameCulledObjects()
+{
+	return RenderStatistics::lastFrameCulledObjects;
+}
+
+// Add shader program binds (glUseProgram) to the counter of the current frame.
+void RenderStatistics::addProgramBinds(unsigned int quantity)
+{
+	RenderStatistics::currentFrameProgramBinds += quantity;
+}
+
+// Get the quantity of shader program binds issued by the last frame.
+unsigned int RenderStatistics::getLastFrameProgramBinds()
+{
+	return RenderStatistics::lastFrameProgramBinds;
+}
+
+// Add texture binds to the counter of the current frame.
+void RenderStatistics::addTextureBinds(unsigned int quantity)
+{
+	RenderStatistics::currentFrameTextureBinds += quantity;
+}
+
+// Get the quantity of texture binds issued by the last frame.
+unsigned int RenderStatistics::getLastFrameTextureBinds()
+{
+	return RenderStatistics::lastFrameTextureBinds;
+}
+
+// Add vertex array binds to the counter of the current frame.
+void RenderStatistics::addVertexArrayBinds(unsigned int quantity)
+{
+	RenderStatistics::currentFrameVertexArrayBinds += quantity;
+}
+
+// Get the quantity of vertex array binds issued by the last frame.
+unsigned int RenderStatistics::getLastFrameVertexArrayBinds()
+{
+	return RenderStatistics::lastFrameVertexArrayBinds;
+}
+
+// Add uniform location lookups to the counter of the current frame. Lookups are served by the location cache of
+// Shader, but each one was a glGetUniformLocation call before the cache, so the counter shows the calls saved.
+void RenderStatistics::addUniformLookups(unsigned int quantity)
+{
+	RenderStatistics::currentFrameUniformLookups += quantity;
+}
+
+// Get the quantity of uniform location lookups done by the last frame.
+unsigned int RenderStatistics::getLastFrameUniformLookups()
+{
+	return RenderStatistics::lastFrameUniformLookups;
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+namespace raw
+{
+	// Counts the GL calls issued by the render paths of the engine (program binds, uniform uploads, texture
+	// binds and draws), so the cost of a frame can be measured. Also counts the objects drawn and the objects
+	// culled against the camera frustum, and the state changes (program, texture and vertex array binds).
+	// Uniform location lookups are counted apart: they are answered by the Shader cache without calling GL.
+	class RenderStatistics
+	{
+	public:
+		static void addGLCalls(unsigned int quantity);
+		static void endFrame();
+		static unsigned int getLastFrameGLCalls();
+		static void addDrawnObjects(unsigned int quantity);
+		static unsigned int getLastFrameDrawnObjects();
+		static void addCulledObjects(unsigned int quantity);
+		static unsigned int getLastFrameCulledObjects();
+		static void addProgramBinds(unsigned int quantity);
+		static unsigned int getLastFrameProgramBinds();
+		static void addTextureBinds(unsigned int quantity);
+		static unsigned int getLastFrameTextureBinds();
+		static void addVertexArrayBinds(unsigned int quantity);
+		static unsigned int getLastFrameVertexArrayBinds();
+		static void addUniformLookups(unsigned int quantity);
+		static unsigned int getLastFrameUniformLookups();
+	private:
+		static unsigned int currentFrameGLCalls;
+		static unsigned int lastFrameGLCalls;
+		static unsigned int currentFrameDrawnObjects;
+		static unsigned int lastFrameDrawnObjects;
+		static unsigned int currentFrameCulledObjects;
+		static unsigned int lastFrameCulledObjects;
+		static unsigned int currentFrameProgramBinds;
+		static unsigned int lastFrameProgramBinds;
+		static unsigned int currentFrameTextureBinds;
+		static unsigned int lastFrameTextureBinds;
+		static unsigned int currentFrameVertexArrayBinds;
+		static unsigned int lastFrameVertexArrayBinds;
+		static unsigned int currentFrameUniformLookups;
+		static unsigned int lastFrameUniformLookups;
+	};
+}
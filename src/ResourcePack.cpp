@@ -0,0 +1,572 @@
+#include "ResourcePack.h"
+#include <Windows.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <cctype>
+
+using namespace raw;
+
+static const unsigned int resourcePackVersion = 1;
+static const char resourcePackMagic[4] = { 'R', 'A', 'W', 'P' };
+
+// Alignment of the contents of the files in the pack.
+static const unsigned int resourcePackAlignment = 16;
+
+// Files are only stored compressed when compression saves at least 1/resourcePackMinimumCompressionRatio of them.
+static const unsigned int resourcePackMinimumCompressionRatio = 8;
+
+// LZ4 block format constants. The last match must start at least lz4MatchStartLimit bytes before the end of the
+// block, and the last lz4LastLiterals bytes are always literals.
+static const unsigned int lz4MinimumMatch = 4;
+static const unsigned int lz4MatchStartLimit = 12;
+static const unsigned int lz4LastLiterals = 5;
+static const unsigned int lz4MaximumOffset = 65535;
+static const unsigned int lz4HashBits = 16;
+
+// Contents of empty resources, so the data of a loaded resource is never null.
+static const unsigned char emptyResourceData[1] = { 0 };
+
+#pragma pack(push, 1)
+struct ResourcePackHeader
+{
+	char magic[4];
+	unsigned int version;
+	unsigned int entryQuantity;
+	unsigned int alignment;
+};
+#pragma pack(pop)
+
+void* ResourcePack::file = 0;
+void* ResourcePack::mapping = 0;
+const unsigned char* ResourcePack::data = 0;
+unsigned long long ResourcePack::size = 0;
+const ResourcePackEntry* ResourcePack::entries = 0;
+unsigned int ResourcePack::entryQuantity = 0;
+long long ResourcePack::modificationTime = 0;
+
+// Open the resource pack, mapping it to memory. Returns false if the pack does not exist or is not valid, in which
+// case the resources are read from the asset files.
+bool ResourcePack::open(const char* packPath)
+{
+	ResourcePack::close();
+
+	HANDLE packFile = CreateFileA(packPath, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (packFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER packSize;
+	HANDLE packMapping = 0;
+	const unsigned char* packData = 0;
+
+	if (GetFileSizeEx(packFile, &packSize) && packSize.QuadPart >= (long long)sizeof(ResourcePackHeader))
+		packMapping = CreateFileMappingA(packFile, 0, PAGE_READONLY, 0, 0, 0);
+	if (packMapping != 0)
+		packData = (const unsigned char*)MapViewOfFile(packMapping, FILE_MAP_READ, 0, 0, 0);
+
+	ResourcePack::file = packFile;
+	ResourcePack::mapping = packMapping;
+	ResourcePack::data = packData;
+
+	if (packData == 0)
+	{
+		std::cout << "Error opening resource pack " << packPath << std::endl;
+		ResourcePack::close();
+		return false;
+	}
+
+	// Validate the header and the table of contents, so resources never read outside of the mapped memory
+	const ResourcePackHeader* header = (const ResourcePackHeader*)packData;
+	unsigned long long tableEnd = sizeof(ResourcePackHeader) +
+		(unsigned long long)header->entryQuantity * sizeof(ResourcePackEntry);
+	bool valid = memcmp(header->magic, resourcePackMagic, sizeof(resourcePackMagic)) == 0 &&
+		header->version == resourcePackVersion && tableEnd <= (unsigned long long)packSize.QuadPart;
+
+	const ResourcePackEntry* packEntries = (const ResourcePackEntry*)(packData + sizeof(ResourcePackHeader));
+	for (unsigned int i = 0; valid && i < header->entryQuantity; ++i)
+	{
+		unsigned long long storedSize = packEntries[i].compressedSize ? packEntries[i].compressedSize :
+			packEntries[i].size;
+		valid = packEntries[i].path[resourcePackPathMaxSize - 1] == 0 && packEntries[i].offset >= tableEnd &&
+			packEntries[i].offset + storedSize <= (unsigned long long)packSize.QuadPart;
+	}
+
+	if (!valid)
+	{
+		std::cout << "Error opening resource pack " << packPath << ": invalid pack" << std::endl;
+		ResourcePack::close();
+		return false;
+	}
+
+	ResourcePack::size = packSize.QuadPart;
+	ResourcePack::entries = packEntries;
+	ResourcePack::entryQuantity = header->entryQuantity;
+	ResourcePack::modificationTime = Resource::getModificationTime(packPath);
+
+	std::cout << "Resource pack " << packPath << ": " << ResourcePack::entryQuantity << " files" << std::endl;
+	return true;
+}
+
+// Close the resource pack. Resources read from it must not be used after this.
+void ResourcePack::close()
+{
+	if (ResourcePack::data != 0)
+		UnmapViewOfFile(ResourcePack::data);
+	if (ResourcePack::mapping != 0)
+		CloseHandle(ResourcePack::mapping);
+	if (ResourcePack::file != 0)
+		CloseHandle(ResourcePack::file);
+
+	ResourcePack::file = 0;
+	ResourcePack::mapping = 0;
+	ResourcePack::data = 0;
+	ResourcePack::size = 0;
+	ResourcePack::entries = 0;
+	ResourcePack::entryQuantity = 0;
+	ResourcePack::modificationTime = 0;
+}
+
+// Build a resource pack with all files of the directories, which must be relative to the working directory.
+bool ResourcePack::pack(const std::vector<std::string>& directories, const char* packPath)
+{
+	std::vector<std::string> files;
+	for (unsigned int i = 0; i < directories.size(); ++i)
+		ResourcePack::listFiles(directories[i], files);
+
+	// Sort the files by their normalized path, which is the order of the table of contents
+	std::vector<std::pair<std::string, std::string>> sortedFiles;
+	for (unsigned int i = 0; i < files.size(); ++i)
+	{
+		std::string normalizedPath = ResourcePack::normalizePath(files[i].c_str());
+
+		if (normalizedPath.size() >= resourcePackPathMaxSize)
+		{
+			std::cout << "Error packing " << files[i] << ": path is too long" << std::endl;
+			continue;
+		}
+
+		sortedFiles.push_back(std::make_pair(normalizedPath, files[i]));
+	}
+	std::sort(sortedFiles.begin(), sortedFiles.end());
+
+	std::ofstream packStream(packPath, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!packStream)
+	{
+		std::cout << "Error packing resources: could not open " << packPath << std::endl;
+		return false;
+	}
+
+	std::vector<ResourcePackEntry> packEntries(sortedFiles.size());
+	unsigned long long offset = sizeof(ResourcePackHeader) + packEntries.size() * sizeof(ResourcePackEntry);
+	unsigned long long totalSize = 0;
+	unsigned long long totalStoredSize = 0;
+	std::vector<unsigned char> contents;
+	std::vector<unsigned char> compressedContents;
+	static const char padding[resourcePackAlignment] = { 0 };
+
+	// The table of contents is written after the contents, when their offsets are known
+	packStream.seekp(offset);
+
+	for (unsigned int i = 0; i < sortedFiles.size(); ++i)
+	{
+		std::ifstream fileStream(sortedFiles[i].second.c_str(), std::ios::in | std::ios::binary);
+		fileStream.seekg(0, std::ios::end);
+		contents.resize((unsigned int)fileStream.tellg());
+		fileStream.seekg(0, std::ios::beg);
+		if (!contents.empty())
+			fileStream.read((char*)&contents[0], contents.size());
+
+		if (!fileStream)
+		{
+			std::cout << "Error packing resources: could not read " << sortedFiles[i].second << std::endl;
+			return false;
+		}
+
+		unsigned int compressedSize = ResourcePack::compress(contents.empty() ? 0 : &contents[0], contents.size(),
+			compressedContents);
+		bool useCompression = compressedSize > 0 &&
+			compressedSize <= contents.size() - contents.size() / resourcePackMinimumCompressionRatio;
+		const std::vector<unsigned char>& storedContents = useCompression ? compressedContents : contents;
+
+		unsigned long long alignedOffset = (offset + resourcePackAlignment - 1) / resourcePackAlignment *
+			resourcePackAlignment;
+		packStream.write(padding, alignedOffset - offset);
+		if (!storedContents.empty())
+			packStream.write((const char*)&storedContents[0], storedContents.size());
+
+		memset(&packEntries[i], 0, sizeof(ResourcePackEntry));
+		strcpy(packEntries[i].path, sortedFiles[i].first.c_str());
+		packEntries[i].offset = alignedOffset;
+		packEntries[i].size = contents.size();
+		packEntries[i].compressedSize = useCompression ? compressedSize : 0;
+
+		offset = alignedOffset + storedContents.size();
+		totalSize += contents.size();
+		totalStoredSize += storedContents.size();
+	}
+
+	ResourcePackHeader header;
+	memcpy(header.magic, resourcePackMagic, sizeof(resourcePackMagic));
+	header.version = resourcePackVersion;
+	header.entryQuantity = packEntries.size();
+	header.alignment = resourcePackAlignment;
+
+	packStream.seekp(0);
+	packStream.write((const char*)&header, sizeof(ResourcePackHeader));
+	if (!packEntries.empty())
+		packStream.write((const char*)&packEntries[0], packEntries.size() * sizeof(ResourcePackEntry));
+
+	if (!packStream)
+	{
+		std::cout << "Error packing resources: could not write " << packPath << std::endl;
+		return false;
+	}
+
+	std::cout << "Resource pack " << packPath << ": " << packEntries.size() << " files, " << totalSize << " bytes, " <<
+		totalStoredSize << " bytes stored" << std::endl;
+	return true;
+}
+
+// Find the entry of a file in the pack. Returns null if the pack is not open or does not contain the file.
+const ResourcePackEntry* ResourcePack::findEntry(const char* path)
+{
+	if (ResourcePack::entryQuantity == 0)
+		return 0;
+
+	std::string normalizedPath = ResourcePack::normalizePath(path);
+	unsigned int first = 0;
+	unsigned int last = ResourcePack::entryQuantity;
+
+	while (first < last)
+	{
+		unsigned int middle = (first + last) / 2;
+		int comparison = strcmp(ResourcePack::entries[middle].path, normalizedPath.c_str());
+
+		if (comparison == 0)
+			return &ResourcePack::entries[middle];
+		else if (comparison < 0)
+			first = middle + 1;
+		else
+			last = middle;
+	}
+
+	return 0;
+}
+
+// Get the last modification time of the open pack, or 0 if no pack is open.
+long long ResourcePack::getModificationTime()
+{
+	return ResourcePack::modificationTime;
+}
+
+// Get the stored (possibly compressed) contents of an entry, in the mapped memory.
+const unsigned char* ResourcePack::getEntryData(const ResourcePackEntry* entry)
+{
+	return ResourcePack::data + entry->offset;
+}
+
+// Normalize a path: lower case, '/' separators and no "." or ".." segments.
+std::string ResourcePack::normalizePath(const char* path)
+{
+	std::vector<std::string> segments;
+	std::string segment;
+
+	for (const char* c = path; ; ++c)
+	{
+		if (*c == '/' || *c == '\\' || *c == 0)
+		{
+			if (segment == "..")
+			{
+				if (!segments.empty() && segments.back() != "..")
+					segments.pop_back();
+				else
+					segments.push_back(segment);
+			}
+			else if (!segment.empty() && segment != ".")
+				segments.push_back(segment);
+
+			segment.clear();
+
+			if (*c == 0)
+				break;
+		}
+		else
+			segment += (char)tolower((unsigned char)*c);
+	}
+
+	std::string normalizedPath;
+	for (unsigned int i = 0; i < segments.size(); ++i)
+	{
+		if (i > 0)
+			normalizedPath += '/';
+		normalizedPath += segments[i];
+	}
+
+	return normalizedPath;
+}
+
+static unsigned int readUnaligned32(const unsigned char* source)
+{
+	unsigned int value;
+	memcpy(&value, source, sizeof(unsigned int));
+	return value;
+}
+
+// Write a length that does not fit in the 4 bits of the token: bytes of 255 followed by the remainder.
+static void writeLz4Length(unsigned int length, std::vector<unsigned char>& destination)
+{
+	while (length >= 255)
+	{
+		destination.push_back(255);
+		length -= 255;
+	}
+	destination.push_back((unsigned char)length);
+}
+
+// Write a sequence: literals followed by a match. A match length of 0 writes only the literals (last sequence).
+static void writeLz4Sequence(const unsigned char* literals, unsigned int literalLength, unsigned int matchOffset,
+	unsigned int matchLength, std::vector<unsigned char>& destination)
+{
+	unsigned int encodedMatchLength = matchLength > 0 ? matchLength - lz4MinimumMatch : 0;
+	unsigned char token = (unsigned char)((literalLength < 15 ? literalLength : 15) << 4);
+	token |= (unsigned char)(encodedMatchLength < 15 ? encodedMatchLength : 15);
+	destination.push_back(token);
+
+	if (literalLength >= 15)
+		writeLz4Length(literalLength - 15, destination);
+	destination.insert(destination.end(), literals, literals + literalLength);
+
+	if (matchLength == 0)
+		return;
+
+	destination.push_back((unsigned char)(matchOffset & 0xFF));
+	destination.push_back((unsigned char)(matchOffset >> 8));
+	if (encodedMatchLength >= 15)
+		writeLz4Length(encodedMatchLength - 15, destination);
+}
+
+// Compress data to the LZ4 block format, with a greedy parser that finds matches through a hash table of the last
+// position of each 4 byte sequence. Returns the compressed size.
+unsigned int ResourcePack::compress(const unsigned char* source, unsigned int sourceSize,
+	std::vector<unsigned char>& destination)
+{
+	std::vector<unsigned int> hashTable(1 << lz4HashBits, 0xFFFFFFFF);
+	unsigned int anchor = 0;
+	unsigned int position = 0;
+	unsigned int matchStartLimit = sourceSize > lz4MatchStartLimit ? sourceSize - lz4MatchStartLimit : 0;
+
+	destination.clear();
+
+	while (position < matchStartLimit)
+	{
+		unsigned int sequence = readUnaligned32(source + position);
+		unsigned int hash = (sequence * 2654435761u) >> (32 - lz4HashBits);
+		unsigned int candidate = hashTable[hash];
+		hashTable[hash] = position;
+
+		if (candidate == 0xFFFFFFFF || position - candidate > lz4MaximumOffset ||
+			readUnaligned32(source + candidate) != sequence)
+		{
+			++position;
+			continue;
+		}
+
+		unsigned int matchLength = lz4MinimumMatch;
+		unsigned int matchLengthLimit = sourceSize - lz4LastLiterals - position;
+		while (matchLength < matchLengthLimit && source[candidate + matchLength] == source[position + matchLength])
+			++matchLength;
+
+		writeLz4Sequence(source + anchor, position - anchor, position - candidate, matchLength, destination);
+		position += matchLength;
+		anchor = position;
+	}
+
+	writeLz4Sequence(source + anchor, sourceSize - anchor, 0, 0, destination);
+	return destination.size();
+}
+
+// Decompress an LZ4 block. Returns false if the block is corrupted or does not decompress to exactly destinationSize
+// bytes.
+bool ResourcePack::decompress(const unsigned char* source, unsigned int sourceSize, unsigned char* destination,
+	unsigned int destinationSize)
+{
+	const unsigned char* sourceEnd = source + sourceSize;
+	unsigned char* output = destination;
+	unsigned char* outputEnd = destination + destinationSize;
+
+	while (source < sourceEnd)
+	{
+		unsigned int token = *source++;
+
+		unsigned int literalLength = token >> 4;
+		if (literalLength == 15)
+		{
+			unsigned char lengthByte;
+			do
+			{
+				if (source >= sourceEnd)
+					return false;
+				lengthByte = *source++;
+				literalLength += lengthByte;
+			} while (lengthByte == 255);
+		}
+
+		if (literalLength > (unsigned int)(sourceEnd - source) || literalLength > (unsigned int)(outputEnd - output))
+			return false;
+		memcpy(output, source, literalLength);
+		output += literalLength;
+		source += literalLength;
+
+		// The last sequence has no match
+		if (source == sourceEnd)
+			break;
+
+		if (sourceEnd - source < 2)
+			return false;
+		unsigned int matchOffset = source[0] | (source[1] << 8);
+		source += 2;
+		if (matchOffset == 0 || matchOffset > (unsigned int)(output - destination))
+			return false;
+
+		unsigned int matchLength = token & 15;
+		if (matchLength == 15)
+		{
+			unsigned char lengthByte;
+			do
+			{
+				if (source >= sourceEnd)
+					return false;
+				lengthByte = *source++;
+				matchLength += lengthByte;
+			} while (lengthByte == 255);
+		}
+		matchLength += lz4MinimumMatch;
+
+		if (matchLength > (unsigned int)(outputEnd - output))
+			return false;
+
+		// Byte by byte, since the match may overlap the output
+		const unsigned char* match = output - matchOffset;
+		for (unsigned int i = 0; i < matchLength; ++i)
+			*output++ = *match++;
+	}
+
+	return output == outputEnd;
+}
+
+// Add all files of the directory and of its subdirectories to the vector.
+void ResourcePack::listFiles(const std::string& directory, std::vector<std::string>& files)
+{
+	WIN32_FIND_DATAA findData;
+	HANDLE find = FindFirstFileA((directory + "\\*").c_str(), &findData);
+
+	if (find == INVALID_HANDLE_VALUE)
+		return;
+
+	do
+	{
+		std::string name = findData.cFileName;
+		if (name == "." || name == "..")
+			continue;
+
+		std::string path = directory + "\\" + name;
+		if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			ResourcePack::listFiles(path, files);
+		else
+			files.push_back(path);
+	} while (FindNextFileA(find, &findData));
+
+	FindClose(find);
+}
+
+// Read a resource, from the resource pack if it contains the file, or from the file otherwise.
+Resource::Resource(const char* path)
+{
+	this->data = 0;
+	this->size = 0;
+	this->loaded = false;
+
+	const ResourcePackEntry* entry = ResourcePack::findEntry(path);
+
+	// Files edited after the pack was built are read from the disk, so the pack does not hide changes to the assets
+	if (entry != 0 && Resource::getModificationTime(path) > ResourcePack::getModificationTime())
+		entry = 0;
+
+	if (entry != 0)
+	{
+		if (entry->compressedSize == 0)
+		{
+			this->data = entry->size > 0 ? ResourcePack::getEntryData(entry) : emptyResourceData;
+			this->size = entry->size;
+			this->loaded = true;
+			return;
+		}
+
+		this->buffer.resize(entry->size);
+		if (ResourcePack::decompress(ResourcePack::getEntryData(entry), entry->compressedSize,
+			this->buffer.empty() ? 0 : &this->buffer[0], entry->size))
+		{
+			this->data = this->buffer.empty() ? emptyResourceData : &this->buffer[0];
+			this->size = entry->size;
+			this->loaded = true;
+			return;
+		}
+
+		std::cout << "Error reading resource " << path << " from the resource pack: corrupted data" << std::endl;
+	}
+
+	std::ifstream fileStream(path, std::ios::in | std::ios::binary);
+	if (!fileStream)
+		return;
+
+	fileStream.seekg(0, std::ios::end);
+	this->buffer.resize((unsigned int)fileStream.tellg());
+	fileStream.seekg(0, std::ios::beg);
+	if (!this->buffer.empty())
+		fileStream.read((char*)&this->buffer[0], this->buffer.size());
+
+	if (!fileStream)
+		return;
+
+	this->data = this->buffer.empty() ? emptyResourceData : &this->buffer[0];
+	this->size = this->buffer.size();
+	this->loaded = true;
+}
+
+bool Resource::isLoaded() const
+{
+	return this->loaded;
+}
+
+const unsigned char* Resource::getData() const
+{
+	return this->data;
+}
+
+unsigned int Resource::getSize() const
+{
+	return this->size;
+}
+
+// Check whether a resource exists, in the resource pack or as a file.
+bool Resource::exists(const char* path)
+{
+	if (ResourcePack::findEntry(path) != 0)
+		return true;
+
+	std::ifstream fileStream(path, std::ios::in | std::ios::binary);
+	return fileStream.good();
+}
+
+// Get the last modification time of a file on the disk, or 0 if the file does not exist.
+long long Resource::getModificationTime(const char* path)
+{
+	struct stat fileStatus;
+
+	if (stat(path, &fileStatus) != 0)
+		return 0;
+
+	return (long long)fileStatus.st_mtime;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace raw
+{
+	const unsigned int resourcePackPathMaxSize = 128;
+
+	#pragma pack(push, 1)
+	// Entry of the table of contents of a resource pack. compressedSize is 0 if the file is stored uncompressed.
+	struct ResourcePackEntry
+	{
+		char path[resourcePackPathMaxSize];
+		unsigned long long offset;
+		unsigned int size;
+		unsigned int compressedSize;
+	};
+	#pragma pack(pop)
+
+	// Archive with all asset files (textures, models, shaders and the map), memory mapped by the engine.
+	// The pack starts with a header and the table of contents, sorted by path, followed by the contents of the files,
+	// each one aligned to resourcePackAlignment bytes. Files that compress well are stored with LZ4 (block format),
+	// the others (png and jpg images) are stored as they are, so they are read in place from the mapped memory.
+	// Paths are normalized (lower case, '/' separators, relative to the working directory), so ".\res\art\a.png"
+	// and "res/art/a.png" are the same file.
+	// The pack is built by running the engine with the "-pack" argument. Baked models and textures are packed too, so
+	// they are not baked again when only the pack is shipped.
+	class ResourcePack
+	{
+	public:
+		static bool open(const char* packPath);
+		static void close();
+		static bool pack(const std::vector<std::string>& directories, const char* packPath);
+		static const ResourcePackEntry* findEntry(const char* path);
+		static const unsigned char* getEntryData(const ResourcePackEntry* entry);
+		static long long getModificationTime();
+		static std::string normalizePath(const char* path);
+		static unsigned int compress(const unsigned char* source, unsigned int sourceSize,
+			std::vector<unsigned char>& destination);
+		static bool decompress(const unsigned char* source, unsigned int sourceSize, unsigned char* destination,
+			unsigned int destinationSize);
+	private:
+		static void listFiles(const std::string& directory, std::vector<std::string>& files);
+		static void* file;
+		static void* mapping;
+		static const unsigned char* data;
+		static unsigned long long size;
+		static const ResourcePackEntry* entries;
+		static unsigned int entryQuantity;
+		static long long modificationTime;
+	};
+
+	// Contents of an asset file. The file is read from the resource pack when the pack contains it, unless the file on
+	// the disk was modified after the pack was built, or from the disk otherwise. Files stored uncompressed in the pack
+	// are not copied, so the data is only valid while the resource and the pack are open.
+	class Resource
+	{
+	public:
+		Resource(const char* path);
+		bool isLoaded() const;
+		const unsigned char* getData() const;
+		unsigned int getSize() const;
+		static bool exists(const char* path);
+		static long long getModificationTime(const char* path);
+	private:
+		// Not copyable: data may point into buffer
+		Resource(const Resource& resource);
+		Resource& operator=(const Resource& resource);
+		const unsigned char* data;
+		unsigned int size;
+		bool loaded;
+		std::vector<unsigned char> buffer;
+	};
+}
@@ -1,11 +1,30 @@
 #include "Shader.h"
+#include "RenderStatistics.h"
+#include "ResourcePack.h"
 #include <iostream>
-#include <istream>
-#include <fstream>
-#include <sstream>
 
 using namespace raw;
 
+// Names of the uniforms, in the same order as ShaderUniform.
+static const char* shaderUniformNames[] = {
+	"modelMatrix",
+	"scaleMatrix",
+	"solidColor",
+	"material.diffuseMap",
+	"material.specularMap",
+	"material.shineness",
+	"material.normalMap",
+	"material.useNormalMap",
+	"fixedTexture",
+	"cubeMap",
+	"playerHp",
+	"playerMaximumHp",
+	"useInstancing",
+	"entityLights",
+	"entityLightQuantity",
+	"lightIndex"
+};
+
 // Creates a new shader based on the ShaderType received.
 // The paths of the files associated with each ShaderType are defined in Shader.h
 Shader::Shader(ShaderType type)
@@ -47,27 +66,27 @@ Shader::Shader(ShaderType type)
 		vertexShaderPath = hpBarVertexShaderPath;
 		fragmentShaderPath = hpBarFragmentShaderPath;
 		break;
+	case ShaderType::DEFERRED:
+		vertexShaderPath = deferredVertexShaderPath;
+		fragmentShaderPath = deferredFragmentShaderPath;
+		break;
+	case ShaderType::DEFERRED_LIGHT:
+		vertexShaderPath = deferredLightVertexShaderPath;
+		fragmentShaderPath = deferredLightFragmentShaderPath;
+		break;
 	default:
 		vertexShaderPath = basicVertexShaderPath;
 		fragmentShaderPath = basicFragmentShaderPath;
 		break;
 	}
 
-	std::ifstream vertexShaderInputStream;
-	std::stringstream vertexShaderStringStream;
-	vertexShaderInputStream.open(vertexShaderPath, std::ios::in);
-	vertexShaderStringStream << vertexShaderInputStream.rdbuf();
-	std::string vertexShaderCodeStr = vertexShaderStringStream.str();
+	Resource vertexShaderResource(vertexShaderPath);
+	std::string vertexShaderCodeStr((const char*)vertexShaderResource.getData(), vertexShaderResource.getSize());
 	const char* vertexShaderCode = vertexShaderCodeStr.c_str();
-	vertexShaderInputStream.close();
 
-	std::ifstream fragmentShaderInputStream;
-	std::stringstream fragmentShaderStringStream;
-	fragmentShaderInputStream.open(fragmentShaderPath, std::ios::in);
-	fragmentShaderStringStream << fragmentShaderInputStream.rdbuf();
-	std::string fragmentShaderCodeStr = fragmentShaderStringStream.str();
+	Resource fragmentShaderResource(fragmentShaderPath);
+	std::string fragmentShaderCodeStr((const char*)fragmentShaderResource.getData(), fragmentShaderResource.getSize());
 	const char* fragmentShaderCode = fragmentShaderCodeStr.c_str();
-	fragmentShaderInputStream.close();
 
 	GLint success;
 	GLchar infoLogBuffer[1024];
@@ -106,6 +125,86 @@ Shader::Shader(ShaderType type)
 	}
 
 	this->type = type;
+	this->reflectUniforms();
+	this->bindUniformBlock(lightClusterUniformBlockName, lightClusterUniformBlockBindingPoint);
+	this->bindUniformBlock(frameUniformBlockName, frameUniformBlockBindingPoint);
+	this->bindSampler(lightDescriptorsSamplerName, lightDescriptorsTextureUnit);
+	this->bindSampler(lightClustersSamplerName, lightClustersTextureUnit);
+	this->bindSampler(lightIndicesSamplerName, lightIndicesTextureUnit);
+	this->bindSampler(gBufferPositionSamplerName, gBufferPositionTextureUnit);
+	this->bindSampler(gBufferNormalSamplerName, gBufferNormalTextureUnit);
+	this->bindSampler(gBufferAlbedoSamplerName, gBufferAlbedoTextureUnit);
+	this->bindSampler(gBufferSpecularSamplerName, gBufferSpecularTextureUnit);
+}
+
+// Query all active uniforms of the linked program and cache their locations, so no glGetUniformLocation
+// call is needed when rendering.
+// Array uniforms are reported by GL only by their first element ("name[0]"), so each element is queried as well.
+void Shader::reflectUniforms()
+{
+	GLint activeUniformQuantity = 0, maximumNameLength = 0;
+	glGetProgramiv(this->shaderProgram, GL_ACTIVE_UNIFORMS, &activeUniformQuantity);
+	glGetProgramiv(this->shaderProgram, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maximumNameLength);
+
+	std::vector<GLchar> nameBuffer(maximumNameLength + 1);
+
+	for (GLint i = 0; i < activeUniformQuantity; ++i)
+	{
+		GLsizei nameLength;
+		GLint uniformSize;
+		GLenum uniformType;
+		glGetActiveUniform(this->shaderProgram, i, (GLsizei)nameBuffer.size(), &nameLength, &uniformSize,
+			&uniformType, nameBuffer.data());
+		std::string name(nameBuffer.data(), nameLength);
+
+		this->uniformLocationsByName[name] = glGetUniformLocation(this->shaderProgram, name.c_str());
+		RenderStatistics::addGLCalls(1);
+
+		// Primitive arrays: "name[0]" also gives "name" and each element "name[k]"
+		if (uniformSize > 1 && name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+		{
+			std::string baseName = name.substr(0, name.size() - 3);
+			this->uniformLocationsByName[baseName] = this->uniformLocationsByName[name];
+			for (GLint j = 1; j < uniformSize; ++j)
+			{
+				std::string elementName = baseName + "[" + std::to_string(j) + "]";
+				this->uniformLocationsByName[elementName] = glGetUniformLocation(this->shaderProgram,
+					elementName.c_str());
+				RenderStatistics::addGLCalls(1);
+			}
+		}
+	}
+
+	for (unsigned int i = 0; i < (unsigned int)ShaderUniform::QUANTITY; ++i)
+	{
+		std::unordered_map<std::string, GLint>::const_iterator it = this->uniformLocationsByName.find(
+			shaderUniformNames[i]);
+		this->uniformLocations[i] = (it != this->uniformLocationsByName.end()) ? it->second : -1;
+	}
+}
+
+// Attach the uniform block blockName, if the shader declares it, to the binding point bindingPoint, where the
+// uniform buffer holding its data is bound.
+void Shader::bindUniformBlock(const char* blockName, GLuint bindingPoint)
+{
+	GLuint blockIndex = glGetUniformBlockIndex(this->shaderProgram, blockName);
+
+	if (blockIndex != GL_INVALID_INDEX)
+		glUniformBlockBinding(this->shaderProgram, blockIndex, bindingPoint);
+}
+
+// Point the sampler samplerName, if the shader declares it, to the texture unit textureUnit. Used for the samplers
+// that are bound once per frame to fixed units, instead of by each mesh.
+void Shader::bindSampler(const char* samplerName, GLint textureUnit)
+{
+	GLint samplerLocation = this->getUniformLocation(samplerName);
+
+	if (samplerLocation != -1)
+	{
+		glUseProgram(this->shaderProgram);
+		glUniform1i(samplerLocation, textureUnit);
+		glUseProgram(0);
+	}
 }
 
 Shader::~Shader()
@@ -121,6 +220,27 @@ GLuint Shader::getProgram() const
 void Shader::useProgram() const
 {
 	glUseProgram(this->shaderProgram);
+	RenderStatistics::addGLCalls(1);
+	RenderStatistics::addProgramBinds(1);
+}
+
+// Get the cached location of an engine uniform. Returns -1 if the shader does not use it.
+GLint Shader::getUniformLocation(ShaderUniform uniform) const
+{
+	RenderStatistics::addUniformLookups(1);
+	return this->uniformLocations[(unsigned int)uniform];
+}
+
+// Get the cached location of any active uniform by its name. Returns -1 if the shader does not use it.
+GLint Shader::getUniformLocation(const std::string& name) const
+{
+	RenderStatistics::addUniformLookups(1);
+	std::unordered_map<std::string, GLint>::const_iterator it = this->uniformLocationsByName.find(name);
+
+	if (it == this->uniformLocationsByName.end())
+		return -1;
+
+	return it->second;
 }
 
 ShaderType Shader::getType() const
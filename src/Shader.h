@@ -1,6 +1,9 @@
 #pragma once
 
 #include <GL\glew.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
 
 const char fixedVertexShaderPath[] = ".\\shaders\\FixedShader.vs";
 const char fixedFragmentShaderPath[] = ".\\shaders\\FixedShader.fs";
@@ -18,6 +21,31 @@ const char skyboxVertexShaderPath[] = ".\\shaders\\SkyboxShader.vs";
 const char skyboxFragmentShaderPath[] = ".\\shaders\\SkyboxShader.fs";
 const char hpBarVertexShaderPath[] = ".\\shaders\\HpBarShader.vs";
 const char hpBarFragmentShaderPath[] = ".\\shaders\\HpBarShader.fs";
+const char deferredVertexShaderPath[] = ".\\shaders\\DeferredShader.vs";
+const char deferredFragmentShaderPath[] = ".\\shaders\\DeferredShader.fs";
+const char deferredLightVertexShaderPath[] = ".\\shaders\\DeferredLightShader.vs";
+const char deferredLightFragmentShaderPath[] = ".\\shaders\\DeferredLightShader.fs";
+
+const char lightClusterUniformBlockName[] = "LightClusterBlock";
+const GLuint lightClusterUniformBlockBindingPoint = 0;
+const char frameUniformBlockName[] = "FrameBlock";
+const GLuint frameUniformBlockBindingPoint = 1;
+
+const char lightDescriptorsSamplerName[] = "lightDescriptors";
+const GLint lightDescriptorsTextureUnit = 8;
+const char lightClustersSamplerName[] = "lightClusters";
+const GLint lightClustersTextureUnit = 9;
+const char lightIndicesSamplerName[] = "lightIndices";
+const GLint lightIndicesTextureUnit = 10;
+
+const char gBufferPositionSamplerName[] = "gBufferPosition";
+const GLint gBufferPositionTextureUnit = 0;
+const char gBufferNormalSamplerName[] = "gBufferNormal";
+const GLint gBufferNormalTextureUnit = 1;
+const char gBufferAlbedoSamplerName[] = "gBufferAlbedo";
+const GLint gBufferAlbedoTextureUnit = 2;
+const char gBufferSpecularSamplerName[] = "gBufferSpecular";
+const GLint gBufferSpecularTextureUnit = 3;
 
 namespace raw
 {
@@ -30,7 +58,31 @@ namespace raw
 		GOURAD,
 		PHONG,
 		SKYBOX,
-		HPBAR
+		HPBAR,
+		DEFERRED,
+		DEFERRED_LIGHT
+	};
+
+	// Uniforms used by the engine. Their locations are cached when the shader is linked.
+	enum class ShaderUniform
+	{
+		MODEL_MATRIX,
+		SCALE_MATRIX,
+		SOLID_COLOR,
+		MATERIAL_DIFFUSE_MAP,
+		MATERIAL_SPECULAR_MAP,
+		MATERIAL_SHINENESS,
+		MATERIAL_NORMAL_MAP,
+		MATERIAL_USE_NORMAL_MAP,
+		FIXED_TEXTURE,
+		CUBE_MAP,
+		PLAYER_HP,
+		PLAYER_MAXIMUM_HP,
+		USE_INSTANCING,
+		ENTITY_LIGHTS,
+		ENTITY_LIGHT_QUANTITY,
+		LIGHT_INDEX,
+		QUANTITY
 	};
 	
 	class Shader
@@ -41,8 +93,15 @@ namespace raw
 		GLuint getProgram() const;
 		ShaderType getType() const;
 		void useProgram() const;
+		GLint getUniformLocation(ShaderUniform uniform) const;
+		GLint getUniformLocation(const std::string& name) const;
 	private:
+		void reflectUniforms();
+		void bindUniformBlock(const char* blockName, GLuint bindingPoint);
+		void bindSampler(const char* samplerName, GLint textureUnit);
 		GLuint shaderProgram;
 		ShaderType type;
+		std::unordered_map<std::string, GLint> uniformLocationsByName;
+		GLint uniformLocations[(unsigned int)ShaderUniform::QUANTITY];
 	};
 }
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "ShotBenchmark.h"
+#include "Collision.h"
+#include "MapWallGrid.h"
+#include "MapWallBVH.h"
+#include "WorkerPool.h"
+#include <vector>
+#include <cstdlib>
+#include <chrono>
+#include <iostream>
+
+using namespace raw;
+
+// Sizes of the square maps used by the shot benchmark, in cells
+static const int benchmarkMinimumMapSize = 32;
+static const int benchmarkMaximumMapSize = 2048;
+// Fraction of blocked cells of the benchmark maps
+static const float benchmarkBlockedCellRatio = 0.2f;
+// The linear search tests every wall for each ray, so it only fires a few rays
+static const unsigned int benchmarkMaximumLinearRayQuantity = 200;
+
+static float getRandomFloat(float minimum, float maximum)
+{
+	return minimum + (maximum - minimum) * (float)rand() / (float)RAND_MAX;
+}
+
+// Fire rays through the map walls with the linear search (mapWallAccelerationStructure = 0) or with an
+// acceleration structure. Returns the quantity of rays per second.
+static double benchmarkShotQuery(const std::vector<RayDescriptor>& rays, unsigned int rayQuantity,
+	const std::vector<MapWallDescriptor>& mapWallDescriptors,
+	const MapWallAccelerationStructure* mapWallAccelerationStructure, std::vector<CollisionDescriptor>& collisions)
+{
+	std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
+
+	for (unsigned int i = 0; i < rayQuantity; ++i)
+	{
+		if (mapWallAccelerationStructure)
+			collisions[i] = Collision::getClosestWallRayIsColliding(rays[i].position, rays[i].direction,
+				*mapWallAccelerationStructure);
+		else
+			collisions[i] = Collision::getClosestWallRayIsColliding(rays[i].position, rays[i].direction,
+				mapWallDescriptors);
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - begin;
+	return rayQuantity / elapsed.count();
+}
+
+// Fire all the rays at once through the acceleration structure, split among the threads of the worker pool.
+// Returns the quantity of rays per second.
+static double benchmarkShotBatch(const std::vector<RayDescriptor>& rays,
+	const MapWallAccelerationStructure& mapWallAccelerationStructure, WorkerPool& workerPool,
+	std::vector<CollisionDescriptor>& collisions)
+{
+	std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
+
+	Collision::getClosestWallsRaysAreColliding(rays.data(), (unsigned int)rays.size(), mapWallAccelerationStructure,
+		collisions.data(), &workerPool);
+
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - begin;
+	return rays.size() / elapsed.count();
+}
+
+static bool isSameCollision(const CollisionDescriptor& a, const CollisionDescriptor& b)
+{
+	return a.collide == b.collide && (!a.collide || a.worldPosition == b.worldPosition);
+}
+
+// Measure the shots per second of the wall queries on random square maps of 32x32 to 2048x2048 cells.
+// For each map size, rayQuantity rays are fired from random free cells, in random directions, through the uniform
+// grid and the BVH used by the game. The linear search is measured with up to benchmarkMaximumLinearRayQuantity of
+// the same rays, which are also used to check that the acceleration structures return the same walls.
+// The batch query fires all the rays through the BVH with a worker pool, and must match the single BVH queries.
+void ShotBenchmark::run(unsigned int rayQuantity)
+{
+	WorkerPool workerPool(WorkerPool::getDefaultWorkerQuantity());
+
+	std::cout << "Map size | Walls | Linear rays/s | Grid rays/s | BVH rays/s | Batch rays/s | Mismatches" << std::endl;
+
+	for (int mapSize = benchmarkMinimumMapSize; mapSize <= benchmarkMaximumMapSize; mapSize *= 2)
+	{
+		// Four channels per pixel, a cell is free if its red channel is 255
+		std::vector<unsigned char> mapBytes(mapSize * mapSize * 4, 255);
+		std::vector<int> freeCells;
+
+		for (int i = 0; i < mapSize * mapSize; ++i)
+		{
+			if (getRandomFloat(0.0f, 1.0f) < benchmarkBlockedCellRatio)
+				mapBytes[i * 4] = 0;
+			else
+				freeCells.push_back(i);
+		}
+
+		Map map(&mapBytes[0], mapSize, mapSize);
+		std::vector<MapWallDescriptor> mapWallDescriptors = map.generateMapWallDescriptors();
+		MapWallGrid mapWallGrid(mapWallDescriptors, MapWallGrid::calculateCellSize(mapWallDescriptors));
+		MapWallBVH mapWallBVH(mapWallDescriptors);
+
+		// Cell (x, z) comes from pixel x * mapSize + z
+		std::vector<RayDescriptor> rays(rayQuantity);
+		for (unsigned int i = 0; i < rayQuantity; ++i)
+		{
+			int cell = freeCells[rand() % freeCells.size()];
+			float angle = getRandomFloat(0.0f, 2.0f * glm::pi<float>());
+
+			rays[i].position = glm::vec4(cell / mapSize + 0.5f, getRandomFloat(0.1f, 0.9f), cell % mapSize + 0.5f,
+				1.0f);
+			rays[i].direction = glm::normalize(glm::vec4(cosf(angle), getRandomFloat(-0.2f, 0.2f), sinf(angle), 0.0f));
+		}
+
+		unsigned int linearRayQuantity = glm::min(rayQuantity, benchmarkMaximumLinearRayQuantity);
+		std::vector<CollisionDescriptor> linearCollisions(rayQuantity);
+		std::vector<CollisionDescriptor> gridCollisions(rayQuantity);
+		std::vector<CollisionDescriptor> bvhCollisions(rayQuantity);
+		std::vector<CollisionDescriptor> batchCollisions(rayQuantity);
+
+		double linearRaysPerSecond = benchmarkShotQuery(rays, linearRayQuantity, mapWallDescriptors, 0,
+			linearCollisions);
+		double gridRaysPerSecond = benchmarkShotQuery(rays, rayQuantity, mapWallDescriptors, &mapWallGrid,
+			gridCollisions);
+		double bvhRaysPerSecond = benchmarkShotQuery(rays, rayQuantity, mapWallDescriptors, &mapWallBVH,
+			bvhCollisions);
+		double batchRaysPerSecond = benchmarkShotBatch(rays, mapWallBVH, workerPool, batchCollisions);
+
+		unsigned int mismatches = 0;
+		for (unsigned int i = 0; i < rayQuantity; ++i)
+			if (!isSameCollision(bvhCollisions[i], batchCollisions[i]) || (i < linearRayQuantity &&
+				(!isSameCollision(linearCollisions[i], gridCollisions[i]) ||
+				!isSameCollision(linearCollisions[i], bvhCollisions[i]))))
+				++mismatches;
+
+		std::cout << mapSize << "x" << mapSize << " | " << mapWallDescriptors.size() << " | " <<
+			(unsigned long long)linearRaysPerSecond << " | " << (unsigned long long)gridRaysPerSecond << " | " <<
+			(unsigned long long)bvhRaysPerSecond << " | " << (unsigned long long)batchRaysPerSecond << " | " <<
+			mismatches << std::endl;
+	}
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+namespace raw
+{
+	// Measures the shots per second of the wall queries on random square maps of increasing size.
+	// Used by the "-bench-shots" command line mode.
+	class ShotBenchmark
+	{
+	public:
+		static void run(unsigned int rayQuantity);
+	};
+}
@@ -0,0 +1,92 @@
+#include "ShotMarkBuffer.h"
+#include "Shader.h"
+#include "RenderStatistics.h"
+
+using namespace raw;
+
+// Create a shot mark buffer that holds at most capacity shot marks, all rendered with model.
+// The GPU buffer is created here, so this must be called from the GL thread.
+ShotMarkBuffer::ShotMarkBuffer(const Model* model, unsigned int capacity)
+{
+	this->model = model;
+	this->capacity = capacity;
+	this->instances.resize(capacity);
+	this->nextInstance = 0;
+	this->instanceQuantity = 0;
+	this->firstDirtyInstance = 0;
+	this->dirtyInstanceQuantity = 0;
+
+	glGenBuffers(1, &this->instanceBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, this->instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(MeshInstance), 0, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+ShotMarkBuffer::~ShotMarkBuffer()
+{
+	glDeleteBuffers(1, &this->instanceBuffer);
+}
+
+// Add a shot mark, replacing the oldest one if the buffer is full.
+// No GL call is made here, the new shot mark is uploaded in the next render().
+void ShotMarkBuffer::addShotMark(const glm::vec4& position, const glm::vec4& color)
+{
+	MeshInstance& instance = this->instances[this->nextInstance];
+	instance.modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(position));
+	instance.color = color;
+
+	if (this->dirtyInstanceQuantity == 0)
+		this->firstDirtyInstance = this->nextInstance;
+	if (this->dirtyInstanceQuantity < this->capacity)
+		++this->dirtyInstanceQuantity;
+	if (this->instanceQuantity < this->capacity)
+		++this->instanceQuantity;
+
+	this->nextInstance = (this->nextInstance + 1) % this->capacity;
+}
+
+// Upload the shot marks added since the last render and draw all of them with a single instanced draw.
+// The camera is read from the frame uniform block, like in Entity::render().
+void ShotMarkBuffer::render(const Shader& shader)
+{
+	if (this->dirtyInstanceQuantity == this->capacity)
+		this->uploadInstances(0, this->capacity);
+	else if (this->firstDirtyInstance + this->dirtyInstanceQuantity <= this->capacity)
+		this->uploadInstances(this->firstDirtyInstance, this->dirtyInstanceQuantity);
+	else
+	{
+		// The dirty range wraps around the end of the ring
+		unsigned int instancesBeforeEnd = this->capacity - this->firstDirtyInstance;
+		this->uploadInstances(this->firstDirtyInstance, instancesBeforeEnd);
+		this->uploadInstances(0, this->dirtyInstanceQuantity - instancesBeforeEnd);
+	}
+	this->dirtyInstanceQuantity = 0;
+
+	if (this->instanceQuantity == 0)
+		return;
+
+	shader.useProgram();
+	GLint useInstancingLocation = shader.getUniformLocation(ShaderUniform::USE_INSTANCING);
+	glUniform1i(useInstancingLocation, true);
+	this->model->renderInstanced(shader, false, this->instanceBuffer, 0, this->instanceQuantity);
+	glUniform1i(useInstancingLocation, false);
+	RenderStatistics::addGLCalls(2);
+}
+
+unsigned int ShotMarkBuffer::getShotMarkQuantity() const
+{
+	return this->instanceQuantity;
+}
+
+// Copy a range of instances to the same range of the GPU buffer.
+void ShotMarkBuffer::uploadInstances(unsigned int firstInstance, unsigned int instanceQuantity) const
+{
+	if (instanceQuantity == 0)
+		return;
+
+	glBindBuffer(GL_ARRAY_BUFFER, this->instanceBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, firstInstance * sizeof(MeshInstance), instanceQuantity * sizeof(MeshInstance),
+		&this->instances[firstInstance]);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	RenderStatistics::addGLCalls(3);
+}
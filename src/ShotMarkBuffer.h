@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Model.h"
+#include <vector>
+
+namespace raw
+{
+	// Fixed-capacity ring buffer of shot marks. Each shot mark is an instance of the same model, kept in a
+	// preallocated array and mirrored in a vertex buffer of the same capacity. When the buffer is full, the oldest
+	// shot mark is overwritten. Adding a shot mark does not allocate and only the new marks are uploaded.
+	class ShotMarkBuffer
+	{
+	public:
+		ShotMarkBuffer(const Model* model, unsigned int capacity);
+		~ShotMarkBuffer();
+		void addShotMark(const glm::vec4& position, const glm::vec4& color);
+		void render(const Shader& shader);
+		unsigned int getShotMarkQuantity() const;
+	private:
+		void uploadInstances(unsigned int firstInstance, unsigned int instanceQuantity) const;
+		const Model* model;
+		std::vector<MeshInstance> instances;
+		unsigned int capacity;
+		unsigned int nextInstance;
+		unsigned int instanceQuantity;
+		unsigned int firstDirtyInstance;
+		unsigned int dirtyInstanceQuantity;
+		GLuint instanceBuffer;
+	};
+}
@@ -1,6 +1,7 @@
 #include "Skybox.h"
 #include "Model.h"
 #include "StaticModels.h"
+#include "RenderStatistics.h"
 
 using namespace raw;
 
@@ -51,8 +52,9 @@ void Skybox::render(const Shader& shader, const Camera& camera) const
 	else
 		this->skyboxDayTexture->bind(GL_TEXTURE0);
 
-	GLuint cubeMapLocation = glGetUniformLocation(shader.getProgram(), "cubeMap");
+	GLint cubeMapLocation = shader.getUniformLocation(ShaderUniform::CUBE_MAP);
 	glUniform1i(cubeMapLocation, 0);
+	RenderStatistics::addGLCalls(1);
 
 	this->cube->render(shader, camera);
 }
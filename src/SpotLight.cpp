@@ -68,43 +68,18 @@ float SpotLight::getOuterCutOffAngle() const
 	return this->outerCutOffAngle;
 }
 
-// Send all information about the light to the shader, so it can be used when rendering.
-void SpotLight::updateUniforms(const Shader& shader, unsigned int arrayPosition) const
-{
-	Light::updateUniforms(shader, arrayPosition);
-
-	char locationBuffer[1024];
-
-	glm::vec4 lightPosition = this->getPosition();
-	float lightConstantTerm = this->attenuation.constantTerm;
-	float lightLinearTerm = this->attenuation.linearTerm;
-	float lightQuadraticTerm = this->attenuation.quadraticTerm;
-	glm::vec4 spotLightDirection = this->direction;
-	float spotLightInnerCutOffAngleCos = cosf(this->innerCutOffAngle);
-	float spotLightOuterCutOffAngleCos = cosf(this->outerCutOffAngle);
-
-	this->getShaderLocationString("position", locationBuffer, arrayPosition);
-	GLuint lightPositionLocation = glGetUniformLocation(shader.getProgram(), locationBuffer);
-	this->getShaderLocationString("constantTerm", locationBuffer, arrayPosition);
-	GLuint lightConstantTermLocation = glGetUniformLocation(shader.getProgram(), locationBuffer);
-	this->getShaderLocationString("linearTerm", locationBuffer, arrayPosition);
-	GLuint lightLinearTermLocation = glGetUniformLocation(shader.getProgram(), locationBuffer);
-	this->getShaderLocationString("quadraticTerm", locationBuffer, arrayPosition);
-	GLuint lightQuadraticTermLocation = glGetUniformLocation(shader.getProgram(), locationBuffer);
-	this->getShaderLocationString("direction", locationBuffer, arrayPosition);
-	GLuint spotLightDirectionLocation = glGetUniformLocation(shader.getProgram(), locationBuffer);
-	this->getShaderLocationString("innerCutOffAngleCos", locationBuffer, arrayPosition);
-	GLuint spotLightInnerCutOffAngleCosTermLocation = glGetUniformLocation(shader.getProgram(), locationBuffer);
-	this->getShaderLocationString("outerCutOffAngleCos", locationBuffer, arrayPosition);
-	GLuint spotLightOuterCutOffAngleCosTermLocation = glGetUniformLocation(shader.getProgram(), locationBuffer);
-
-	glUniform4f(lightPositionLocation, lightPosition.x, lightPosition.y, lightPosition.z, lightPosition.w);
-	glUniform1f(lightConstantTermLocation, lightConstantTerm);
-	glUniform1f(lightLinearTermLocation, lightLinearTerm);
-	glUniform1f(lightQuadraticTermLocation, lightQuadraticTerm);
-	glUniform4f(spotLightDirectionLocation, spotLightDirection.x, spotLightDirection.y, spotLightDirection.z, spotLightDirection.w);
-	glUniform1f(spotLightInnerCutOffAngleCosTermLocation, spotLightInnerCutOffAngleCos);
-	glUniform1f(spotLightOuterCutOffAngleCosTermLocation, spotLightOuterCutOffAngleCos);
+// Fill the light descriptor that is sent to the shaders.
+void SpotLight::fillShaderDescriptor(LightShaderDescriptor& descriptor) const
+{
+	Light::fillShaderDescriptor(descriptor);
+
+	descriptor.position = this->getPosition();
+	descriptor.constantTerm = this->attenuation.constantTerm;
+	descriptor.linearTerm = this->attenuation.linearTerm;
+	descriptor.quadraticTerm = this->attenuation.quadraticTerm;
+	descriptor.direction = this->direction;
+	descriptor.innerCutOffAngleCos = cosf(this->innerCutOffAngle);
+	descriptor.outerCutOffAngleCos = cosf(this->outerCutOffAngle);
 }
 
 LightType SpotLight::getType() const
@@ -112,6 +87,19 @@ LightType SpotLight::getType() const
 	return LT_SPOTLIGHT;
 }
 
+// Get the distance beyond which the attenuated light is negligible. The cone is ignored, so the radius bounds
+// the whole sphere around the light. The shaders scale spot lights by an intensity of 10.
+float SpotLight::getInfluenceRadius() const
+{
+	return this->calculateInfluenceRadius(this->attenuation, 10.0f);
+}
+
+// Get the attenuated intensity of the light on the closest point of the box. The cone is ignored.
+float SpotLight::getIntensityOnBox(const glm::vec3& center, const glm::vec3& extent) const
+{
+	return this->calculateIntensityOnBox(this->attenuation, 10.0f, this->position, center, extent);
+}
+
 /* StreetSpotLight methods */
 
 StreetSpotLight::StreetSpotLight(glm::vec4 position, glm::vec4 ambientColor, glm::vec4 diffuseColor, glm::vec4 specularColor) :
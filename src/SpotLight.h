@@ -22,8 +22,10 @@ namespace raw
 		float getInnerCutOffAngle() const;
 		void setOuterCutOffAngle(float cutOffAngle);
 		float getOuterCutOffAngle() const;
-		virtual void updateUniforms(const Shader& shader, unsigned int arrayPosition) const;
+		virtual void fillShaderDescriptor(LightShaderDescriptor& descriptor) const;
 		virtual LightType getType() const;
+		virtual float getInfluenceRadius() const;
+		virtual float getIntensityOnBox(const glm::vec3& center, const glm::vec3& extent) const;
 	private:
 		glm::vec4 position;
 		LightAttenuation attenuation;
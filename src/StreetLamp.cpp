@@ -1,5 +1,7 @@
 #include "StreetLamp.h"
 #include "Model.h"
+#include "InstancedRenderer.h"
+#include "RenderStatistics.h"
 
 using namespace raw;
 
@@ -21,16 +23,36 @@ StreetLamp::~StreetLamp()
 	delete this->bulbEntity;
 }
 
-void StreetLamp::render(const Shader& shaderForBase, const Shader& shaderForBulb, const Camera& camera,
-	const std::vector<Light*>& lights, bool useNormalMap) const
+// Queue the base of the lamp in the instanced renderer. All lamps share the same base model.
+// Bases outside of the camera frustum are not queued.
+void StreetLamp::addBaseInstance(InstancedRenderer& instancedRenderer, const Camera& camera) const
 {
-	glm::vec4 bulbColor = this->isOn() ? glm::vec4(1.0f, 1.0f, 1.0f, 1.0f) : glm::vec4(0.1f, 0.1f, 0.1f, 0.1f);
-	this->baseEntity->render(shaderForBase, camera, lights, useNormalMap);
+	if (!this->baseEntity->isInsideFrustum(camera))
+	{
+		RenderStatistics::addCulledObjects(1);
+		return;
+	}
+	RenderStatistics::addDrawnObjects(1);
+
+	instancedRenderer.addInstance(this->baseEntity->getModel(), this->baseEntity->getTransform().getModelMatrix(),
+		glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
+}
 
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glEnable(GL_BLEND);
-	this->bulbEntity->render(shaderForBulb, camera, bulbColor);
-	glDisable(GL_BLEND);
+// Queue the bulb of the lamp in the instanced renderer, with a color that depends on the lamp being on.
+// Bulbs are translucent, so they must be rendered with blending enabled. Bulbs outside of the camera frustum
+// are not queued.
+void StreetLamp::addBulbInstance(InstancedRenderer& instancedRenderer, const Camera& camera) const
+{
+	if (!this->bulbEntity->isInsideFrustum(camera))
+	{
+		RenderStatistics::addCulledObjects(1);
+		return;
+	}
+	RenderStatistics::addDrawnObjects(1);
+
+	glm::vec4 bulbColor = this->isOn() ? glm::vec4(1.0f, 1.0f, 1.0f, 1.0f) : glm::vec4(0.1f, 0.1f, 0.1f, 0.1f);
+	instancedRenderer.addInstance(this->bulbEntity->getModel(), this->bulbEntity->getTransform().getModelMatrix(),
+		bulbColor);
 }
 
 Entity* StreetLamp::getBaseEntity()
@@ -87,7 +109,8 @@ Model* StreetLamp::getBaseModel()
 		StreetLamp::baseModel = new Model(".\\res\\art\\base_lamp.obj");
 		StreetLamp::baseModel->setDiffuseMapOfAllMeshes(Texture::load(".\\res\\art\\metal_diffuse.jpg"));
 		StreetLamp::baseModel->setSpecularMapOfAllMeshes(Texture::load(".\\res\\art\\meta_specular.jpg"));
-		StreetLamp::baseModel->setNormalMapOfAllMeshes(Texture::load(".\\res\\art\\metal_normal.jpg"));
+		StreetLamp::baseModel->setNormalMapOfAllMeshes(Texture::load(".\\res\\art\\metal_normal.jpg",
+			TextureType::NORMAL_MAP));
 	}
 
 	return StreetLamp::baseModel;
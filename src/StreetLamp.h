@@ -4,13 +4,15 @@
 
 namespace raw
 {
+	class InstancedRenderer;
+
 	class StreetLamp : public PointLight
 	{
 	public:
 		StreetLamp(glm::vec4 position, glm::vec4 ambientColor, glm::vec4 diffuseColor, glm::vec4 specularColor);
 		~StreetLamp();
-		void render(const Shader& shaderForBase, const Shader& shaderForBulb, const Camera& camera,
-			const std::vector<Light*>& lights, bool useNormalMap) const;
+		void addBaseInstance(InstancedRenderer& instancedRenderer, const Camera& camera) const;
+		void addBulbInstance(InstancedRenderer& instancedRenderer, const Camera& camera) const;
 		Entity* getBaseEntity();
 		Entity* getBulbEntity();
 		glm::vec4 getWorldPosition() const;
@@ -1,23 +1,74 @@
 #include "Texture.h"
+#include "RenderStatistics.h"
+#include "ResourcePack.h"
+#include "TextureCache.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 #include <cstdlib>
+#include <iostream>
 
 using namespace raw;
 
 std::vector<Texture*> Texture::loadedTextures;
 
+// Decode an image, read from the resource pack or from the image file. Returns null if the image can't be read.
+static unsigned char* loadImage(const char* imagePath, int* imageWidth, int* imageHeight, int* imageChannels)
+{
+	Resource imageResource(imagePath);
+
+	if (!imageResource.isLoaded())
+		return 0;
+
+	return stbi_load_from_memory(imageResource.getData(), imageResource.getSize(), imageWidth, imageHeight,
+		imageChannels, 4);
+}
+
+// OpenGL format of each block compression.
+static GLenum getCompressedFormat(TextureCompression compression)
+{
+	switch (compression)
+	{
+	case TextureCompression::BC1:
+		return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case TextureCompression::BC3:
+		return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	default:
+		return GL_COMPRESSED_RG_RGTC2;
+	}
+}
+
 // Create a new texture, loading the image stored in texturePath.
-Texture::Texture(const char* texturePath)
+// The texture is uploaded block compressed, with the mip levels of its baked texture. If the image was not baked
+// yet, it is baked now.
+Texture::Texture(const char* texturePath, TextureType type)
 {
-	stbi_set_flip_vertically_on_load(1);
-	int imageWidth, imageHeight, imageChannels;
-	unsigned char* imageData = stbi_load(texturePath, &imageWidth, &imageHeight, &imageChannels, 4);
+	CompressedTexture compressedTexture;
+	bool loaded = TextureCache::load(texturePath, type, compressedTexture) ||
+		TextureCache::bake(texturePath, type, compressedTexture);
 
 	glGenTextures(1, &this->textureId);
 	glBindTexture(GL_TEXTURE_2D, this->textureId);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, imageWidth, imageHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, imageData);
-	glGenerateMipmap(GL_TEXTURE_2D);
+
+	if (loaded)
+	{
+		GLenum format = getCompressedFormat(compressedTexture.compression);
+		unsigned int levelWidth = compressedTexture.width;
+		unsigned int levelHeight = compressedTexture.height;
+		unsigned int levelOffset = 0;
+
+		for (unsigned int i = 0; i < compressedTexture.levelSizes.size(); ++i)
+		{
+			glCompressedTexImage2D(GL_TEXTURE_2D, i, format, levelWidth, levelHeight, 0, compressedTexture.levelSizes[i],
+				&compressedTexture.data[levelOffset]);
+			levelOffset += compressedTexture.levelSizes[i];
+			levelWidth = (levelWidth > 1) ? levelWidth / 2 : 1;
+			levelHeight = (levelHeight > 1) ? levelHeight / 2 : 1;
+		}
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, compressedTexture.levelSizes.size() - 1);
+	}
+	else
+		std::cout << "Error loading texture " << texturePath << std::endl;
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -32,8 +83,6 @@ Texture::Texture(const char* texturePath)
 
 	glBindTexture(GL_TEXTURE_2D, 0);
 
-	stbi_image_free(imageData);
-
 	this->path = (char*)malloc((strlen(texturePath) + 1) * sizeof(char));
 	strcpy(this->path, texturePath);
 	this->references = 0;
@@ -41,6 +90,7 @@ Texture::Texture(const char* texturePath)
 
 Texture::~Texture()
 {
+	glDeleteTextures(1, &this->textureId);
 	free(this->path);
 }
 
@@ -49,6 +99,8 @@ void Texture::bind(GLenum slot) const
 {
 	glActiveTexture(slot);
 	glBindTexture(GL_TEXTURE_2D, this->textureId);
+	RenderStatistics::addGLCalls(2);
+	RenderStatistics::addTextureBinds(1);
 }
 
 // Unbind the texture.
@@ -63,6 +115,11 @@ const char* Texture::getPath() const
 	return this->path;
 }
 
+GLuint Texture::getTextureId() const
+{
+	return this->textureId;
+}
+
 void Texture::increaseReferences()
 {
 	++this->references;
@@ -74,12 +131,18 @@ void Texture::decreaseReferences()
 }
 
 Texture* Texture::load(const char* texturePath)
+{
+	return Texture::load(texturePath, TextureType::COLOR);
+}
+
+// Load a texture, or return it if it was already loaded. The type is only used on the first load.
+Texture* Texture::load(const char* texturePath, TextureType type)
 {
 	for (unsigned int i = 0; i < Texture::loadedTextures.size(); ++i)
 		if (strcmp(Texture::loadedTextures[i]->getPath(), texturePath) == 0)
 			return loadedTextures[i];
 
-	Texture* newTexture = new Texture(texturePath);
+	Texture* newTexture = new Texture(texturePath, type);
 	Texture::loadedTextures.push_back(newTexture);
 
 	return newTexture;
@@ -114,37 +177,37 @@ CubeMapTexture::CubeMapTexture(const CubeMapTexturePath& texturePaths)
 	glBindTexture(GL_TEXTURE_CUBE_MAP, this->textureId);
 
 	// Right
-	unsigned char* imageData = stbi_load(texturePaths.right, &imageWidth, &imageHeight, &imageChannels, 4);
+	unsigned char* imageData = loadImage(texturePaths.right, &imageWidth, &imageHeight, &imageChannels);
 	glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, GL_RGBA8, imageWidth, imageHeight, 0, GL_RGBA,
 		GL_UNSIGNED_BYTE, imageData);
 	stbi_image_free(imageData);
 
 	// Left
-	imageData = stbi_load(texturePaths.left, &imageWidth, &imageHeight, &imageChannels, 4);
+	imageData = loadImage(texturePaths.left, &imageWidth, &imageHeight, &imageChannels);
 	glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_X, 0, GL_RGBA8, imageWidth, imageHeight, 0, GL_RGBA,
 		GL_UNSIGNED_BYTE, imageData);
 	stbi_image_free(imageData);
 
 	// Top
-	imageData = stbi_load(texturePaths.top, &imageWidth, &imageHeight, &imageChannels, 4);
+	imageData = loadImage(texturePaths.top, &imageWidth, &imageHeight, &imageChannels);
 	glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_Y, 0, GL_RGBA8, imageWidth, imageHeight, 0, GL_RGBA,
 		GL_UNSIGNED_BYTE, imageData);
 	stbi_image_free(imageData);
 
 	// Bottom
-	imageData = stbi_load(texturePaths.bottom, &imageWidth, &imageHeight, &imageChannels, 4);
+	imageData = loadImage(texturePaths.bottom, &imageWidth, &imageHeight, &imageChannels);
 	glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_Y, 0, GL_RGBA8, imageWidth, imageHeight, 0, GL_RGBA,
 		GL_UNSIGNED_BYTE, imageData);
 	stbi_image_free(imageData);
 
 	// Back
-	imageData = stbi_load(texturePaths.back, &imageWidth, &imageHeight, &imageChannels, 4);
+	imageData = loadImage(texturePaths.back, &imageWidth, &imageHeight, &imageChannels);
 	glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_Z, 0, GL_RGBA8, imageWidth, imageHeight, 0, GL_RGBA,
 		GL_UNSIGNED_BYTE, imageData);
 	stbi_image_free(imageData);
 
 	// Front
-	imageData = stbi_load(texturePaths.front, &imageWidth, &imageHeight, &imageChannels, 4);
+	imageData = loadImage(texturePaths.front, &imageWidth, &imageHeight, &imageChannels);
 	glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_Z, 0, GL_RGBA8, imageWidth, imageHeight, 0, GL_RGBA,
 		GL_UNSIGNED_BYTE, imageData);
 	stbi_image_free(imageData);
@@ -170,6 +233,8 @@ void CubeMapTexture::bind(GLenum slot) const
 {
 	glActiveTexture(slot);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, this->textureId);
+	RenderStatistics::addGLCalls(2);
+	RenderStatistics::addTextureBinds(1);
 }
 
 // Unbind the texture.
@@ -5,19 +5,28 @@
 
 namespace raw
 {
+	// Kind of image of a texture. Normal maps are compressed differently from color images.
+	enum class TextureType
+	{
+		COLOR,
+		NORMAL_MAP
+	};
+
 	class Texture
 	{
 	public:
 		void bind(GLenum slot) const;
 		void unbind(GLenum slot) const;
 		const char* getPath() const;
+		GLuint getTextureId() const;
 		void increaseReferences();
 		void decreaseReferences();
 		static Texture* load(const char* texturePath);
+		static Texture* load(const char* texturePath, TextureType type);
 		static void destroy(const Texture* texture);
 		static void destroyAll();
 	private:
-		Texture(const char* texturePath);
+		Texture(const char* texturePath, TextureType type);
 		~Texture();
 		GLuint textureId;
 		char* path;
@@ -0,0 +1,209 @@
+#include "TextureCache.h"
+#include "ResourcePack.h"
+#include "stb_image.h"
+#include <fstream>
+#include <iostream>
+#include <cstring>
+
+using namespace raw;
+
+// Version of the baked texture format. Must be increased whenever the compression done by TextureCompressor
+// changes, so old baked textures are baked again.
+static const unsigned int bakedTextureVersion = 1;
+static const char bakedTextureMagic[4] = { 'R', 'A', 'W', 'T' };
+static const char bakedTextureExtension[] = ".dds";
+
+static const char ddsMagic[4] = { 'D', 'D', 'S', ' ' };
+static const char ddsFourCCBC1[4] = { 'D', 'X', 'T', '1' };
+static const char ddsFourCCBC3[4] = { 'D', 'X', 'T', '5' };
+static const char ddsFourCCBC5[4] = { 'A', 'T', 'I', '2' };
+static const unsigned int ddsHeaderSize = 124;
+static const unsigned int ddsPixelFormatSize = 32;
+static const unsigned int ddsFlags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;	// caps, size, format, mips
+static const unsigned int ddsPixelFormatFourCC = 0x4;
+static const unsigned int ddsCaps = 0x8 | 0x1000 | 0x400000;	// complex, texture, mipmap
+
+#pragma pack(push, 1)
+struct DDSPixelFormat
+{
+	unsigned int size;
+	unsigned int flags;
+	char fourCC[4];
+	unsigned int rgbBitCount;
+	unsigned int redBitMask;
+	unsigned int greenBitMask;
+	unsigned int blueBitMask;
+	unsigned int alphaBitMask;
+};
+
+// DDS header. The first reserved fields identify the baker and the image the texture was baked from.
+// Followed by the mip levels, from the largest to 1x1
+struct DDSHeader
+{
+	char magic[4];
+	unsigned int size;
+	unsigned int flags;
+	unsigned int height;
+	unsigned int width;
+	unsigned int pitchOrLinearSize;
+	unsigned int depth;
+	unsigned int mipMapCount;
+	char bakedTextureMagic[4];
+	unsigned int bakedTextureVersion;
+	long long modificationTime;
+	unsigned int reserved1[7];
+	DDSPixelFormat pixelFormat;
+	unsigned int caps;
+	unsigned int caps2;
+	unsigned int caps3;
+	unsigned int caps4;
+	unsigned int reserved2;
+};
+#pragma pack(pop)
+
+// Load the baked texture of the image, from the resource pack or from the disk.
+// Returns false if there is no valid baked texture for the type, in which case the texture must be baked.
+bool TextureCache::load(const char* texturePath, TextureType type, CompressedTexture& compressedTexture)
+{
+	Resource bakedResource(TextureCache::getBakedPath(texturePath).c_str());
+
+	if (!bakedResource.isLoaded() || bakedResource.getSize() < sizeof(DDSHeader))
+		return false;
+
+	const DDSHeader* header = (const DDSHeader*)bakedResource.getData();
+	long long modificationTime = Resource::getModificationTime(texturePath);
+
+	if (memcmp(header->magic, ddsMagic, sizeof(ddsMagic)) != 0 || header->size != ddsHeaderSize ||
+		memcmp(header->bakedTextureMagic, bakedTextureMagic, sizeof(bakedTextureMagic)) != 0 ||
+		header->bakedTextureVersion != bakedTextureVersion || header->width == 0 || header->height == 0)
+		return false;
+
+	// The image is not on the disk when only the resource pack is shipped
+	if (modificationTime != 0 && header->modificationTime != modificationTime)
+		return false;
+
+	if (type == TextureType::NORMAL_MAP && !memcmp(header->pixelFormat.fourCC, ddsFourCCBC5, 4))
+		compressedTexture.compression = TextureCompression::BC5;
+	else if (type == TextureType::COLOR && !memcmp(header->pixelFormat.fourCC, ddsFourCCBC1, 4))
+		compressedTexture.compression = TextureCompression::BC1;
+	else if (type == TextureType::COLOR && !memcmp(header->pixelFormat.fourCC, ddsFourCCBC3, 4))
+		compressedTexture.compression = TextureCompression::BC3;
+	else
+		return false;
+
+	compressedTexture.width = header->width;
+	compressedTexture.height = header->height;
+	compressedTexture.levelSizes.clear();
+
+	// The mip levels must go down to 1x1 and fill the rest of the file
+	unsigned long long dataSize = 0;
+	unsigned int levelWidth = header->width;
+	unsigned int levelHeight = header->height;
+	while (true)
+	{
+		unsigned int levelSize = TextureCompressor::getLevelSize(compressedTexture.compression, levelWidth,
+			levelHeight);
+		compressedTexture.levelSizes.push_back(levelSize);
+		dataSize += levelSize;
+
+		if (levelWidth == 1 && levelHeight == 1)
+			break;
+
+		levelWidth = (levelWidth > 1) ? levelWidth / 2 : 1;
+		levelHeight = (levelHeight > 1) ? levelHeight / 2 : 1;
+	}
+
+	if (header->mipMapCount != compressedTexture.levelSizes.size() ||
+		dataSize != bakedResource.getSize() - sizeof(DDSHeader))
+		return false;
+
+	const unsigned char* data = bakedResource.getData() + sizeof(DDSHeader);
+	compressedTexture.data.assign(data, data + dataSize);
+	return true;
+}
+
+// Bake the image: decode it, compress it with all of its mip levels and save the baked texture.
+// Returns false if the image could not be read.
+bool TextureCache::bake(const char* texturePath, TextureType type, CompressedTexture& compressedTexture)
+{
+	Resource imageResource(texturePath);
+
+	if (!imageResource.isLoaded())
+		return false;
+
+	int imageWidth, imageHeight, imageChannels;
+	stbi_set_flip_vertically_on_load(1);
+	unsigned char* imageData = stbi_load_from_memory(imageResource.getData(), imageResource.getSize(), &imageWidth,
+		&imageHeight, &imageChannels, 4);
+
+	if (imageData == 0)
+	{
+		std::cout << "Error baking texture " << texturePath << ": " << stbi_failure_reason() << std::endl;
+		return false;
+	}
+
+	TextureCompressor::compress(imageData, imageWidth, imageHeight, type == TextureType::NORMAL_MAP,
+		compressedTexture);
+	stbi_image_free(imageData);
+
+	TextureCache::save(texturePath, compressedTexture);
+	return true;
+}
+
+void TextureCache::save(const char* texturePath, const CompressedTexture& compressedTexture)
+{
+	long long modificationTime = Resource::getModificationTime(texturePath);
+
+	// Images read from the resource pack have no image file to bake next to
+	if (modificationTime == 0)
+		return;
+
+	std::string bakedPath = TextureCache::getBakedPath(texturePath);
+	std::ofstream bakedStream(bakedPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+	if (!bakedStream)
+	{
+		std::cout << "Error baking texture " << texturePath << ": could not open " << bakedPath << std::endl;
+		return;
+	}
+
+	DDSHeader header;
+	memset(&header, 0, sizeof(DDSHeader));
+	memcpy(header.magic, ddsMagic, sizeof(ddsMagic));
+	header.size = ddsHeaderSize;
+	header.flags = ddsFlags;
+	header.height = compressedTexture.height;
+	header.width = compressedTexture.width;
+	header.pitchOrLinearSize = compressedTexture.levelSizes[0];
+	header.mipMapCount = compressedTexture.levelSizes.size();
+	memcpy(header.bakedTextureMagic, bakedTextureMagic, sizeof(bakedTextureMagic));
+	header.bakedTextureVersion = bakedTextureVersion;
+	header.modificationTime = modificationTime;
+	header.pixelFormat.size = ddsPixelFormatSize;
+	header.pixelFormat.flags = ddsPixelFormatFourCC;
+	header.caps = ddsCaps;
+
+	switch (compressedTexture.compression)
+	{
+	case TextureCompression::BC1:
+		memcpy(header.pixelFormat.fourCC, ddsFourCCBC1, 4);
+		break;
+	case TextureCompression::BC3:
+		memcpy(header.pixelFormat.fourCC, ddsFourCCBC3, 4);
+		break;
+	case TextureCompression::BC5:
+		memcpy(header.pixelFormat.fourCC, ddsFourCCBC5, 4);
+		break;
+	}
+
+	bakedStream.write((const char*)&header, sizeof(DDSHeader));
+	bakedStream.write((const char*)&compressedTexture.data[0], compressedTexture.data.size());
+
+	if (!bakedStream)
+		std::cout << "Error baking texture " << texturePath << ": could not write " << bakedPath << std::endl;
+}
+
+std::string TextureCache::getBakedPath(const char* texturePath)
+{
+	return std::string(texturePath) + bakedTextureExtension;
+}
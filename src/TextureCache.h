@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Texture.h"
+#include "TextureCompressor.h"
+#include <string>
+
+namespace raw
+{
+	// Cache of the textures compressed by TextureCompressor, so images are only decoded and compressed once.
+	// The baked texture is a DDS file (DXT1, DXT5 or ATI2) written next to the image, with the ".dds" extension, with
+	// all mip levels. Its rows are stored bottom to top, as OpenGL expects them, so it is uploaded without flipping.
+	// A baked texture is ignored if it was written by another version of the baker or if the image was modified after
+	// it was baked. Baked textures read from the resource pack are used even if the image is not there.
+	// Textures are baked on their first load, or offline by running the engine with "-bake-texture <image path>" or
+	// "-bake-normal-map <image path>".
+	class TextureCache
+	{
+	public:
+		static bool load(const char* texturePath, TextureType type, CompressedTexture& compressedTexture);
+		static bool bake(const char* texturePath, TextureType type, CompressedTexture& compressedTexture);
+	private:
+		static void save(const char* texturePath, const CompressedTexture& compressedTexture);
+		static std::string getBakedPath(const char* texturePath);
+	};
+}
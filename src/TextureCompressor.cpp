@@ -0,0 +1,379 @@
+#include "TextureCompressor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+using namespace raw;
+
+// Iterations used to find the principal axis of the colors of a block.
+static const unsigned int powerIterationQuantity = 8;
+
+static unsigned short packColor565(const float* color)
+{
+	int red = (int)(color[0] * 31.0f / 255.0f + 0.5f);
+	int green = (int)(color[1] * 63.0f / 255.0f + 0.5f);
+	int blue = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+
+	red = std::min(std::max(red, 0), 31);
+	green = std::min(std::max(green, 0), 63);
+	blue = std::min(std::max(blue, 0), 31);
+
+	return (unsigned short)((red << 11) | (green << 5) | blue);
+}
+
+static void unpackColor565(unsigned short packedColor, int* color)
+{
+	int red = (packedColor >> 11) & 31;
+	int green = (packedColor >> 5) & 63;
+	int blue = packedColor & 31;
+
+	color[0] = (red << 3) | (red >> 2);
+	color[1] = (green << 2) | (green >> 4);
+	color[2] = (blue << 3) | (blue >> 2);
+}
+
+// Choose the nearest of the 4 colors of the BC1 palette for each pixel of the block. Returns the squared error.
+static unsigned int getBC1Indices(const unsigned char* block, unsigned short color0, unsigned short color1,
+	unsigned int& indices)
+{
+	int palette[4][3];
+	unpackColor565(color0, palette[0]);
+	unpackColor565(color1, palette[1]);
+
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		palette[2][i] = (2 * palette[0][i] + palette[1][i]) / 3;
+		palette[3][i] = (palette[0][i] + 2 * palette[1][i]) / 3;
+	}
+
+	unsigned int error = 0;
+	indices = 0;
+
+	for (unsigned int i = 0; i < 16; ++i)
+	{
+		unsigned int bestIndex = 0;
+		unsigned int bestDistance = 0xFFFFFFFF;
+
+		for (unsigned int j = 0; j < 4; ++j)
+		{
+			int red = block[4 * i] - palette[j][0];
+			int green = block[4 * i + 1] - palette[j][1];
+			int blue = block[4 * i + 2] - palette[j][2];
+			unsigned int distance = red * red + green * green + blue * blue;
+
+			if (distance < bestDistance)
+			{
+				bestDistance = distance;
+				bestIndex = j;
+			}
+		}
+
+		indices |= bestIndex << (2 * i);
+		error += bestDistance;
+	}
+
+	return error;
+}
+
+// Compress the image, generating and compressing all of its mip levels.
+void TextureCompressor::compress(const unsigned char* image, unsigned int width, unsigned int height, bool normalMap,
+	CompressedTexture& compressedTexture)
+{
+	TextureCompression compression = TextureCompression::BC1;
+
+	if (normalMap)
+		compression = TextureCompression::BC5;
+	else
+	{
+		for (unsigned int i = 0; i < width * height; ++i)
+			if (image[4 * i + 3] != 255)
+			{
+				compression = TextureCompression::BC3;
+				break;
+			}
+	}
+
+	compressedTexture.compression = compression;
+	compressedTexture.width = width;
+	compressedTexture.height = height;
+	compressedTexture.levelSizes.clear();
+	compressedTexture.data.clear();
+
+	std::vector<unsigned char> level(image, image + width * height * 4);
+	std::vector<unsigned char> nextLevel;
+	unsigned int levelWidth = width;
+	unsigned int levelHeight = height;
+
+	while (true)
+	{
+		unsigned int levelSize = TextureCompressor::getLevelSize(compression, levelWidth, levelHeight);
+		unsigned int levelOffset = compressedTexture.data.size();
+		compressedTexture.levelSizes.push_back(levelSize);
+		compressedTexture.data.resize(levelOffset + levelSize);
+		TextureCompressor::compressLevel(&level[0], levelWidth, levelHeight, compression,
+			&compressedTexture.data[levelOffset]);
+
+		if (levelWidth == 1 && levelHeight == 1)
+			break;
+
+		TextureCompressor::generateMipLevel(&level[0], levelWidth, levelHeight, normalMap, nextLevel);
+		level.swap(nextLevel);
+		levelWidth = std::max(levelWidth / 2, 1u);
+		levelHeight = std::max(levelHeight / 2, 1u);
+	}
+}
+
+// Size in bytes of a compressed mip level. Each block of 4x4 pixels takes 8 bytes in BC1 and 16 bytes in BC3/BC5.
+unsigned int TextureCompressor::getLevelSize(TextureCompression compression, unsigned int width, unsigned int height)
+{
+	unsigned int blockSize = (compression == TextureCompression::BC1) ? 8 : 16;
+	return ((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+}
+
+// Compress a mip level, block by block. Blocks crossing the border of the image repeat its last row and column.
+void TextureCompressor::compressLevel(const unsigned char* image, unsigned int width, unsigned int height,
+	TextureCompression compression, unsigned char* destination)
+{
+	unsigned char block[64];
+
+	for (unsigned int blockY = 0; blockY < height; blockY += 4)
+		for (unsigned int blockX = 0; blockX < width; blockX += 4)
+		{
+			for (unsigned int y = 0; y < 4; ++y)
+				for (unsigned int x = 0; x < 4; ++x)
+				{
+					unsigned int imageX = std::min(blockX + x, width - 1);
+					unsigned int imageY = std::min(blockY + y, height - 1);
+					const unsigned char* pixel = image + 4 * (imageY * width + imageX);
+					std::copy(pixel, pixel + 4, block + 4 * (4 * y + x));
+				}
+
+			switch (compression)
+			{
+			case TextureCompression::BC1:
+				TextureCompressor::compressBlockBC1(block, destination);
+				destination += 8;
+				break;
+			case TextureCompression::BC3:
+				TextureCompressor::compressBlockBC4(block, 3, destination);
+				TextureCompressor::compressBlockBC1(block, destination + 8);
+				destination += 16;
+				break;
+			case TextureCompression::BC5:
+				TextureCompressor::compressBlockBC4(block, 0, destination);
+				TextureCompressor::compressBlockBC4(block, 1, destination + 8);
+				destination += 16;
+				break;
+			}
+		}
+}
+
+// Generate the next mip level with a box filter. Normal maps are renormalized after filtering.
+void TextureCompressor::generateMipLevel(const unsigned char* image, unsigned int width, unsigned int height,
+	bool normalMap, std::vector<unsigned char>& mipLevel)
+{
+	unsigned int mipWidth = std::max(width / 2, 1u);
+	unsigned int mipHeight = std::max(height / 2, 1u);
+	mipLevel.resize(mipWidth * mipHeight * 4);
+
+	for (unsigned int y = 0; y < mipHeight; ++y)
+		for (unsigned int x = 0; x < mipWidth; ++x)
+		{
+			unsigned int x0 = std::min(2 * x, width - 1);
+			unsigned int x1 = std::min(2 * x + 1, width - 1);
+			unsigned int y0 = std::min(2 * y, height - 1);
+			unsigned int y1 = std::min(2 * y + 1, height - 1);
+			const unsigned char* pixels[4] = {
+				image + 4 * (y0 * width + x0),
+				image + 4 * (y0 * width + x1),
+				image + 4 * (y1 * width + x0),
+				image + 4 * (y1 * width + x1)
+			};
+			unsigned char* mipPixel = &mipLevel[4 * (y * mipWidth + x)];
+
+			if (normalMap)
+			{
+				float normal[3] = { 0.0f, 0.0f, 0.0f };
+				for (unsigned int i = 0; i < 4; ++i)
+					for (unsigned int j = 0; j < 3; ++j)
+						normal[j] += pixels[i][j] / 255.0f * 2.0f - 1.0f;
+
+				float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+				if (length > 0.0f)
+					for (unsigned int j = 0; j < 3; ++j)
+						normal[j] /= length;
+
+				for (unsigned int j = 0; j < 3; ++j)
+					mipPixel[j] = (unsigned char)((normal[j] * 0.5f + 0.5f) * 255.0f + 0.5f);
+				mipPixel[3] = (unsigned char)((pixels[0][3] + pixels[1][3] + pixels[2][3] + pixels[3][3] + 2) / 4);
+			}
+			else
+				for (unsigned int j = 0; j < 4; ++j)
+					mipPixel[j] = (unsigned char)((pixels[0][j] + pixels[1][j] + pixels[2][j] + pixels[3][j] + 2) / 4);
+		}
+}
+
+// Compress the colors of a block of 16 RGBA pixels to BC1. The endpoints are the extremes of the colors along their
+// principal axis, refined once by least squares.
+void TextureCompressor::compressBlockBC1(const unsigned char* block, unsigned char* destination)
+{
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	for (unsigned int i = 0; i < 16; ++i)
+		for (unsigned int j = 0; j < 3; ++j)
+			mean[j] += block[4 * i + j] / 16.0f;
+
+	float covariance[3][3] = { { 0.0f } };
+	for (unsigned int i = 0; i < 16; ++i)
+		for (unsigned int j = 0; j < 3; ++j)
+			for (unsigned int k = 0; k < 3; ++k)
+				covariance[j][k] += (block[4 * i + j] - mean[j]) * (block[4 * i + k] - mean[k]);
+
+	// Power iteration, starting from the column of the channel with the largest variance
+	unsigned int largestChannel = 0;
+	for (unsigned int j = 1; j < 3; ++j)
+		if (covariance[j][j] > covariance[largestChannel][largestChannel])
+			largestChannel = j;
+
+	float axis[3] = { covariance[0][largestChannel], covariance[1][largestChannel], covariance[2][largestChannel] };
+	for (unsigned int iteration = 0; iteration < powerIterationQuantity; ++iteration)
+	{
+		float nextAxis[3];
+		for (unsigned int j = 0; j < 3; ++j)
+			nextAxis[j] = covariance[j][0] * axis[0] + covariance[j][1] * axis[1] + covariance[j][2] * axis[2];
+
+		float length = sqrtf(nextAxis[0] * nextAxis[0] + nextAxis[1] * nextAxis[1] + nextAxis[2] * nextAxis[2]);
+		if (length == 0.0f)
+			break;
+
+		for (unsigned int j = 0; j < 3; ++j)
+			axis[j] = nextAxis[j] / length;
+	}
+
+	float minimumProjection = 0.0f;
+	float maximumProjection = 0.0f;
+	for (unsigned int i = 0; i < 16; ++i)
+	{
+		float projection = 0.0f;
+		for (unsigned int j = 0; j < 3; ++j)
+			projection += (block[4 * i + j] - mean[j]) * axis[j];
+
+		minimumProjection = std::min(minimumProjection, projection);
+		maximumProjection = std::max(maximumProjection, projection);
+	}
+
+	float endpoint0[3];
+	float endpoint1[3];
+	for (unsigned int j = 0; j < 3; ++j)
+	{
+		endpoint0[j] = mean[j] + axis[j] * maximumProjection;
+		endpoint1[j] = mean[j] + axis[j] * minimumProjection;
+	}
+
+	unsigned short color0 = packColor565(endpoint0);
+	unsigned short color1 = packColor565(endpoint1);
+	if (color0 < color1)
+		std::swap(color0, color1);
+
+	// The 4 color mode requires color0 > color1. If they are equal, the whole block is color0
+	unsigned int indices = 0;
+	unsigned int error = (color0 != color1) ? getBC1Indices(block, color0, color1, indices) : 0;
+
+	if (color0 != color1)
+	{
+		// Least squares fit of the endpoints to the chosen indices
+		static const float indexWeights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+		float weight00 = 0.0f, weight01 = 0.0f, weight11 = 0.0f;
+		float weightedColor0[3] = { 0.0f, 0.0f, 0.0f };
+		float weightedColor1[3] = { 0.0f, 0.0f, 0.0f };
+
+		for (unsigned int i = 0; i < 16; ++i)
+		{
+			float weight0 = indexWeights[(indices >> (2 * i)) & 3];
+			float weight1 = 1.0f - weight0;
+			weight00 += weight0 * weight0;
+			weight01 += weight0 * weight1;
+			weight11 += weight1 * weight1;
+
+			for (unsigned int j = 0; j < 3; ++j)
+			{
+				weightedColor0[j] += weight0 * block[4 * i + j];
+				weightedColor1[j] += weight1 * block[4 * i + j];
+			}
+		}
+
+		float determinant = weight00 * weight11 - weight01 * weight01;
+		if (fabsf(determinant) > 1e-6f)
+		{
+			for (unsigned int j = 0; j < 3; ++j)
+			{
+				endpoint0[j] = (weight11 * weightedColor0[j] - weight01 * weightedColor1[j]) / determinant;
+				endpoint1[j] = (weight00 * weightedColor1[j] - weight01 * weightedColor0[j]) / determinant;
+			}
+
+			unsigned short refinedColor0 = packColor565(endpoint0);
+			unsigned short refinedColor1 = packColor565(endpoint1);
+			if (refinedColor0 < refinedColor1)
+				std::swap(refinedColor0, refinedColor1);
+
+			unsigned int refinedIndices;
+			if (refinedColor0 != refinedColor1)
+			{
+				unsigned int refinedError = getBC1Indices(block, refinedColor0, refinedColor1, refinedIndices);
+				if (refinedError < error)
+				{
+					color0 = refinedColor0;
+					color1 = refinedColor1;
+					indices = refinedIndices;
+				}
+			}
+		}
+	}
+
+	destination[0] = (unsigned char)(color0 & 0xFF);
+	destination[1] = (unsigned char)(color0 >> 8);
+	destination[2] = (unsigned char)(color1 & 0xFF);
+	destination[3] = (unsigned char)(color1 >> 8);
+	for (unsigned int i = 0; i < 4; ++i)
+		destination[4 + i] = (unsigned char)((indices >> (8 * i)) & 0xFF);
+}
+
+// Compress one channel of a block of 16 RGBA pixels to BC4 (the alpha block of BC3 and each channel of BC5), using
+// the 8 value mode between the minimum and the maximum of the channel.
+void TextureCompressor::compressBlockBC4(const unsigned char* block, unsigned int channel, unsigned char* destination)
+{
+	int minimum = 255;
+	int maximum = 0;
+	for (unsigned int i = 0; i < 16; ++i)
+	{
+		minimum = std::min(minimum, (int)block[4 * i + channel]);
+		maximum = std::max(maximum, (int)block[4 * i + channel]);
+	}
+
+	// Index 0 is the maximum, index 1 the minimum and indices 2 to 7 are interpolated between them
+	int palette[8];
+	palette[0] = maximum;
+	palette[1] = minimum;
+	for (unsigned int i = 2; i < 8; ++i)
+		palette[i] = ((8 - i) * maximum + (i - 1) * minimum) / 7;
+
+	unsigned long long indices = 0;
+	for (unsigned int i = 0; i < 16; ++i)
+	{
+		int value = block[4 * i + channel];
+		unsigned int bestIndex = 0;
+
+		// If the minimum and the maximum are equal, the block uses the 6 value mode, in which index 0 is still the
+		// maximum, so all indices stay 0
+		if (maximum > minimum)
+			for (unsigned int j = 1; j < 8; ++j)
+				if (abs(value - palette[j]) < abs(value - palette[bestIndex]))
+					bestIndex = j;
+
+		indices |= (unsigned long long)bestIndex << (3 * i);
+	}
+
+	destination[0] = (unsigned char)maximum;
+	destination[1] = (unsigned char)minimum;
+	for (unsigned int i = 0; i < 6; ++i)
+		destination[2 + i] = (unsigned char)((indices >> (8 * i)) & 0xFF);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+
+namespace raw
+{
+	// Block compression formats. BC1 stores RGB in 4 bits per pixel, BC3 stores RGBA in 8 bits per pixel and BC5
+	// stores two channels (the X and Y of a normal) in 8 bits per pixel.
+	enum class TextureCompression
+	{
+		BC1,
+		BC3,
+		BC5
+	};
+
+	// Block compressed texture with all of its mip levels.
+	struct CompressedTexture
+	{
+		TextureCompression compression;
+		unsigned int width;
+		unsigned int height;
+		std::vector<unsigned int> levelSizes;
+		std::vector<unsigned char> data;	// mip levels, from the largest to 1x1
+	};
+
+	// Compresses RGBA8 images to BC1, BC3 or BC5, generating the mip levels on the CPU, so textures are uploaded
+	// already compressed and glGenerateMipmap is not needed.
+	// Images without transparency are compressed to BC1 and images with transparency to BC3. Normal maps are
+	// compressed to BC5, keeping only X and Y: Z is reconstructed by the shaders.
+	class TextureCompressor
+	{
+	public:
+		static void compress(const unsigned char* image, unsigned int width, unsigned int height, bool normalMap,
+			CompressedTexture& compressedTexture);
+		static unsigned int getLevelSize(TextureCompression compression, unsigned int width, unsigned int height);
+	private:
+		static void compressLevel(const unsigned char* image, unsigned int width, unsigned int height,
+			TextureCompression compression, unsigned char* destination);
+		static void generateMipLevel(const unsigned char* image, unsigned int width, unsigned int height,
+			bool normalMap, std::vector<unsigned char>& mipLevel);
+		static void compressBlockBC1(const unsigned char* block, unsigned char* destination);
+		static void compressBlockBC4(const unsigned char* block, unsigned int channel, unsigned char* destination);
+	};
+}
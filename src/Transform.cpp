@@ -9,6 +9,8 @@ Transform::Transform()
 	this->worldRotation = glm::vec3(0.0f, 0.0f, 0.0f);
 	this->worldScale = glm::vec3(1.0f, 1.0f, 1.0f);
 	this->preTransform = 0;
+	this->version = 0;
+	this->updateModelMatrix();
 }
 
 // Creates a transform receiving the world position, the world rotation and the world scale.
@@ -18,6 +20,8 @@ Transform::Transform(glm::vec4 worldPosition, glm::vec3 worldRotation, glm::vec3
 	this->worldRotation = worldRotation;
 	this->worldScale = worldScale;
 	this->preTransform = 0;
+	this->version = 0;
+	this->updateModelMatrix();
 }
 
 Transform::~Transform()
@@ -31,9 +35,12 @@ glm::vec4 Transform::getWorldPosition() const
 	return this->worldPosition;
 }
 
-// Set the world position of the transform and update the Model Matrix.
+// Set the world position of the transform and update the Model Matrix. Nothing happens if it did not change.
 void Transform::setWorldPosition(const glm::vec4& worldPosition)
 {
+	if (this->worldPosition == worldPosition)
+		return;
+
 	this->worldPosition = worldPosition;
 	this->updateModelMatrix();
 }
@@ -43,9 +50,12 @@ glm::vec3 Transform::getWorldRotation() const
 	return this->worldRotation;
 }
 
-// Set the world rotation of the transform and update the Model Matrix.
+// Set the world rotation of the transform and update the Model Matrix. Nothing happens if it did not change.
 void Transform::setWorldRotation(const glm::vec3& worldRotation)
 {
+	if (this->worldRotation == worldRotation)
+		return;
+
 	this->worldRotation = worldRotation;
 	this->updateModelMatrix();
 }
@@ -55,9 +65,12 @@ glm::vec3 Transform::getWorldScale() const
 	return this->worldScale;
 }
 
-// Set the world scale of the transform and update the Model Matrix.
+// Set the world scale of the transform and update the Model Matrix. Nothing happens if it did not change.
 void Transform::setWorldScale(const glm::vec3& worldScale)
 {
+	if (this->worldScale == worldScale)
+		return;
+
 	this->worldScale = worldScale;
 	this->updateModelMatrix();
 }
@@ -98,12 +111,27 @@ Transform* Transform::getPreTransform()
 
 void Transform::setPreTransform(Transform* preTransform)
 {
+	// Keep the version growing even if the new pre transform has a smaller version than the old one
+	if (this->preTransform)
+		this->version += this->preTransform->getVersion();
+
 	this->preTransform = preTransform;
+	++this->version;
+}
+
+// Returns a counter that changes whenever the model matrix changes, including changes in the pre transform.
+// Used to know when data derived from the model matrix must be recomputed.
+unsigned int Transform::getVersion() const
+{
+	if (this->preTransform)
+		return this->version + this->preTransform->getVersion();
+	else
+		return this->version;
 }
 
 // Generates a new Model Matrix based on the translation, the rotation and the scale of the transform.
 // This function must be called everytime one of the attributes above is changed.
-// The result is stored in this->modelMatrix.
+// The result is stored in this->modelMatrix and the version is incremented.
 void Transform::updateModelMatrix()
 {
 	float s, c;
@@ -152,4 +180,5 @@ void Transform::updateModelMatrix()
 	}));
 
 	this->modelMatrix = translationMatrix * rotationMatrix * scaleMatrix;
+	++this->version;
 }
\ No newline at end of file
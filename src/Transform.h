@@ -23,8 +23,10 @@ namespace raw
 		void incRotY(float increment);
 		void incRotZ(float increment);
 		const glm::mat4 getModelMatrix() const;
+		unsigned int getVersion() const;
 	private:
 		void updateModelMatrix();
+		unsigned int version;
 		glm::vec4 worldPosition;
 		glm::vec3 worldRotation;
 		glm::vec3 worldScale;
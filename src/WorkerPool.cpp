@@ -0,0 +1,130 @@
+#include "WorkerPool.h"
+
+using namespace raw;
+
+// Creates the pool with the given number of threads. Zero threads is valid: run() then works alone.
+WorkerPool::WorkerPool(unsigned int workerQuantity)
+{
+	this->task = 0;
+	this->taskData = 0;
+	this->itemQuantity = 0;
+	this->batchSize = 1;
+	this->nextItem = 0;
+	this->busyWorkers = 0;
+	this->generation = 0;
+	this->stop = false;
+
+	for (unsigned int i = 0; i < workerQuantity; ++i)
+		this->workers.push_back(std::thread(&WorkerPool::workerLoop, this));
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->stop = true;
+	}
+
+	this->workAvailable.notify_all();
+
+	for (unsigned int i = 0; i < this->workers.size(); ++i)
+		this->workers[i].join();
+}
+
+unsigned int WorkerPool::getWorkerQuantity() const
+{
+	return this->workers.size();
+}
+
+// Number of workers that keeps every core busy, counting the thread that calls run().
+unsigned int WorkerPool::getDefaultWorkerQuantity()
+{
+	unsigned int hardwareThreads = std::thread::hardware_concurrency();
+
+	if (hardwareThreads <= 1)
+		return 0;
+
+	return hardwareThreads - 1;
+}
+
+// Process items [0, itemQuantity) calling task for each batch. Blocks until all items are done.
+void WorkerPool::run(WorkerPoolTask task, void* taskData, unsigned int itemQuantity, unsigned int batchSize)
+{
+	if (itemQuantity == 0)
+		return;
+
+	if (batchSize == 0)
+		batchSize = 1;
+
+	// Not worth waking up the workers
+	if (this->workers.size() == 0 || itemQuantity <= batchSize)
+	{
+		task(taskData, 0, itemQuantity);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->task = task;
+		this->taskData = taskData;
+		this->itemQuantity = itemQuantity;
+		this->batchSize = batchSize;
+		this->nextItem = 0;
+		this->busyWorkers = this->workers.size();
+		++this->generation;
+	}
+
+	this->workAvailable.notify_all();
+	this->executeBatches();
+
+	std::unique_lock<std::mutex> lock(this->mutex);
+	while (this->busyWorkers > 0)
+		this->workFinished.wait(lock);
+}
+
+void WorkerPool::workerLoop()
+{
+	unsigned int lastGeneration = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			while (!this->stop && this->generation == lastGeneration)
+				this->workAvailable.wait(lock);
+
+			if (this->stop)
+				return;
+
+			lastGeneration = this->generation;
+		}
+
+		this->executeBatches();
+
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			--this->busyWorkers;
+		}
+
+		this->workFinished.notify_one();
+	}
+}
+
+// Grab batches until all items of the current run were taken.
+void WorkerPool::executeBatches()
+{
+	while (true)
+	{
+		unsigned int begin = this->nextItem.fetch_add(this->batchSize);
+
+		if (begin >= this->itemQuantity)
+			return;
+
+		unsigned int end = begin + this->batchSize;
+
+		if (end > this->itemQuantity)
+			end = this->itemQuantity;
+
+		this->task(this->taskData, begin, end);
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace raw
+{
+	// Task executed by the worker pool. Must process the items in the range [begin, end).
+	typedef void (*WorkerPoolTask)(void* taskData, unsigned int begin, unsigned int end);
+
+	// Fixed set of threads that split a range of items in batches. The thread calling run() also works,
+	// and run() only returns when every item was processed. run() must not be called from two threads at once.
+	class WorkerPool
+	{
+	public:
+		WorkerPool(unsigned int workerQuantity);
+		~WorkerPool();
+		unsigned int getWorkerQuantity() const;
+		void run(WorkerPoolTask task, void* taskData, unsigned int itemQuantity, unsigned int batchSize);
+		static unsigned int getDefaultWorkerQuantity();
+	private:
+		void workerLoop();
+		void executeBatches();
+		std::vector<std::thread> workers;
+		std::mutex mutex;
+		std::condition_variable workAvailable;
+		std::condition_variable workFinished;
+		WorkerPoolTask task;
+		void* taskData;
+		unsigned int itemQuantity;
+		unsigned int batchSize;
+		std::atomic<unsigned int> nextItem;
+		unsigned int busyWorkers;
+		unsigned int generation;
+		bool stop;
+	};
+}